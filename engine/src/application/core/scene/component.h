@@ -1,7 +1,11 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <entt/entity/entity.hpp>
 #include <string>
+#include <cstdint>
+
+#include <application/managers/asset_registry.h>
 
 struct EntityName
 {
@@ -10,18 +14,59 @@ struct EntityName
 	std::string m_name;
 };
 
+//-- Relative to parent, or to world for root entities. Sprite quad is the unit square around
+//-- local origin, pivot is the local point placed at position, rotation and scale go around it.
+//-- Changes take effect after Scene::markTransformDirty
 struct TransformComponent
 {
 	constexpr static inline std::string_view	C_COMPONENT_NAME = "Transform Component";
 
-	glm::vec3 m_position;
+	//-- z is depth, added to depth of parent
+	glm::vec3 m_position = { 0.0f, 0.0f, 0.0f };
+	float     m_rotation = 0.0f;
+	glm::vec2 m_scale = { 1.0f, 1.0f };
+	glm::vec2 m_pivot = { 0.0f, 0.0f };
+};
+
+//-- Cached result of the whole parent chain, written by scene only when transform of entity
+//-- or one of its ancestors changed
+struct WorldTransformComponent
+{
+	//-- 2D affine from local units to world, columns are local x and y axes and translation
+	glm::mat3x2 m_world = glm::mat3x2(1.0f);
+	float       m_depth = 0.0f;
+	//-- Parts of m_world instanced sprites are drawn with, shear of non uniform parent scale is dropped
+	glm::vec2   m_scale = { 1.0f, 1.0f };
+	float       m_rotation = 0.0f;
+};
+
+//-- Children of entity are linked through their siblings, depth of root entity is zero
+struct HierarchyComponent
+{
+	entt::entity m_parent = entt::null;
+	entt::entity m_firstChild = entt::null;
+	entt::entity m_prevSibling = entt::null;
+	entt::entity m_nextSibling = entt::null;
+	uint32_t     m_depth = 0;
+};
+
+//-- World transform of entity and its subtree is recomputed on the next scene update
+struct TransformDirtyComponent
+{
+};
+
+//-- Retained rendering only, sprite of entity is sent to renderer on the next scene update
+struct SpriteChangedComponent
+{
 };
 
+//-- Changes have to go through registry patch or replace (Entity::patchComponent), retained
+//-- rendering learns about them from update signal and keeps the old sprite otherwise
 struct SpriteComponent
 {
 	constexpr static inline std::string_view	C_COMPONENT_NAME = "Sprite Component";
 
-	std::string m_texturePath;
+	TextureHandle m_texture = C_INVALID_TEXTURE_HANDLE;
 };
 
 struct CameraComponent
@@ -1,11 +1,82 @@
 #include "scene.h"
 #include <application/managers/renderer_manager.h>
+#include <application/core/utils/thread_pool.h>
+#include <application/core/utils/engine_assert.h>
+
+#include <algorithm>
+#include <cmath>
+
+//-- Local matrix is T(position) * R(rotation) * S(scale) * T(-pivot), parent one goes first
+WorldTransformComponent worldTransform(const TransformComponent& local, const WorldTransformComponent& parent)
+{
+	const float     cosRotation = std::cos(local.m_rotation);
+	const float     sinRotation = std::sin(local.m_rotation);
+	const glm::vec2 localX = glm::vec2(cosRotation, sinRotation) * local.m_scale.x;
+	const glm::vec2 localY = glm::vec2(-sinRotation, cosRotation) * local.m_scale.y;
+	const glm::vec2 localOrigin = glm::vec2(local.m_position) - localX * local.m_pivot.x - localY * local.m_pivot.y;
+
+	const glm::mat2 parentAxes = glm::mat2(parent.m_world[0], parent.m_world[1]);
+	WorldTransformComponent world;
+	world.m_world = glm::mat3x2(parentAxes * localX, parentAxes * localY, parentAxes * localOrigin + parent.m_world[2]);
+	world.m_depth = parent.m_depth + local.m_position.z;
+
+	//-- Rotation follows x axis, y scale keeps area and mirroring of the matrix
+	const glm::vec2 worldX = world.m_world[0];
+	const float     scaleX = glm::length(worldX);
+	const float     determinant = worldX.x * world.m_world[1].y - worldX.y * world.m_world[1].x;
+	world.m_rotation = std::atan2(worldX.y, worldX.x);
+	world.m_scale = { scaleX, scaleX > 0.0f ? determinant / scaleX : 0.0f };
+	return world;
+}
+
+Scene::Scene(std::shared_ptr<EngineContext> context)
+	: m_engineContext(context)
+{
+	m_rendererManager = &m_engineContext->m_managerHolder.getManager<RendererManager>();
+	m_retainedSprites = m_rendererManager->m_retainedSprites;
+
+	m_registry.on_construct<WorldTransformComponent>().connect<&Scene::onWorldTransformChanged>(this);
+	m_registry.on_update<WorldTransformComponent>().connect<&Scene::onWorldTransformChanged>(this);
+	m_registry.on_destroy<WorldTransformComponent>().connect<&Scene::onWorldTransformRemoved>(this);
+	if (!m_retainedSprites)
+	{
+		return;
+	}
+
+	//-- World transform is replaced only when it was recomputed, so static sprites never fire
+	m_registry.on_construct<SpriteComponent>().connect<&Scene::onSpriteAdded>(this);
+	m_registry.on_update<SpriteComponent>().connect<&Scene::onSpriteChanged>(this);
+	m_registry.on_update<WorldTransformComponent>().connect<&Scene::onSpriteChanged>(this);
+	m_registry.on_destroy<SpriteComponent>().connect<&Scene::onSpriteRemoved>(this);
+}
+
+Scene::~Scene()
+{
+	//-- Renderer slots of the remaining sprites are freed through signals, spatial index is
+	//-- still alive for them too
+	m_registry.clear();
+}
+
+//-- Unit quad is centered on transform origin, box half extents are half sums of its
+//-- transformed axes projected on world axes
+SpatialBox worldBounds(const WorldTransformComponent& world)
+{
+	const glm::vec2 extent = (glm::abs(world.m_world[0]) + glm::abs(world.m_world[1])) * 0.5f;
+	return { world.m_world[2] - extent, world.m_world[2] + extent };
+}
 
 void Scene::update(float dt)
 {
 	//-- Here will go check of current state
+	updateTransforms();
+	if (m_retainedSprites)
+	{
+		sendChangedSprites();
+		return;
+	}
+
 	//-- Here we collect all entities to draw
-	auto spriteView = m_registry.view<SpriteComponent>();
+	auto spriteView = m_registry.view<SpriteComponent, WorldTransformComponent>();
 	sendToDraw(spriteView);
 }
 
@@ -25,21 +96,248 @@ Entity Scene::addEntity()
 
 	Entity entity(newEntity, m_registry);
 	entity.addComponent<TransformComponent>(glm::vec3(1.0f, 1.0f, 0.0f));
+	entity.addComponent<WorldTransformComponent>();
+	entity.addComponent<HierarchyComponent>();
+	entity.addComponent<TransformDirtyComponent>();
 	entity.addComponent<EntityName>("new_entity");
 
 	return entity;
 }
 
+void Scene::setParent(entt::entity child, entt::entity parent)
+{
+	for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = m_registry.get<HierarchyComponent>(ancestor).m_parent)
+	{
+		engineAssert(ancestor != child, "Entity can't be parented to itself or its descendant");
+	}
+
+	detachFromParent(child);
+
+	HierarchyComponent& childHierarchy = m_registry.get<HierarchyComponent>(child);
+	if (parent != entt::null)
+	{
+		//-- New child goes first, so linking doesn't walk siblings
+		HierarchyComponent& parentHierarchy = m_registry.get<HierarchyComponent>(parent);
+		if (parentHierarchy.m_firstChild != entt::null)
+		{
+			m_registry.get<HierarchyComponent>(parentHierarchy.m_firstChild).m_prevSibling = child;
+		}
+		childHierarchy.m_nextSibling = parentHierarchy.m_firstChild;
+		childHierarchy.m_parent = parent;
+		parentHierarchy.m_firstChild = child;
+	}
+
+	//-- Depths of the whole subtree follow the new parent
+	m_hierarchyStack.clear();
+	m_hierarchyStack.push_back(child);
+	while (!m_hierarchyStack.empty())
+	{
+		const entt::entity entity = m_hierarchyStack.back();
+		m_hierarchyStack.pop_back();
+
+		HierarchyComponent& hierarchy = m_registry.get<HierarchyComponent>(entity);
+		hierarchy.m_depth = hierarchy.m_parent == entt::null ? 0 : m_registry.get<HierarchyComponent>(hierarchy.m_parent).m_depth + 1;
+		for (entt::entity next = hierarchy.m_firstChild; next != entt::null; next = m_registry.get<HierarchyComponent>(next).m_nextSibling)
+		{
+			m_hierarchyStack.push_back(next);
+		}
+	}
+
+	markTransformDirty(child);
+}
+
+void Scene::markTransformDirty(entt::entity entity)
+{
+	m_registry.emplace_or_replace<TransformDirtyComponent>(entity);
+}
+
+void Scene::removeEntity(entt::entity e)
+{
+	detachFromParent(e);
+
+	//-- Subtree is collected first, destroyed entities can't be walked
+	m_hierarchyStack.clear();
+	m_hierarchyStack.push_back(e);
+	for (size_t i = 0; i < m_hierarchyStack.size(); ++i)
+	{
+		const HierarchyComponent& hierarchy = m_registry.get<HierarchyComponent>(m_hierarchyStack[i]);
+		for (entt::entity child = hierarchy.m_firstChild; child != entt::null; child = m_registry.get<HierarchyComponent>(child).m_nextSibling)
+		{
+			m_hierarchyStack.push_back(child);
+		}
+	}
+	m_registry.destroy(m_hierarchyStack.begin(), m_hierarchyStack.end());
+}
+
+void Scene::detachFromParent(entt::entity child)
+{
+	HierarchyComponent& hierarchy = m_registry.get<HierarchyComponent>(child);
+	if (hierarchy.m_parent == entt::null)
+	{
+		return;
+	}
+
+	if (hierarchy.m_prevSibling != entt::null)
+	{
+		m_registry.get<HierarchyComponent>(hierarchy.m_prevSibling).m_nextSibling = hierarchy.m_nextSibling;
+	}
+	else
+	{
+		m_registry.get<HierarchyComponent>(hierarchy.m_parent).m_firstChild = hierarchy.m_nextSibling;
+	}
+	if (hierarchy.m_nextSibling != entt::null)
+	{
+		m_registry.get<HierarchyComponent>(hierarchy.m_nextSibling).m_prevSibling = hierarchy.m_prevSibling;
+	}
+
+	hierarchy.m_parent = entt::null;
+	hierarchy.m_prevSibling = entt::null;
+	hierarchy.m_nextSibling = entt::null;
+}
+
+void Scene::updateTransforms()
+{
+	//-- Static scene costs one empty view check
+	auto dirtyView = m_registry.view<TransformDirtyComponent>();
+	if (dirtyView.empty())
+	{
+		return;
+	}
+
+	//-- Shallow entities go first, so every subtree is walked once from its topmost changed
+	//-- entity and parents are always up to date before their children
+	m_dirtyTransforms.clear();
+	for (const entt::entity entity : dirtyView)
+	{
+		m_dirtyTransforms.push_back({ m_registry.get<HierarchyComponent>(entity).m_depth, entity });
+	}
+	std::ranges::sort(m_dirtyTransforms, {}, &std::pair<uint32_t, entt::entity>::first);
+
+	for (const auto [depth, entity] : m_dirtyTransforms)
+	{
+		//-- Already updated as a descendant of changed ancestor
+		if (m_registry.all_of<TransformDirtyComponent>(entity))
+		{
+			updateSubtreeTransforms(entity);
+		}
+	}
+}
+
+void Scene::updateSubtreeTransforms(entt::entity root)
+{
+	m_hierarchyStack.clear();
+	m_hierarchyStack.push_back(root);
+	while (!m_hierarchyStack.empty())
+	{
+		const entt::entity entity = m_hierarchyStack.back();
+		m_hierarchyStack.pop_back();
+
+		const HierarchyComponent& hierarchy = m_registry.get<HierarchyComponent>(entity);
+		const WorldTransformComponent parentWorld = hierarchy.m_parent == entt::null
+			? WorldTransformComponent{}
+			: m_registry.get<WorldTransformComponent>(hierarchy.m_parent);
+		m_registry.replace<WorldTransformComponent>(entity, worldTransform(m_registry.get<TransformComponent>(entity), parentWorld));
+		m_registry.remove<TransformDirtyComponent>(entity);
+
+		for (entt::entity child = hierarchy.m_firstChild; child != entt::null; child = m_registry.get<HierarchyComponent>(child).m_nextSibling)
+		{
+			m_hierarchyStack.push_back(child);
+		}
+	}
+}
+
 void Scene::sendToDraw(auto& spriteView)
 {
-	for (auto& entity : spriteView)
+	auto&           threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+	SpriteDrawList& drawList = m_rendererManager->m_sprites;
+
+	//-- Candidates are entities of the leading storage, size hint of multi component view.
+	//-- Each range writes sprites from its own first slot on, unused slots are squeezed out after
+	const auto*    leadingStorage = spriteView.handle();
+	const uint32_t candidatesCount = static_cast<uint32_t>(spriteView.size_hint());
+	const uint32_t firstSprite = m_rendererManager->reserveSprites(candidatesCount);
+	m_extractedRanges.resize(threadPool.rangesCount(candidatesCount, C_MIN_SPRITES_PER_TASK));
+	threadPool.parallelFor(candidatesCount, C_MIN_SPRITES_PER_TASK, [&](uint32_t range, uint32_t first, uint32_t last)
+		{
+			uint32_t spriteIndex = firstSprite + first;
+			for (uint32_t candidate = first; candidate < last; ++candidate)
+			{
+				//-- View walks leading storage from its back, sprites keep that order
+				const entt::entity entity = (*leadingStorage)[candidatesCount - 1 - candidate];
+				if (!spriteView.contains(entity))
+				{
+					continue;
+				}
+
+				const auto [sprite, world] = spriteView.get(entity);
+				drawList.m_transforms[spriteIndex] = world.m_world;
+				drawList.m_depths[spriteIndex] = world.m_depth;
+				drawList.m_scales[spriteIndex] = world.m_scale;
+				drawList.m_rotations[spriteIndex] = world.m_rotation;
+				drawList.m_textures[spriteIndex] = sprite.m_texture;
+				++spriteIndex;
+			}
+			m_extractedRanges[range] = { firstSprite + first, spriteIndex - firstSprite - first };
+		});
+
+	uint32_t spritesEnd = firstSprite;
+	for (const auto [rangeFirst, rangeCount] : m_extractedRanges)
+	{
+		drawList.moveSprites(rangeFirst, rangeCount, spritesEnd);
+		spritesEnd += rangeCount;
+	}
+	drawList.truncate(spritesEnd);
+}
+
+void Scene::onWorldTransformChanged(entt::registry& registry, entt::entity entity)
+{
+	m_spatialIndex.update(entity, worldBounds(registry.get<WorldTransformComponent>(entity)));
+}
+
+void Scene::onWorldTransformRemoved(entt::registry& registry, entt::entity entity)
+{
+	m_spatialIndex.remove(entity);
+}
+
+void Scene::onSpriteAdded(entt::registry& registry, entt::entity entity)
+{
+	const uint32_t entityIndex = entt::to_entity(entity);
+	if (entityIndex >= m_spriteSlots.size())
+	{
+		m_spriteSlots.resize(entityIndex + 1, C_NO_SPRITE_SLOT);
+	}
+	m_spriteSlots[entityIndex] = m_rendererManager->addRetainedSprite();
+	registry.emplace_or_replace<SpriteChangedComponent>(entity);
+}
+
+void Scene::onSpriteChanged(entt::registry& registry, entt::entity entity)
+{
+	if (registry.all_of<SpriteComponent>(entity))
+	{
+		registry.emplace_or_replace<SpriteChangedComponent>(entity);
+	}
+}
+
+void Scene::onSpriteRemoved(entt::registry& registry, entt::entity entity)
+{
+	uint32_t& slot = m_spriteSlots[entt::to_entity(entity)];
+	m_rendererManager->removeRetainedSprite(slot);
+	slot = C_NO_SPRITE_SLOT;
+}
+
+void Scene::sendChangedSprites()
+{
+	//-- Nothing changed, nothing is sent
+	auto changedView = m_registry.view<SpriteChangedComponent, SpriteComponent, WorldTransformComponent>();
+	for (const auto [entity, sprite, world] : changedView.each())
 	{
-		SpriteComponent&    sprite = m_registry.get<SpriteComponent>(entity);
-		TransformComponent& transform = m_registry.get<TransformComponent>(entity);
-		SpriteInfo          spriteInfo{
-			.m_position = transform.m_position
-			, .m_texturePath = sprite.m_texturePath
-		};
-		m_engineContext->m_managerHolder.getManager<RendererManager>().addSpriteToDrawList(std::move(spriteInfo));
+		m_rendererManager->updateRetainedSprite(m_spriteSlots[entt::to_entity(entity)], {
+			.m_transform = world.m_world
+			, .m_depth = world.m_depth
+			, .m_texture = sprite.m_texture
+			, .m_scale = world.m_scale
+			, .m_rotation = world.m_rotation
+		});
 	}
+	m_registry.clear<SpriteChangedComponent>();
 }
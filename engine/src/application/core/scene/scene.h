@@ -1,9 +1,14 @@
 #pragma once
 
+#include <limits>
 #include <numeric>
+#include <vector>
 #include <entt/entt.hpp>
 #include <application/engine_context.h>
 #include "component.h"
+#include "spatial_hash.h"
+
+struct RendererManager;
 
 class Entity
 {
@@ -28,6 +33,13 @@ public:
 		return m_registry.get<Component>(m_entity);
 	}
 
+	//-- Change goes through registry update signal, components tracked by scene need it
+	template<typename Component, typename Func>
+	void patchComponent(Func&& func)
+	{
+		m_registry.patch<Component>(m_entity, std::forward<Func>(func));
+	}
+
 	entt::entity entityId() const
 	{
 		return m_entity;
@@ -47,26 +59,58 @@ public:
 		Simulating
 	};
 
-	Scene(std::shared_ptr<EngineContext> context) : m_engineContext(context) {}
+	Scene(std::shared_ptr<EngineContext> context);
+	~Scene();
 
 	void update(float dt);
 	void startSimulation();
 	void stopSimulation();
 	Entity addEntity();
+	//-- Child keeps its local transform, which is relative to the new parent from now on.
+	//-- Null parent makes child a root
+	void setParent(entt::entity child, entt::entity parent);
+	//-- Transform of entity changed, its subtree is recomputed on the next update
+	void markTransformDirty(entt::entity entity);
 
 	entt::registry& registry() { return m_registry; }
+	const entt::registry& registry() const { return m_registry; }
+	//-- World boxes of entity quads, follows world transforms as they are recomputed
+	SpatialHash& spatialIndex() { return m_spatialIndex; }
 
-	void removeEntity(entt::entity e)
-	{
-		m_registry.destroy(e);
-	}
+	//-- Descendants are removed with the entity
+	void removeEntity(entt::entity e);
 
 private:
+	void updateTransforms();
+	void updateSubtreeTransforms(entt::entity root);
+	void detachFromParent(entt::entity child);
 	void sendToDraw(auto& spriteView);
+	void onWorldTransformChanged(entt::registry& registry, entt::entity entity);
+	void onWorldTransformRemoved(entt::registry& registry, entt::entity entity);
+	//-- Retained rendering, sprite changes are tracked through registry signals
+	void onSpriteAdded(entt::registry& registry, entt::entity entity);
+	void onSpriteChanged(entt::registry& registry, entt::entity entity);
+	void onSpriteRemoved(entt::registry& registry, entt::entity entity);
+	void sendChangedSprites();
 
 private:
+	//-- Smaller ranges cost more to hand over than to extract
+	constexpr static uint32_t C_MIN_SPRITES_PER_TASK = 4096;
+	constexpr static uint32_t C_NO_SPRITE_SLOT = std::numeric_limits<uint32_t>::max();
+
 	std::shared_ptr<EngineContext>	m_engineContext;
 	//-- All entities holder
 	entt::registry	m_registry;
 	State			m_state = State::Idle;
+	//-- Manager outlives scenes, looked up once
+	RendererManager*	m_rendererManager = nullptr;
+	bool				m_retainedSprites = false;
+	//-- Retained mode, renderer slot of sprite indexed by entity index
+	std::vector<uint32_t>	m_spriteSlots;
+	SpatialHash				m_spatialIndex;
+	//-- First slot and count of sprites written by every extraction range
+	std::vector<std::pair<uint32_t, uint32_t>>	m_extractedRanges;
+	//-- Depth and entity of changed transforms, storage is kept between frames
+	std::vector<std::pair<uint32_t, entt::entity>>	m_dirtyTransforms;
+	std::vector<entt::entity>						m_hierarchyStack;
 };
\ No newline at end of file
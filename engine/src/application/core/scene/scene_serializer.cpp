@@ -0,0 +1,773 @@
+#include "scene_serializer.h"
+
+#include <application/core/scene/scene.h>
+#include <application/core/utils/engine_assert.h>
+#include <application/core/utils/mapped_file.h>
+#include <application/core/utils/string_interner.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------
+//-- "SSCN" in file byte order
+constexpr uint32_t C_SCENE_MAGIC = 0x4E435353;
+//-- Components are stored with their memory layout, any change of them bumps the version
+constexpr uint32_t C_SCENE_VERSION = 1;
+//-- Every array starts aligned, so mapped pools are read in place as component arrays
+constexpr uint64_t C_SCENE_ALIGNMENT = 16;
+constexpr uint32_t C_NO_STRING = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t C_NO_COMPONENT = std::numeric_limits<uint32_t>::max();
+
+//-------------------------------------------------------------------------------------------------
+//-- Stored components. Names and sprites keep string index, tags keep entities only. Transient
+//-- state as retained sprite changes is not stored
+enum class ScenePool : uint32_t
+{
+	Name,
+	Transform,
+	WorldTransform,
+	Hierarchy,
+	Sprite,
+	Camera,
+	TransformDirty,
+
+	Count
+};
+
+constexpr std::array<uint32_t, static_cast<size_t>(ScenePool::Count)> C_POOL_STRIDES =
+{
+	sizeof(uint32_t)
+	, sizeof(TransformComponent)
+	, sizeof(WorldTransformComponent)
+	, sizeof(HierarchyComponent)
+	, sizeof(uint32_t)
+	, sizeof(CameraComponent)
+	, 0
+};
+
+static_assert(std::is_trivially_copyable_v<TransformComponent>);
+static_assert(std::is_trivially_copyable_v<WorldTransformComponent>);
+static_assert(std::is_trivially_copyable_v<HierarchyComponent>);
+static_assert(std::is_trivially_copyable_v<CameraComponent>);
+
+//-------------------------------------------------------------------------------------------------
+struct SceneFileHeader
+{
+	uint32_t m_magic = C_SCENE_MAGIC;
+	uint32_t m_version = C_SCENE_VERSION;
+	uint32_t m_entitiesCount = 0;
+	uint32_t m_poolsCount = 0;
+	uint32_t m_stringsCount = 0;
+	uint32_t m_reserved = 0;
+	//-- m_stringsCount + 1 offsets into string bytes, string i is [offset i, offset i + 1)
+	uint64_t m_stringOffsetsOffset = 0;
+	uint64_t m_stringBytesOffset = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Entities of the pool are file entity numbers, from zero to entities count
+struct ScenePoolHeader
+{
+	uint32_t m_pool = 0;
+	uint32_t m_stride = 0;
+	uint32_t m_count = 0;
+	uint32_t m_reserved = 0;
+	uint64_t m_entitiesOffset = 0;
+	uint64_t m_componentsOffset = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+uint64_t alignScene(uint64_t offset)
+{
+	return (offset + C_SCENE_ALIGNMENT - 1) / C_SCENE_ALIGNMENT * C_SCENE_ALIGNMENT;
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Pools are gathered into one body, offsets are relative to it until the file is written
+class SceneWriter
+{
+public:
+	//-- Entities are numbered by position in entity storage. Empty registry creates the same
+	//-- numbers on load, so pools go into it without translation
+	explicit SceneWriter(const entt::registry& registry) : m_registry(registry)
+	{
+		const auto* entities = registry.storage<entt::entity>();
+		m_entitiesCount = static_cast<uint32_t>(entities->free_list());
+		m_fileIds.resize(entities->size(), entt::null);
+		for (uint32_t i = 0; i < m_entitiesCount; ++i)
+		{
+			m_fileIds[entt::to_entity(entities->data()[i])] = static_cast<entt::entity>(i);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	entt::entity fileId(entt::entity entity) const
+	{
+		return entity == entt::null ? entity : m_fileIds[entt::to_entity(entity)];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	uint32_t addString(std::string_view str)
+	{
+		return m_strings.intern(str);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Component>
+	void addPool(ScenePool pool)
+	{
+		addPool<Component>(pool, [](const Component& component) { return component; });
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Component, typename Store>
+	void addPool(ScenePool pool, const Store& store)
+	{
+		using Stored = std::invoke_result_t<Store, const Component&>;
+		static_assert(std::is_trivially_copyable_v<Stored>);
+
+		const auto* storage = m_registry.storage<Component>();
+		if (storage == nullptr || storage->empty())
+		{
+			return;
+		}
+
+		const uint32_t   count = static_cast<uint32_t>(storage->size());
+		ScenePoolHeader& header = addPoolHeader(pool, *storage);
+		header.m_componentsOffset = reserve(static_cast<uint64_t>(count) * sizeof(Stored));
+		std::byte* components = m_body.data() + header.m_componentsOffset;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Stored stored = store(storage->get(storage->data()[i]));
+			std::memcpy(components + static_cast<size_t>(i) * sizeof(Stored), &stored, sizeof(Stored));
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Tag>
+	void addTagPool(ScenePool pool)
+	{
+		const auto* storage = m_registry.storage<Tag>();
+		if (storage != nullptr && !storage->empty())
+		{
+			addPoolHeader(pool, *storage);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	void write(const fs_path& path)
+	{
+		//-- Strings go last, all of them are known only after pools
+		SceneFileHeader header;
+		header.m_entitiesCount = m_entitiesCount;
+		header.m_poolsCount = static_cast<uint32_t>(m_pools.size());
+		header.m_stringsCount = m_strings.size();
+
+		std::vector<uint32_t> stringOffsets = { 0 };
+		for (uint32_t i = 0; i < header.m_stringsCount; ++i)
+		{
+			stringOffsets.push_back(stringOffsets.back() + static_cast<uint32_t>(m_strings.resolve(i).size()));
+		}
+		header.m_stringOffsetsOffset = reserve(stringOffsets.size() * sizeof(uint32_t));
+		std::memcpy(m_body.data() + header.m_stringOffsetsOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+		header.m_stringBytesOffset = reserve(stringOffsets.back());
+		for (uint32_t i = 0; i < header.m_stringsCount; ++i)
+		{
+			const std::string_view str = m_strings.resolve(i);
+			std::memcpy(m_body.data() + header.m_stringBytesOffset + stringOffsets[i], str.data(), str.size());
+		}
+
+		//-- Body follows the tables, its offsets become file ones
+		const uint64_t bodyOffset = alignScene(sizeof(SceneFileHeader) + m_pools.size() * sizeof(ScenePoolHeader));
+		header.m_stringOffsetsOffset += bodyOffset;
+		header.m_stringBytesOffset += bodyOffset;
+		for (auto& pool : m_pools)
+		{
+			pool.m_entitiesOffset += bodyOffset;
+			pool.m_componentsOffset += bodyOffset;
+		}
+
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+		engineAssert(out.is_open(), std::format("Failed to write scene: {}", path.generic_string()));
+		const std::array<char, C_SCENE_ALIGNMENT> padding = {};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(m_pools.data()), m_pools.size() * sizeof(ScenePoolHeader));
+		out.write(padding.data(), bodyOffset - sizeof(header) - m_pools.size() * sizeof(ScenePoolHeader));
+		out.write(reinterpret_cast<const char*>(m_body.data()), m_body.size());
+	}
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	//-- Zeroed aligned range at the end of body
+	uint64_t reserve(uint64_t bytes)
+	{
+		const uint64_t offset = alignScene(m_body.size());
+		m_body.resize(offset + bytes);
+		return offset;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Entities of every pool are written in storage order, which loading keeps
+	ScenePoolHeader& addPoolHeader(ScenePool pool, const entt::sparse_set& storage)
+	{
+		ScenePoolHeader& header = m_pools.emplace_back();
+		header.m_pool = static_cast<uint32_t>(pool);
+		header.m_stride = C_POOL_STRIDES[header.m_pool];
+		header.m_count = static_cast<uint32_t>(storage.size());
+		header.m_entitiesOffset = reserve(static_cast<uint64_t>(header.m_count) * sizeof(entt::entity));
+
+		std::byte* entities = m_body.data() + header.m_entitiesOffset;
+		for (uint32_t i = 0; i < header.m_count; ++i)
+		{
+			const entt::entity entity = fileId(storage.data()[i]);
+			std::memcpy(entities + static_cast<size_t>(i) * sizeof(entt::entity), &entity, sizeof(entt::entity));
+		}
+		return header;
+	}
+
+private:
+	const entt::registry&			m_registry;
+	uint32_t						m_entitiesCount = 0;
+	//-- File entity number indexed by entity index
+	std::vector<entt::entity>		m_fileIds;
+	StringInterner					m_strings;
+	std::vector<ScenePoolHeader>	m_pools;
+	std::vector<std::byte>			m_body;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Views over mapped file. Tables, array ranges and references between entities and strings are
+//-- validated once on open, accessors trust them afterwards
+class SceneReader
+{
+public:
+	//-------------------------------------------------------------------------------------------------
+	bool open(std::span<const std::byte> bytes)
+	{
+		m_bytes = bytes;
+		if (bytes.size() < sizeof(SceneFileHeader))
+		{
+			return false;
+		}
+
+		std::memcpy(&m_header, bytes.data(), sizeof(SceneFileHeader));
+		const uint64_t poolsBytes = static_cast<uint64_t>(m_header.m_poolsCount) * sizeof(ScenePoolHeader);
+		const uint64_t offsetsBytes = (static_cast<uint64_t>(m_header.m_stringsCount) + 1) * sizeof(uint32_t);
+		if (m_header.m_magic != C_SCENE_MAGIC
+			|| m_header.m_version != C_SCENE_VERSION
+			|| m_header.m_entitiesCount > entt::entt_traits<entt::entity>::entity_mask
+			|| poolsBytes > bytes.size() - sizeof(SceneFileHeader)
+			|| !fits(m_header.m_stringOffsetsOffset, offsetsBytes)
+			|| !fits(m_header.m_stringBytesOffset, 0))
+		{
+			return false;
+		}
+
+		m_pools = { reinterpret_cast<const ScenePoolHeader*>(bytes.data() + sizeof(SceneFileHeader)), m_header.m_poolsCount };
+		m_stringOffsets = { reinterpret_cast<const uint32_t*>(bytes.data() + m_header.m_stringOffsetsOffset), m_header.m_stringsCount + 1 };
+		m_stringBytes = reinterpret_cast<const char*>(bytes.data() + m_header.m_stringBytesOffset);
+
+		const uint64_t stringBytesSize = bytes.size() - m_header.m_stringBytesOffset;
+		for (uint32_t i = 0; i < m_header.m_stringsCount; ++i)
+		{
+			if (m_stringOffsets[i] > m_stringOffsets[i + 1])
+			{
+				return false;
+			}
+		}
+		if (m_stringOffsets[0] != 0 || m_stringOffsets.back() > stringBytesSize)
+		{
+			return false;
+		}
+
+		std::array<const ScenePoolHeader*, static_cast<size_t>(ScenePool::Count)> seenPools = {};
+		for (const ScenePoolHeader& pool : m_pools)
+		{
+			if (pool.m_pool >= static_cast<uint32_t>(ScenePool::Count)
+				|| seenPools[pool.m_pool]
+				|| pool.m_stride != C_POOL_STRIDES[pool.m_pool]
+				|| pool.m_count > m_header.m_entitiesCount
+				|| !fits(pool.m_entitiesOffset, static_cast<uint64_t>(pool.m_count) * sizeof(entt::entity))
+				|| !fits(pool.m_componentsOffset, static_cast<uint64_t>(pool.m_count) * pool.m_stride)
+				|| !validatePool(pool))
+			{
+				return false;
+			}
+			seenPools[pool.m_pool] = &pool;
+		}
+		return validateTransformOwners(seenPools);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	uint32_t entitiesCount() const { return m_header.m_entitiesCount; }
+	uint32_t stringsCount() const { return m_header.m_stringsCount; }
+	std::span<const ScenePoolHeader> pools() const { return m_pools; }
+
+	//-------------------------------------------------------------------------------------------------
+	std::string_view string(uint32_t index) const
+	{
+		return { m_stringBytes + m_stringOffsets[index], m_stringOffsets[index + 1] - m_stringOffsets[index] };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	std::span<const entt::entity> entities(const ScenePoolHeader& pool) const
+	{
+		return { reinterpret_cast<const entt::entity*>(m_bytes.data() + pool.m_entitiesOffset), pool.m_count };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Stored>
+	std::span<const Stored> components(const ScenePoolHeader& pool) const
+	{
+		return { reinterpret_cast<const Stored*>(m_bytes.data() + pool.m_componentsOffset), pool.m_count };
+	}
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	bool fits(uint64_t offset, uint64_t size) const
+	{
+		return offset % C_SCENE_ALIGNMENT == 0 && offset <= m_bytes.size() && size <= m_bytes.size() - offset;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	bool isEntity(entt::entity entity) const
+	{
+		return static_cast<uint32_t>(entity) < m_header.m_entitiesCount;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Entities are in range and every component refers existing entities and strings
+	bool validatePool(const ScenePoolHeader& pool) const
+	{
+		std::vector<bool> owners(m_header.m_entitiesCount);
+		for (const entt::entity entity : entities(pool))
+		{
+			if (!isEntity(entity) || owners[static_cast<uint32_t>(entity)])
+			{
+				return false;
+			}
+			owners[static_cast<uint32_t>(entity)] = true;
+		}
+
+		const auto isLink = [this](entt::entity entity) { return entity == entt::null || isEntity(entity); };
+		switch (static_cast<ScenePool>(pool.m_pool))
+		{
+			case ScenePool::Name:
+				return std::ranges::all_of(components<uint32_t>(pool), [this](uint32_t name) { return name < m_header.m_stringsCount; });
+			case ScenePool::Sprite:
+				return std::ranges::all_of(components<uint32_t>(pool), [this](uint32_t texture) { return texture == C_NO_STRING || texture < m_header.m_stringsCount; });
+			case ScenePool::Hierarchy:
+				return std::ranges::all_of(components<HierarchyComponent>(pool), [&](const HierarchyComponent& hierarchy)
+					{
+						return isLink(hierarchy.m_parent) && isLink(hierarchy.m_firstChild) && isLink(hierarchy.m_prevSibling) && isLink(hierarchy.m_nextSibling);
+					})
+					&& validateHierarchy(pool);
+			default:
+				return true;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Transform update gets transforms and hierarchy of linked and dirty entities without
+	//-- checks, so entities of both pools have all three
+	bool validateTransformOwners(const std::array<const ScenePoolHeader*, static_cast<size_t>(ScenePool::Count)>& pools) const
+	{
+		const auto ownersOf = [&](ScenePool pool)
+		{
+			std::vector<bool> owners(m_header.m_entitiesCount);
+			if (const ScenePoolHeader* header = pools[static_cast<size_t>(pool)])
+			{
+				for (const entt::entity entity : entities(*header))
+				{
+					owners[static_cast<uint32_t>(entity)] = true;
+				}
+			}
+			return owners;
+		};
+		const std::vector<bool> transforms = ownersOf(ScenePool::Transform);
+		const std::vector<bool> worldTransforms = ownersOf(ScenePool::WorldTransform);
+		const std::vector<bool> hierarchies = ownersOf(ScenePool::Hierarchy);
+
+		for (const ScenePool pool : { ScenePool::Hierarchy, ScenePool::TransformDirty })
+		{
+			const ScenePoolHeader* header = pools[static_cast<size_t>(pool)];
+			if (header && !std::ranges::all_of(entities(*header), [&](entt::entity entity)
+				{
+					const uint32_t index = static_cast<uint32_t>(entity);
+					return transforms[index] && worldTransforms[index] && hierarchies[index];
+				}))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Scene walks links without checks, so they have to form a forest: linked entities have
+	//-- hierarchy, both ends of a link agree, depth grows by one from parent to child, so parent
+	//-- links can't cycle, and children chain of every parent reaches all of its children
+	bool validateHierarchy(const ScenePoolHeader& pool) const
+	{
+		constexpr uint32_t C_NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+		const std::span<const entt::entity>       owners = entities(pool);
+		const std::span<const HierarchyComponent> hierarchies = components<HierarchyComponent>(pool);
+		std::vector<uint32_t>                     indices(m_header.m_entitiesCount, C_NO_INDEX);
+		for (uint32_t i = 0; i < owners.size(); ++i)
+		{
+			indices[static_cast<uint32_t>(owners[i])] = i;
+		}
+
+		//-- Links are in entities range already
+		const auto hasHierarchy = [&](entt::entity entity) { return entity == entt::null || indices[static_cast<uint32_t>(entity)] != C_NO_INDEX; };
+		const auto hierarchyOf = [&](entt::entity entity) -> const HierarchyComponent& { return hierarchies[indices[static_cast<uint32_t>(entity)]]; };
+
+		uint32_t childrenCount = 0;
+		for (uint32_t i = 0; i < owners.size(); ++i)
+		{
+			const entt::entity        entity = owners[i];
+			const HierarchyComponent& hierarchy = hierarchies[i];
+			if (!hasHierarchy(hierarchy.m_parent)
+				|| !hasHierarchy(hierarchy.m_firstChild)
+				|| !hasHierarchy(hierarchy.m_prevSibling)
+				|| !hasHierarchy(hierarchy.m_nextSibling))
+			{
+				return false;
+			}
+
+			if (hierarchy.m_parent == entt::null)
+			{
+				//-- Roots aren't linked to each other
+				if (hierarchy.m_depth != 0 || hierarchy.m_prevSibling != entt::null || hierarchy.m_nextSibling != entt::null)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				const HierarchyComponent& parent = hierarchyOf(hierarchy.m_parent);
+				if (hierarchy.m_depth == 0 || parent.m_depth != hierarchy.m_depth - 1)
+				{
+					return false;
+				}
+
+				//-- Previous sibling has the same parent, so next one has it too
+				const bool prevAgrees = hierarchy.m_prevSibling == entt::null
+					? parent.m_firstChild == entity
+					: hierarchyOf(hierarchy.m_prevSibling).m_nextSibling == entity && hierarchyOf(hierarchy.m_prevSibling).m_parent == hierarchy.m_parent;
+				if (!prevAgrees)
+				{
+					return false;
+				}
+				++childrenCount;
+			}
+
+			if ((hierarchy.m_nextSibling != entt::null && hierarchyOf(hierarchy.m_nextSibling).m_prevSibling != entity)
+				|| (hierarchy.m_firstChild != entt::null && (hierarchyOf(hierarchy.m_firstChild).m_parent != entity
+					|| hierarchyOf(hierarchy.m_firstChild).m_prevSibling != entt::null)))
+			{
+				return false;
+			}
+		}
+
+		//-- Chains can't loop back with links agreeing, but siblings linked only to each other
+		//-- in a ring are out of every chain
+		uint32_t chainedCount = 0;
+		for (const HierarchyComponent& hierarchy : hierarchies)
+		{
+			for (entt::entity child = hierarchy.m_firstChild; child != entt::null && chainedCount <= childrenCount; child = hierarchyOf(child).m_nextSibling)
+			{
+				++chainedCount;
+			}
+		}
+		return chainedCount == childrenCount;
+	}
+
+private:
+	std::span<const std::byte>       m_bytes;
+	SceneFileHeader                  m_header;
+	std::span<const ScenePoolHeader> m_pools;
+	std::span<const uint32_t>        m_stringOffsets;
+	const char*                      m_stringBytes = nullptr;
+};
+
+//-------------------------------------------------------------------------------------------------
+void saveScene(const Scene& scene, const AssetRegistry& assetRegistry, const fs_path& path)
+{
+	SceneWriter writer(scene.registry());
+	writer.addPool<EntityName>(ScenePool::Name, [&](const EntityName& name)
+		{
+			return writer.addString(name.m_name);
+		});
+	writer.addPool<TransformComponent>(ScenePool::Transform);
+	writer.addPool<WorldTransformComponent>(ScenePool::WorldTransform);
+	writer.addPool<HierarchyComponent>(ScenePool::Hierarchy, [&](const HierarchyComponent& hierarchy)
+		{
+			return HierarchyComponent{
+				.m_parent = writer.fileId(hierarchy.m_parent)
+				, .m_firstChild = writer.fileId(hierarchy.m_firstChild)
+				, .m_prevSibling = writer.fileId(hierarchy.m_prevSibling)
+				, .m_nextSibling = writer.fileId(hierarchy.m_nextSibling)
+				, .m_depth = hierarchy.m_depth
+			};
+		});
+	writer.addPool<SpriteComponent>(ScenePool::Sprite, [&](const SpriteComponent& sprite)
+		{
+			return sprite.m_texture == C_INVALID_TEXTURE_HANDLE
+				? C_NO_STRING
+				: writer.addString(assetRegistry.texturePath(sprite.m_texture));
+		});
+	writer.addPool<CameraComponent>(ScenePool::Camera);
+	writer.addTagPool<TransformDirtyComponent>(ScenePool::TransformDirty);
+	writer.write(path);
+}
+
+//-------------------------------------------------------------------------------------------------
+bool loadScene(Scene& scene, AssetRegistry& assetRegistry, const fs_path& path)
+{
+	MappedFile  file(path);
+	SceneReader reader;
+	if (!file.isOpen() || !reader.open(file.bytes()))
+	{
+		return false;
+	}
+
+	entt::registry&           registry = scene.registry();
+	std::vector<entt::entity> sceneIds(reader.entitiesCount());
+	registry.create(sceneIds.begin(), sceneIds.end());
+
+	//-- Empty registry hands out the numbers file uses, arrays are inserted right from mapping.
+	//-- Otherwise entities and links between them are translated first
+	bool sameIds = true;
+	for (uint32_t i = 0; i < sceneIds.size() && sameIds; ++i)
+	{
+		sameIds = sceneIds[i] == static_cast<entt::entity>(i);
+	}
+	const auto sceneId = [&](entt::entity entity)
+		{
+			return entity == entt::null ? entity : sceneIds[static_cast<uint32_t>(entity)];
+		};
+
+	std::vector<entt::entity>       translatedIds;
+	std::vector<HierarchyComponent> hierarchies;
+	std::vector<SpriteComponent>    sprites;
+	//-- Texture paths are interned once per string, not once per sprite
+	std::vector<TextureHandle>      textures(reader.stringsCount(), C_INVALID_TEXTURE_HANDLE);
+	for (const ScenePoolHeader& pool : reader.pools())
+	{
+		std::span<const entt::entity> entities = reader.entities(pool);
+		if (!sameIds)
+		{
+			translatedIds.resize(entities.size());
+			std::ranges::transform(entities, translatedIds.begin(), sceneId);
+			entities = translatedIds;
+		}
+
+		switch (static_cast<ScenePool>(pool.m_pool))
+		{
+			case ScenePool::Name:
+			{
+				const std::span<const uint32_t> names = reader.components<uint32_t>(pool);
+				registry.storage<EntityName>().reserve(registry.storage<EntityName>().size() + names.size());
+				for (size_t i = 0; i < names.size(); ++i)
+				{
+					registry.emplace<EntityName>(entities[i], std::string(reader.string(names[i])));
+				}
+				break;
+			}
+			case ScenePool::Transform:
+			{
+				const auto transforms = reader.components<TransformComponent>(pool);
+				registry.insert<TransformComponent>(entities.begin(), entities.end(), transforms.begin());
+				break;
+			}
+			case ScenePool::WorldTransform:
+			{
+				const auto worlds = reader.components<WorldTransformComponent>(pool);
+				registry.insert<WorldTransformComponent>(entities.begin(), entities.end(), worlds.begin());
+				break;
+			}
+			case ScenePool::Hierarchy:
+			{
+				std::span<const HierarchyComponent> links = reader.components<HierarchyComponent>(pool);
+				if (!sameIds)
+				{
+					hierarchies.clear();
+					for (const HierarchyComponent& hierarchy : links)
+					{
+						hierarchies.push_back({
+							.m_parent = sceneId(hierarchy.m_parent)
+							, .m_firstChild = sceneId(hierarchy.m_firstChild)
+							, .m_prevSibling = sceneId(hierarchy.m_prevSibling)
+							, .m_nextSibling = sceneId(hierarchy.m_nextSibling)
+							, .m_depth = hierarchy.m_depth
+						});
+					}
+					links = hierarchies;
+				}
+				registry.insert<HierarchyComponent>(entities.begin(), entities.end(), links.begin());
+				break;
+			}
+			case ScenePool::Sprite:
+			{
+				sprites.clear();
+				for (const uint32_t texture : reader.components<uint32_t>(pool))
+				{
+					if (texture != C_NO_STRING && textures[texture] == C_INVALID_TEXTURE_HANDLE)
+					{
+						textures[texture] = assetRegistry.textureHandle(reader.string(texture));
+					}
+					sprites.push_back({ texture == C_NO_STRING ? C_INVALID_TEXTURE_HANDLE : textures[texture] });
+				}
+				registry.insert<SpriteComponent>(entities.begin(), entities.end(), sprites.begin());
+				break;
+			}
+			case ScenePool::Camera:
+			{
+				const auto cameras = reader.components<CameraComponent>(pool);
+				registry.insert<CameraComponent>(entities.begin(), entities.end(), cameras.begin());
+				break;
+			}
+			case ScenePool::TransformDirty:
+			{
+				registry.insert<TransformDirtyComponent>(entities.begin(), entities.end());
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string textString(std::string_view str)
+{
+	std::string result = "\"";
+	for (const char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			result += std::format("\\u{:04x}", static_cast<unsigned char>(c));
+		}
+		else
+		{
+			result += c;
+		}
+	}
+	result += '"';
+	return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string textEntity(entt::entity entity)
+{
+	return entity == entt::null ? "null" : std::format("{}", static_cast<uint32_t>(entity));
+}
+
+//-------------------------------------------------------------------------------------------------
+bool exportSceneText(const fs_path& scenePath, const fs_path& textPath)
+{
+	MappedFile  file(scenePath);
+	SceneReader reader;
+	if (!file.isOpen() || !reader.open(file.bytes()))
+	{
+		return false;
+	}
+
+	//-- Component index of every entity in every pool, entities are written whole one by one
+	std::array<std::vector<uint32_t>, static_cast<size_t>(ScenePool::Count)> components;
+	std::array<const ScenePoolHeader*, static_cast<size_t>(ScenePool::Count)> pools = {};
+	for (const ScenePoolHeader& pool : reader.pools())
+	{
+		std::vector<uint32_t>& poolComponents = components[pool.m_pool];
+		poolComponents.assign(reader.entitiesCount(), C_NO_COMPONENT);
+		const std::span<const entt::entity> entities = reader.entities(pool);
+		for (uint32_t i = 0; i < entities.size(); ++i)
+		{
+			poolComponents[static_cast<uint32_t>(entities[i])] = i;
+		}
+		pools[pool.m_pool] = &pool;
+	}
+	const auto component = [&](ScenePool pool, uint32_t entity) -> std::optional<uint32_t>
+		{
+			const auto& poolComponents = components[static_cast<size_t>(pool)];
+			if (poolComponents.empty() || poolComponents[entity] == C_NO_COMPONENT)
+			{
+				return std::nullopt;
+			}
+			return poolComponents[entity];
+		};
+
+	std::filesystem::create_directories(textPath.parent_path());
+	std::ofstream out(textPath, std::ios::out | std::ios::trunc);
+	engineAssert(out.is_open(), std::format("Failed to write scene text: {}", textPath.generic_string()));
+	out << std::format("{{\n\t\"version\": {},\n\t\"entities\": [\n", C_SCENE_VERSION);
+
+	std::string line;
+	for (uint32_t entity = 0; entity < reader.entitiesCount(); ++entity)
+	{
+		line = std::format("\t\t{{ \"id\": {}", entity);
+		if (const auto index = component(ScenePool::Name, entity))
+		{
+			const uint32_t name = reader.components<uint32_t>(*pools[static_cast<size_t>(ScenePool::Name)])[*index];
+			line += std::format(", \"name\": {}", textString(reader.string(name)));
+		}
+		if (const auto index = component(ScenePool::Transform, entity))
+		{
+			const TransformComponent& transform = reader.components<TransformComponent>(*pools[static_cast<size_t>(ScenePool::Transform)])[*index];
+			line += std::format(", \"transform\": {{ \"position\": [{}, {}, {}], \"rotation\": {}, \"scale\": [{}, {}], \"pivot\": [{}, {}] }}"
+				, transform.m_position.x
+				, transform.m_position.y
+				, transform.m_position.z
+				, transform.m_rotation
+				, transform.m_scale.x
+				, transform.m_scale.y
+				, transform.m_pivot.x
+				, transform.m_pivot.y);
+		}
+		if (const auto index = component(ScenePool::Hierarchy, entity))
+		{
+			const HierarchyComponent& hierarchy = reader.components<HierarchyComponent>(*pools[static_cast<size_t>(ScenePool::Hierarchy)])[*index];
+			line += std::format(", \"parent\": {}", textEntity(hierarchy.m_parent));
+		}
+		if (const auto index = component(ScenePool::Sprite, entity))
+		{
+			const uint32_t texture = reader.components<uint32_t>(*pools[static_cast<size_t>(ScenePool::Sprite)])[*index];
+			line += std::format(", \"texture\": {}", texture == C_NO_STRING ? std::string("null") : textString(reader.string(texture)));
+		}
+		if (const auto index = component(ScenePool::Camera, entity))
+		{
+			const CameraComponent& camera = reader.components<CameraComponent>(*pools[static_cast<size_t>(ScenePool::Camera)])[*index];
+			line += ", \"camera\": [";
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				line += std::format("{}{}", i == 0 ? "" : ", ", camera.m_cameraMat[i / 4][i % 4]);
+			}
+			line += "]";
+		}
+		if (component(ScenePool::TransformDirty, entity))
+		{
+			line += ", \"transformDirty\": true";
+		}
+		line += entity + 1 < reader.entitiesCount() ? " },\n" : " }\n";
+		out << line;
+	}
+	out << "\t]\n}\n";
+	return true;
+}
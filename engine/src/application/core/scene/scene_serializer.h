@@ -0,0 +1,25 @@
+#pragma once
+
+#include <application/managers/asset_registry.h>
+#include <application/managers/virtual_fs.h>
+
+class Scene;
+
+//-------------------------------------------------------------------------------------------------
+//-- Binary scene: header, pool table, then entities and components of every pool as arrays laid
+//-- out like they are in memory. Strings are kept once in the string table at the end and pools
+//-- refer them by index. Files are mapped and pools are bulk inserted into registry from mapping
+struct SceneFileConfig
+{
+	constexpr static inline auto C_DEFAULT_SCENE = "scenes/main.sscene";
+	constexpr static inline auto C_TEXT_EXTENSION = ".json";
+};
+
+//-------------------------------------------------------------------------------------------------
+void saveScene(const Scene& scene, const AssetRegistry& assetRegistry, const fs_path& path);
+//-- Entities of the file are added to the scene. False when file is missing, damaged or was
+//-- written by another version
+bool loadScene(Scene& scene, AssetRegistry& assetRegistry, const fs_path& path);
+//-- JSON with one entity per line, so versions of a scene can be compared with diff. Cached
+//-- world transforms are left out, they follow from local ones
+bool exportSceneText(const fs_path& scenePath, const fs_path& textPath);
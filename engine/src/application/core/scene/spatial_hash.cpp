@@ -0,0 +1,389 @@
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <print>
+#include <random>
+
+//-------------------------------------------------------------------------------------------------
+bool overlaps(const SpatialBox& a, const SpatialBox& b)
+{
+	return a.m_min.x <= b.m_max.x && b.m_min.x <= a.m_max.x
+		&& a.m_min.y <= b.m_max.y && b.m_min.y <= a.m_max.y;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool overlaps(const SpatialCircle& circle, const SpatialBox& box)
+{
+	const glm::vec2 closest = glm::clamp(circle.m_center, box.m_min, box.m_max);
+	const glm::vec2 offset = circle.m_center - closest;
+	return glm::dot(offset, offset) <= circle.m_radius * circle.m_radius;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::update(entt::entity entity, const SpatialBox& bounds)
+{
+	const uint32_t entityIndex = entt::to_entity(entity);
+	if (entityIndex >= m_locations.size())
+	{
+		m_locations.resize(entityIndex + 1);
+	}
+
+	const uint64_t key = cellKey(bounds);
+	if (const Location& location = m_locations[entityIndex]; location.m_index != C_NOT_INDEXED && location.m_cellKey == key)
+	{
+		m_cells[location.m_cell].m_bounds[location.m_index] = bounds;
+		return;
+	}
+
+	remove(entity);
+	const uint32_t targetIndex = cellIndex(key);
+	Cell&          target = m_cells[targetIndex];
+	m_locations[entityIndex] = { key, targetIndex, static_cast<uint32_t>(target.m_entities.size()) };
+	target.m_bounds.push_back(bounds);
+	target.m_entities.push_back(entity);
+	++m_entitiesCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::remove(entt::entity entity)
+{
+	const uint32_t entityIndex = entt::to_entity(entity);
+	if (entityIndex >= m_locations.size() || m_locations[entityIndex].m_index == C_NOT_INDEXED)
+	{
+		return;
+	}
+
+	//-- Last entity of the cell takes the freed place. Empty cells are kept, moving entities
+	//-- come back to them
+	Location&      location = m_locations[entityIndex];
+	Cell&          source = m_cells[location.m_cell];
+	const uint32_t lastIndex = static_cast<uint32_t>(source.m_entities.size() - 1);
+	if (location.m_index != lastIndex)
+	{
+		source.m_bounds[location.m_index] = source.m_bounds[lastIndex];
+		source.m_entities[location.m_index] = source.m_entities[lastIndex];
+		m_locations[entt::to_entity(source.m_entities[location.m_index])].m_index = location.m_index;
+	}
+	source.m_bounds.pop_back();
+	source.m_entities.pop_back();
+	location.m_index = C_NOT_INDEXED;
+	--m_entitiesCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryBox(const SpatialBox& box, std::vector<entt::entity>& entities) const
+{
+	visit(box, [&box](const SpatialBox& bounds) { return overlaps(box, bounds); }, entities);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryPoint(glm::vec2 point, std::vector<entt::entity>& entities) const
+{
+	queryBox({ point, point }, entities);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryCircle(const SpatialCircle& circle, std::vector<entt::entity>& entities) const
+{
+	const SpatialBox circleBox = { circle.m_center - circle.m_radius, circle.m_center + circle.m_radius };
+	visit(circleBox, [&circle](const SpatialBox& bounds) { return overlaps(circle, bounds); }, entities);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryBoxes(std::span<const SpatialBox> boxes, SpatialQueryResults& results, ThreadPool& threadPool)
+{
+	queryBatch(boxes, results, threadPool, [this](const SpatialBox& box, std::vector<entt::entity>& entities)
+		{
+			queryBox(box, entities);
+		});
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryPoints(std::span<const glm::vec2> points, SpatialQueryResults& results, ThreadPool& threadPool)
+{
+	queryBatch(points, results, threadPool, [this](glm::vec2 point, std::vector<entt::entity>& entities)
+		{
+			queryPoint(point, entities);
+		});
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpatialHash::queryCircles(std::span<const SpatialCircle> circles, SpatialQueryResults& results, ThreadPool& threadPool)
+{
+	queryBatch(circles, results, threadPool, [this](const SpatialCircle& circle, std::vector<entt::entity>& entities)
+		{
+			queryCircle(circle, entities);
+		});
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t SpatialHash::cellCoord(float position) const
+{
+	return static_cast<int32_t>(std::floor(std::clamp(position / m_cellSize, -C_MAX_CELL_COORD, C_MAX_CELL_COORD)));
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t SpatialHash::cellKey(const SpatialBox& bounds) const
+{
+	const glm::vec2 size = bounds.m_max - bounds.m_min;
+	if (size.x > m_cellSize || size.y > m_cellSize)
+	{
+		return C_OVERSIZED_KEY;
+	}
+
+	const glm::vec2 center = (bounds.m_min + bounds.m_max) * 0.5f;
+	return cellKey(cellCoord(center.x), cellCoord(center.y));
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t SpatialHash::cellKey(int32_t x, int32_t y)
+{
+	//-- Biased coordinates are never all ones, so no cell collides with oversized key
+	const uint32_t biasedX = static_cast<uint32_t>(x) + 0x80000000u;
+	const uint32_t biasedY = static_cast<uint32_t>(y) + 0x80000000u;
+	return (static_cast<uint64_t>(biasedX) << 32) | biasedY;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t SpatialHash::cellIndex(uint64_t key)
+{
+	if (key == C_OVERSIZED_KEY)
+	{
+		return C_OVERSIZED_CELL;
+	}
+
+	const auto [it, inserted] = m_cellIndices.try_emplace(key, static_cast<uint32_t>(m_cells.size()));
+	if (inserted)
+	{
+		m_cells.emplace_back();
+	}
+	return it->second;
+}
+
+//-------------------------------------------------------------------------------------------------
+template<typename Test>
+void SpatialHash::visit(const SpatialBox& searchBox, const Test& test, std::vector<entt::entity>& entities) const
+{
+	auto visitCell = [&](const Cell& cell)
+		{
+			for (size_t i = 0; i < cell.m_bounds.size(); ++i)
+			{
+				if (test(cell.m_bounds[i]))
+				{
+					entities.push_back(cell.m_entities[i]);
+				}
+			}
+		};
+
+	visitCell(m_cells[C_OVERSIZED_CELL]);
+
+	//-- Boxes reach half a cell out of their cells, so neighbours of the searched area count too
+	const float   looseness = m_cellSize * 0.5f;
+	const int32_t minX = cellCoord(searchBox.m_min.x - looseness);
+	const int32_t minY = cellCoord(searchBox.m_min.y - looseness);
+	const int32_t maxX = cellCoord(searchBox.m_max.x + looseness);
+	const int32_t maxY = cellCoord(searchBox.m_max.y + looseness);
+
+	//-- Area spanning more cells than exist is cheaper to cover by walking existing ones
+	//-- Coordinates clamp to +-2^30, span of a huge box doesn't fit int32
+	const uint64_t searchedCells = static_cast<uint64_t>(static_cast<int64_t>(maxX) - minX + 1)
+		* static_cast<uint64_t>(static_cast<int64_t>(maxY) - minY + 1);
+	if (searchedCells >= m_cells.size())
+	{
+		for (uint32_t cell = C_OVERSIZED_CELL + 1; cell < m_cells.size(); ++cell)
+		{
+			visitCell(m_cells[cell]);
+		}
+		return;
+	}
+
+	for (int32_t y = minY; y <= maxY; ++y)
+	{
+		for (int32_t x = minX; x <= maxX; ++x)
+		{
+			if (auto it = m_cellIndices.find(cellKey(x, y)); it != m_cellIndices.end())
+			{
+				visitCell(m_cells[it->second]);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+template<typename Query, typename Find>
+void SpatialHash::queryBatch(std::span<const Query> queries, SpatialQueryResults& results, ThreadPool& threadPool, const Find& find)
+{
+	const uint32_t queriesCount = static_cast<uint32_t>(queries.size());
+	results.m_offsets.resize(queriesCount + 1);
+	m_rangeResults.resize(threadPool.rangesCount(queriesCount, C_MIN_QUERIES_PER_TASK));
+
+	//-- Offsets are relative to range results first
+	threadPool.parallelFor(queriesCount, C_MIN_QUERIES_PER_TASK, [&](uint32_t range, uint32_t first, uint32_t last)
+		{
+			RangeResults& rangeResults = m_rangeResults[range];
+			rangeResults.m_firstQuery = first;
+			rangeResults.m_entities.clear();
+			for (uint32_t query = first; query < last; ++query)
+			{
+				results.m_offsets[query] = static_cast<uint32_t>(rangeResults.m_entities.size());
+				find(queries[query], rangeResults.m_entities);
+			}
+		});
+
+	//-- Ranges go in query order, so their results are concatenated and offsets shifted
+	results.m_entities.clear();
+	for (size_t range = 0; range < m_rangeResults.size(); ++range)
+	{
+		const RangeResults& rangeResults = m_rangeResults[range];
+		const uint32_t      lastQuery = range + 1 < m_rangeResults.size() ? m_rangeResults[range + 1].m_firstQuery : queriesCount;
+		const uint32_t      shift = static_cast<uint32_t>(results.m_entities.size());
+		for (uint32_t query = rangeResults.m_firstQuery; query < lastQuery; ++query)
+		{
+			results.m_offsets[query] += shift;
+		}
+		results.m_entities.insert(results.m_entities.end(), rangeResults.m_entities.begin(), rangeResults.m_entities.end());
+	}
+	results.m_offsets[queriesCount] = static_cast<uint32_t>(results.m_entities.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+void benchmarkSpatialHash(ThreadPool& threadPool)
+{
+	constexpr std::array<uint32_t, 3> C_ENTITIES_COUNTS = { 10'000, 100'000, 1'000'000 };
+	constexpr std::array<float, 2>    C_MOVING_SHARES = { 0.01f, 0.1f };
+	constexpr uint32_t                C_FRAMES_COUNT = 8;
+	//-- Of every kind per frame, box and circle ones are about a screen of sprites
+	constexpr uint32_t                C_QUERIES_COUNT = 64;
+	constexpr uint32_t                C_SEED = 1337;
+
+	using Clock = std::chrono::steady_clock;
+	auto elapsedMs = [](Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		};
+
+	for (const uint32_t entitiesCount : C_ENTITIES_COUNTS)
+	{
+		for (const float movingShare : C_MOVING_SHARES)
+		{
+			//-- Density of about one unit sprite per square unit at any entities count
+			const float                           worldHalfSize = std::sqrt(static_cast<float>(entitiesCount)) * 0.5f;
+			std::mt19937                          random(C_SEED);
+			std::uniform_real_distribution<float> worldCoord(-worldHalfSize, worldHalfSize);
+			std::uniform_real_distribution<float> halfExtent(0.1f, 0.5f);
+			std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+			std::uniform_int_distribution<uint32_t> entityIndex(0, entitiesCount - 1);
+
+			//-- Brute force scans these arrays, which is what walking the registry comes down to
+			std::vector<SpatialBox> bounds(entitiesCount);
+			SpatialHash             spatialHash;
+			for (uint32_t i = 0; i < entitiesCount; ++i)
+			{
+				const glm::vec2 center = { worldCoord(random), worldCoord(random) };
+				const glm::vec2 extent = { halfExtent(random), halfExtent(random) };
+				bounds[i] = { center - extent, center + extent };
+				spatialHash.update(static_cast<entt::entity>(i), bounds[i]);
+			}
+
+			std::vector<SpatialBox>    boxes(C_QUERIES_COUNT);
+			std::vector<glm::vec2>     points(C_QUERIES_COUNT);
+			std::vector<SpatialCircle> circles(C_QUERIES_COUNT);
+			SpatialQueryResults        boxResults;
+			SpatialQueryResults        pointResults;
+			SpatialQueryResults        circleResults;
+			//-- Per query of every kind, each query is scanned by one thread
+			std::vector<std::vector<entt::entity>> bruteFound(C_QUERIES_COUNT * 3);
+			std::vector<entt::entity>              sortedFound;
+
+			double   updateMs = 0.0;
+			double   queryMs = 0.0;
+			double   bruteMs = 0.0;
+			uint32_t differentQueries = 0;
+			for (uint32_t frame = 0; frame < C_FRAMES_COUNT; ++frame)
+			{
+				const uint32_t movingCount = static_cast<uint32_t>(static_cast<float>(entitiesCount) * movingShare);
+				const auto     updateStart = Clock::now();
+				for (uint32_t moved = 0; moved < movingCount; ++moved)
+				{
+					const uint32_t  i = entityIndex(random);
+					const glm::vec2 offset = { step(random), step(random) };
+					bounds[i] = { bounds[i].m_min + offset, bounds[i].m_max + offset };
+					spatialHash.update(static_cast<entt::entity>(i), bounds[i]);
+				}
+				updateMs += elapsedMs(updateStart);
+
+				for (uint32_t query = 0; query < C_QUERIES_COUNT; ++query)
+				{
+					const glm::vec2 center = { worldCoord(random), worldCoord(random) };
+					boxes[query] = { center - glm::vec2(2.0f, 1.5f), center + glm::vec2(2.0f, 1.5f) };
+					points[query] = { worldCoord(random), worldCoord(random) };
+					circles[query] = { { worldCoord(random), worldCoord(random) }, 2.0f };
+				}
+
+				const auto queryStart = Clock::now();
+				spatialHash.queryBoxes(boxes, boxResults, threadPool);
+				spatialHash.queryPoints(points, pointResults, threadPool);
+				spatialHash.queryCircles(circles, circleResults, threadPool);
+				queryMs += elapsedMs(queryStart);
+
+				//-- Same split over threads, one query per range item
+				const auto bruteStart = Clock::now();
+				threadPool.parallelFor(C_QUERIES_COUNT, 1, [&](uint32_t, uint32_t first, uint32_t last)
+					{
+						for (uint32_t query = first; query < last; ++query)
+						{
+							std::vector<entt::entity>& boxFound = bruteFound[query];
+							std::vector<entt::entity>& pointFound = bruteFound[C_QUERIES_COUNT + query];
+							std::vector<entt::entity>& circleFound = bruteFound[C_QUERIES_COUNT * 2 + query];
+							boxFound.clear();
+							pointFound.clear();
+							circleFound.clear();
+
+							const SpatialBox pointBox = { points[query], points[query] };
+							for (uint32_t i = 0; i < entitiesCount; ++i)
+							{
+								if (overlaps(boxes[query], bounds[i]))
+								{
+									boxFound.push_back(static_cast<entt::entity>(i));
+								}
+								if (overlaps(pointBox, bounds[i]))
+								{
+									pointFound.push_back(static_cast<entt::entity>(i));
+								}
+								if (overlaps(circles[query], bounds[i]))
+								{
+									circleFound.push_back(static_cast<entt::entity>(i));
+								}
+							}
+						}
+					});
+				bruteMs += elapsedMs(bruteStart);
+
+				//-- Index returns entities in no particular order, brute force in index order
+				const std::array<const SpatialQueryResults*, 3> kindResults = { &boxResults, &pointResults, &circleResults };
+				for (uint32_t kind = 0; kind < kindResults.size(); ++kind)
+				{
+					for (uint32_t query = 0; query < C_QUERIES_COUNT; ++query)
+					{
+						const std::span<const entt::entity> found = kindResults[kind]->found(query);
+						sortedFound.assign(found.begin(), found.end());
+						std::ranges::sort(sortedFound);
+						differentQueries += sortedFound == bruteFound[C_QUERIES_COUNT * kind + query] ? 0 : 1;
+					}
+				}
+			}
+
+			std::println("{:>8} entities, {:>2.0f}% moving: index update {:.3f} ms, index queries {:.3f} ms, brute force {:.3f} ms per frame{}"
+				, entitiesCount
+				, movingShare * 100.0f
+				, updateMs / C_FRAMES_COUNT
+				, queryMs / C_FRAMES_COUNT
+				, bruteMs / C_FRAMES_COUNT
+				, differentQueries == 0 ? "" : std::format(", {} QUERIES DIFFER", differentQueries));
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <entt/entity/entity.hpp>
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <application/core/utils/thread_pool.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Axis aligned box in world xy plane, depth doesn't take part in spatial queries
+struct SpatialBox
+{
+	glm::vec2 m_min = { 0.0f, 0.0f };
+	glm::vec2 m_max = { 0.0f, 0.0f };
+};
+
+//-------------------------------------------------------------------------------------------------
+struct SpatialCircle
+{
+	glm::vec2 m_center = { 0.0f, 0.0f };
+	float     m_radius = 0.0f;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Entities found by batched queries, query i found [m_offsets[i], m_offsets[i + 1])
+struct SpatialQueryResults
+{
+	std::span<const entt::entity> found(uint32_t query) const
+	{
+		return std::span(m_entities).subspan(m_offsets[query], m_offsets[query + 1] - m_offsets[query]);
+	}
+
+	std::vector<entt::entity> m_entities;
+	std::vector<uint32_t>     m_offsets;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Loose grid of square cells hashed by their coordinates, only cells entities visited exist.
+//-- Entity lives in the cell of its box center, so boxes stick out of their cells by up to
+//-- half a cell and queries look that much further. Boxes bigger than a cell are kept aside
+//-- and tested by every query. Moving inside a cell only rewrites the box, crossing cells
+//-- is a swap remove from one and append to another. Results come in no particular order
+class SpatialHash
+{
+public:
+	constexpr static float C_DEFAULT_CELL_SIZE = 2.0f;
+
+	explicit SpatialHash(float cellSize = C_DEFAULT_CELL_SIZE) : m_cellSize(cellSize), m_cells(1) {}
+
+	//-- Indexes entity or moves it to new bounds
+	void update(entt::entity entity, const SpatialBox& bounds);
+	void remove(entt::entity entity);
+	uint32_t size() const { return m_entitiesCount; }
+
+	//-- Found entities are appended to the output
+	void queryBox(const SpatialBox& box, std::vector<entt::entity>& entities) const;
+	void queryPoint(glm::vec2 point, std::vector<entt::entity>& entities) const;
+	void queryCircle(const SpatialCircle& circle, std::vector<entt::entity>& entities) const;
+
+	//-- Queries are split into ranges over worker threads. Range storage is kept between calls,
+	//-- so only one batch runs at a time
+	void queryBoxes(std::span<const SpatialBox> boxes, SpatialQueryResults& results, ThreadPool& threadPool);
+	void queryPoints(std::span<const glm::vec2> points, SpatialQueryResults& results, ThreadPool& threadPool);
+	void queryCircles(std::span<const SpatialCircle> circles, SpatialQueryResults& results, ThreadPool& threadPool);
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct Cell
+	{
+		std::vector<SpatialBox>   m_bounds;
+		std::vector<entt::entity> m_entities;
+	};
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Where entity is stored, indexed by entity index
+	struct Location
+	{
+		uint64_t m_cellKey = 0;
+		uint32_t m_cell = 0;
+		uint32_t m_index = C_NOT_INDEXED;
+	};
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Results of one range of batched queries
+	struct RangeResults
+	{
+		uint32_t                  m_firstQuery = 0;
+		std::vector<entt::entity> m_entities;
+	};
+
+	constexpr static uint32_t C_NOT_INDEXED = std::numeric_limits<uint32_t>::max();
+	//-- Key of entities bigger than a cell, biased grid cell keys never reach it
+	constexpr static uint64_t C_OVERSIZED_KEY = std::numeric_limits<uint64_t>::max();
+	//-- First cell holds entities bigger than a cell
+	constexpr static uint32_t C_OVERSIZED_CELL = 0;
+	//-- Cell coordinates stay far from int32 limits, huge boxes are clamped to that
+	constexpr static float    C_MAX_CELL_COORD = static_cast<float>(1 << 30);
+	//-- Every query walks cells and tests boxes, so even small ranges are worth handing over
+	constexpr static uint32_t C_MIN_QUERIES_PER_TASK = 16;
+
+	int32_t cellCoord(float position) const;
+	uint64_t cellKey(const SpatialBox& bounds) const;
+	static uint64_t cellKey(int32_t x, int32_t y);
+	//-- Index of cell with the key, created when it doesn't exist yet
+	uint32_t cellIndex(uint64_t key);
+	//-- Calls test for every entity whose box may overlap searchBox, appends entities it accepts
+	template<typename Test>
+	void visit(const SpatialBox& searchBox, const Test& test, std::vector<entt::entity>& entities) const;
+	template<typename Query, typename Find>
+	void queryBatch(std::span<const Query> queries, SpatialQueryResults& results, ThreadPool& threadPool, const Find& find);
+
+private:
+	float                                   m_cellSize = C_DEFAULT_CELL_SIZE;
+	//-- Cells are only hashed when entity crosses into another one, moves inside a cell and
+	//-- walks over all cells use the array
+	std::vector<Cell>                       m_cells;
+	absl::flat_hash_map<uint64_t, uint32_t> m_cellIndices;
+	std::vector<Location>                   m_locations;
+	uint32_t                                m_entitiesCount = 0;
+	std::vector<RangeResults>               m_rangeResults;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Compares index against brute force scan of all boxes at 10k to 1M entities with 1% and 10%
+//-- of them moving per frame, prints timings of both
+void benchmarkSpatialHash(ThreadPool& threadPool);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+//-------------------------------------------------------------------------------------------------
+//-- Single producer to single consumer handoff. Producer blocks while queue is full, so it never
+//-- runs more than capacity items ahead. Items pushed before close are still popped
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(uint32_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	//-------------------------------------------------------------------------------------------------
+	//-- False if queue was closed, item is dropped then
+	bool push(T item)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_itemPopped.wait(lock, [this]() { return m_closed || m_items.size() < m_capacity; });
+			if (m_closed)
+			{
+				return false;
+			}
+			m_items.push_back(std::move(item));
+		}
+		m_itemPushed.notify_one();
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Empty only when queue is closed and drained
+	std::optional<T> pop()
+	{
+		std::optional<T> item;
+		{
+			std::unique_lock lock(m_mutex);
+			m_itemPushed.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+			if (m_items.empty())
+			{
+				return std::nullopt;
+			}
+			item.emplace(std::move(m_items.front()));
+			m_items.pop_front();
+		}
+		m_itemPopped.notify_one();
+		return item;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	void close()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_closed = true;
+		}
+		m_itemPushed.notify_all();
+		m_itemPopped.notify_all();
+	}
+
+	uint32_t capacity() const { return m_capacity; }
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_itemPushed;
+	std::condition_variable m_itemPopped;
+	std::deque<T>           m_items;
+	const uint32_t          m_capacity;
+	bool                    m_closed = false;
+};
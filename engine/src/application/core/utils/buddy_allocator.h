@@ -0,0 +1,123 @@
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <algorithm>
+
+//-------------------------------------------------------------------------------------------------
+//-- Binary buddy allocator over abstract offsets. Range size is a power of two, every
+//-- allocation is rounded up to power of two and placed at offset multiple of its size,
+//-- so any power of two alignment up to the allocation size comes for free
+class BuddyAllocator
+{
+public:
+	constexpr static inline uint64_t C_MIN_ALLOCATION_SIZE = 256;
+
+	//-------------------------------------------------------------------------------------------------
+	explicit BuddyAllocator(uint64_t size)
+		: m_size(size)
+	{
+		const uint32_t maxOrder = orderOf(size);
+		m_freeLists.resize(maxOrder + 1);
+		m_freeLists[maxOrder].insert(0);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment)
+	{
+		const uint32_t order = orderOf(std::max({ size, alignment, C_MIN_ALLOCATION_SIZE }));
+		if (order >= m_freeLists.size())
+		{
+			return std::nullopt;
+		}
+
+		//-- Smallest free block that fits, split down to requested order
+		uint32_t freeOrder = order;
+		while (freeOrder < m_freeLists.size() && m_freeLists[freeOrder].empty())
+		{
+			++freeOrder;
+		}
+		if (freeOrder == m_freeLists.size())
+		{
+			return std::nullopt;
+		}
+
+		const uint64_t offset = *m_freeLists[freeOrder].begin();
+		m_freeLists[freeOrder].erase(offset);
+		while (freeOrder > order)
+		{
+			--freeOrder;
+			m_freeLists[freeOrder].insert(offset + orderSize(freeOrder));
+		}
+
+		m_allocatedOrders.insert({ offset, order });
+		m_usedSize += orderSize(order);
+		return offset;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	void free(uint64_t offset)
+	{
+		auto it = m_allocatedOrders.find(offset);
+		if (it == m_allocatedOrders.end())
+		{
+			return;
+		}
+
+		uint32_t order = it->second;
+		m_allocatedOrders.erase(it);
+		m_usedSize -= orderSize(order);
+
+		//-- Merge with free buddy while possible
+		while (order + 1 < m_freeLists.size())
+		{
+			const uint64_t buddy = offset ^ orderSize(order);
+			if (!m_freeLists[order].erase(buddy))
+			{
+				break;
+			}
+			offset = std::min(offset, buddy);
+			++order;
+		}
+		m_freeLists[order].insert(offset);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	template<typename Func>
+	void forEachAllocation(Func&& func) const
+	{
+		for (const auto& [offset, order] : m_allocatedOrders)
+		{
+			func(offset, orderSize(order));
+		}
+	}
+
+	uint64_t size() const { return m_size; }
+	uint64_t usedSize() const { return m_usedSize; }
+	uint32_t allocationsCount() const { return static_cast<uint32_t>(m_allocatedOrders.size()); }
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	static uint32_t orderOf(uint64_t size)
+	{
+		const uint64_t rounded = std::bit_ceil(std::max(size, C_MIN_ALLOCATION_SIZE));
+		return static_cast<uint32_t>(std::countr_zero(rounded) - std::countr_zero(C_MIN_ALLOCATION_SIZE));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	static uint64_t orderSize(uint32_t order)
+	{
+		return C_MIN_ALLOCATION_SIZE << order;
+	}
+
+private:
+	std::vector<absl::flat_hash_set<uint64_t>> m_freeLists;
+	absl::flat_hash_map<uint64_t, uint32_t>    m_allocatedOrders;
+	uint64_t                                   m_size = 0;
+	uint64_t                                   m_usedSize = 0;
+};
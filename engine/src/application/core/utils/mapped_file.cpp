@@ -0,0 +1,95 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+//-------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	m_file = file;
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		return;
+	}
+
+	m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = m_data != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file != nullptr)
+	{
+		CloseHandle(m_file);
+	}
+}
+
+#else
+
+//-------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	//-- Mapping keeps the file referenced, descriptor is not needed after it
+	struct stat info = {};
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			//-- Files are read front to back right after mapping
+			madvise(data, static_cast<size_t>(info.st_size), MADV_WILLNEED);
+			m_data = static_cast<const std::byte*>(data);
+			m_size = static_cast<size_t>(info.st_size);
+		}
+	}
+	close(file);
+}
+
+//-------------------------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+//-------------------------------------------------------------------------------------------------
+//-- Whole file mapped read only, pages are brought in by OS as they are touched and nothing is
+//-- copied into process buffers. Bytes stay valid while the object is alive
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//-- Missing and empty files are not mapped
+	bool isOpen() const { return m_data != nullptr; }
+	std::span<const std::byte> bytes() const { return { m_data, m_size }; }
+
+private:
+	const std::byte* m_data = nullptr;
+	size_t           m_size = 0;
+#ifdef _WIN32
+	void*            m_file = nullptr;
+	void*            m_mapping = nullptr;
+#endif
+};
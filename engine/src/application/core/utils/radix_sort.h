@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include <application/core/utils/thread_pool.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Sorting is done over small key + index pairs, payload is gathered by index afterwards
+struct RadixSortItem
+{
+	uint64_t m_key;
+	uint32_t m_index;
+};
+
+constexpr uint32_t C_RADIX_DIGIT_BITS = 8;
+constexpr uint32_t C_RADIX_BUCKETS_COUNT = 1 << C_RADIX_DIGIT_BITS;
+constexpr uint32_t C_RADIX_PASSES_COUNT = sizeof(uint64_t) * 8 / C_RADIX_DIGIT_BITS;
+
+//-------------------------------------------------------------------------------------------------
+//-- Digit counts of one range of items in parallel sort
+using RadixHistogram = std::array<uint32_t, C_RADIX_BUCKETS_COUNT>;
+
+//-------------------------------------------------------------------------------------------------
+//-- Stable LSD radix sort by 8 bit digits. All digit histograms are built with one read of
+//-- the input and passes where every key has the same digit are skipped, so keys using only
+//-- a part of 64 bits pay only for the digits that actually differ.
+//-- scratch is kept by caller to avoid allocations between frames
+inline void radixSort(std::vector<RadixSortItem>& items, std::vector<RadixSortItem>& scratch)
+{
+	const size_t itemsCount = items.size();
+	if (itemsCount < 2)
+	{
+		return;
+	}
+	scratch.resize(itemsCount);
+
+	std::array<std::array<uint32_t, C_RADIX_BUCKETS_COUNT>, C_RADIX_PASSES_COUNT> histograms = {};
+	for (const RadixSortItem& item : items)
+	{
+		for (uint32_t pass = 0; pass < C_RADIX_PASSES_COUNT; ++pass)
+		{
+			++histograms[pass][(item.m_key >> (pass * C_RADIX_DIGIT_BITS)) & (C_RADIX_BUCKETS_COUNT - 1)];
+		}
+	}
+
+	for (uint32_t pass = 0; pass < C_RADIX_PASSES_COUNT; ++pass)
+	{
+		const uint32_t shift = pass * C_RADIX_DIGIT_BITS;
+		auto&          histogram = histograms[pass];
+
+		//-- All keys share this digit, order can't change
+		if (histogram[(items[0].m_key >> shift) & (C_RADIX_BUCKETS_COUNT - 1)] == itemsCount)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram)
+		{
+			const uint32_t count = bucket;
+			bucket = offset;
+			offset += count;
+		}
+
+		for (const RadixSortItem& item : items)
+		{
+			scratch[histogram[(item.m_key >> shift) & (C_RADIX_BUCKETS_COUNT - 1)]++] = item;
+		}
+		std::swap(items, scratch);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Same stable sort split into contiguous ranges over thread pool. Every pass counts digits
+//-- of each range, then each range scatters its items from own offsets, so no slot is written
+//-- twice. Skipped passes are found from the first counting, which the first pass reuses.
+//-- Few items are sorted by calling thread alone
+inline void parallelRadixSort(std::vector<RadixSortItem>&    items
+                              , std::vector<RadixSortItem>&  scratch
+                              , std::vector<RadixHistogram>& rangeHistograms
+                              , ThreadPool&                  threadPool
+                              , uint32_t                     minRangeSize)
+{
+	const uint32_t itemsCount = static_cast<uint32_t>(items.size());
+	const uint32_t rangesCount = threadPool.rangesCount(itemsCount, minRangeSize);
+	if (rangesCount <= 1)
+	{
+		radixSort(items, scratch);
+		return;
+	}
+	scratch.resize(itemsCount);
+	rangeHistograms.resize(rangesCount * C_RADIX_PASSES_COUNT);
+
+	auto digit = [](uint64_t key, uint32_t pass)
+		{
+			return static_cast<uint32_t>(key >> (pass * C_RADIX_DIGIT_BITS)) & (C_RADIX_BUCKETS_COUNT - 1);
+		};
+
+	threadPool.parallelFor(itemsCount, minRangeSize, [&](uint32_t range, uint32_t first, uint32_t last)
+		{
+			RadixHistogram* histograms = &rangeHistograms[range * C_RADIX_PASSES_COUNT];
+			std::fill(histograms, histograms + C_RADIX_PASSES_COUNT, RadixHistogram{});
+			for (uint32_t i = first; i < last; ++i)
+			{
+				for (uint32_t pass = 0; pass < C_RADIX_PASSES_COUNT; ++pass)
+				{
+					++histograms[pass][digit(items[i].m_key, pass)];
+				}
+			}
+		});
+
+	//-- Whether all keys share a digit doesn't depend on order, first key stands for all of them
+	const uint64_t firstKey = items[0].m_key;
+	bool           countsCurrent = true;
+	for (uint32_t pass = 0; pass < C_RADIX_PASSES_COUNT; ++pass)
+	{
+		uint32_t firstDigitCount = 0;
+		for (uint32_t range = 0; range < rangesCount; ++range)
+		{
+			firstDigitCount += rangeHistograms[range * C_RADIX_PASSES_COUNT + pass][digit(firstKey, pass)];
+		}
+		if (firstDigitCount == itemsCount)
+		{
+			continue;
+		}
+
+		//-- Ranges hold other items once order changed, their counts are taken again
+		if (!countsCurrent)
+		{
+			threadPool.parallelFor(itemsCount, minRangeSize, [&](uint32_t range, uint32_t first, uint32_t last)
+				{
+					RadixHistogram& histogram = rangeHistograms[range * C_RADIX_PASSES_COUNT + pass];
+					histogram = {};
+					for (uint32_t i = first; i < last; ++i)
+					{
+						++histogram[digit(items[i].m_key, pass)];
+					}
+				});
+		}
+
+		//-- Bucket by bucket, earlier ranges go first inside every bucket to keep sort stable
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < C_RADIX_BUCKETS_COUNT; ++bucket)
+		{
+			for (uint32_t range = 0; range < rangesCount; ++range)
+			{
+				uint32_t&      rangeBucket = rangeHistograms[range * C_RADIX_PASSES_COUNT + pass][bucket];
+				const uint32_t count = rangeBucket;
+				rangeBucket = offset;
+				offset += count;
+			}
+		}
+
+		threadPool.parallelFor(itemsCount, minRangeSize, [&](uint32_t range, uint32_t first, uint32_t last)
+			{
+				RadixHistogram& offsets = rangeHistograms[range * C_RADIX_PASSES_COUNT + pass];
+				for (uint32_t i = first; i < last; ++i)
+				{
+					scratch[offsets[digit(items[i].m_key, pass)]++] = items[i];
+				}
+			});
+		std::swap(items, scratch);
+		countsCurrent = false;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+//-------------------------------------------------------------------------------------------------
+//-- Every distinct string is stored once and referred by dense 32 bit id. Ids and views
+//-- returned by resolve stay valid for interner lifetime. Both calls lock, so strings are
+//-- interned once when they are assigned and ids are passed around afterwards
+class StringInterner
+{
+public:
+	using Id = uint32_t;
+	constexpr static Id C_INVALID_ID = std::numeric_limits<Id>::max();
+
+	StringInterner() = default;
+	StringInterner(const StringInterner&) = delete;
+	StringInterner& operator=(const StringInterner&) = delete;
+
+	//-------------------------------------------------------------------------------------------------
+	Id intern(std::string_view str)
+	{
+		std::lock_guard lock(m_mutex);
+		if (auto it = m_ids.find(str); it != m_ids.end())
+		{
+			return it->second;
+		}
+
+		//-- Deque never moves stored strings, so map keys can view them
+		const Id id = static_cast<Id>(m_strings.size());
+		const std::string_view stored = m_strings.emplace_back(str);
+		m_ids.insert({ stored, id });
+		return id;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Empty for invalid or unknown id
+	std::string_view resolve(Id id) const
+	{
+		std::lock_guard lock(m_mutex);
+		return id < m_strings.size() ? std::string_view(m_strings[id]) : std::string_view();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	uint32_t size() const
+	{
+		std::lock_guard lock(m_mutex);
+		return static_cast<uint32_t>(m_strings.size());
+	}
+
+private:
+	mutable std::mutex                          m_mutex;
+	std::deque<std::string>                     m_strings;
+	absl::flat_hash_map<std::string_view, Id>   m_ids;
+};
@@ -0,0 +1,155 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+//-------------------------------------------------------------------------------------------------
+ThreadPool::ThreadPool(uint32_t threadsCount, uint32_t parallelThreads)
+{
+	if (threadsCount == 0)
+	{
+		threadsCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+	m_parallelThreads = parallelThreads == 0 ? threadsCount + 1 : std::min(parallelThreads, threadsCount + 1);
+	m_parallelJobs.reserve(C_RESERVED_PARALLEL_JOBS);
+
+	m_workers.reserve(threadsCount);
+	for (uint32_t i = 0; i < threadsCount; ++i)
+	{
+		m_workers.emplace_back([this](std::stop_token stopToken) { workerLoop(stopToken); });
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+	for (auto& worker : m_workers)
+	{
+		worker.request_stop();
+	}
+	m_workers.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+void ThreadPool::submit(Task task)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskAdded.notify_one();
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t ThreadPool::rangesCount(uint32_t itemsCount, uint32_t minRangeSize) const
+{
+	const uint32_t rangeSize = std::max(minRangeSize, 1u);
+	return std::min(m_parallelThreads, (itemsCount + rangeSize - 1) / rangeSize);
+}
+
+//-------------------------------------------------------------------------------------------------
+void ThreadPool::runParallelFor(uint32_t itemsCount, uint32_t minRangeSize, void* context, RangeCallback callback)
+{
+	const uint32_t rangesCount = this->rangesCount(itemsCount, minRangeSize);
+	if (rangesCount <= 1)
+	{
+		if (itemsCount > 0)
+		{
+			callback(context, 0, 0, itemsCount);
+		}
+		return;
+	}
+
+	ParallelForJob job;
+	job.m_rangesCount = rangesCount;
+	job.m_itemsCount = itemsCount;
+	job.m_context = context;
+	job.m_callback = callback;
+	{
+		std::lock_guard lock(m_mutex);
+		m_parallelJobs.push_back(&job);
+	}
+	for (uint32_t range = 1; range < rangesCount; ++range)
+	{
+		m_taskAdded.notify_one();
+	}
+
+	//-- Loop ends with every range claimed, so workers coming later have nothing to take
+	runRanges(job);
+
+	std::unique_lock lock(m_mutex);
+	std::erase(m_parallelJobs, &job);
+	m_helpersFinished.wait(lock, [&job]() { return job.m_helpersCount == 0; });
+}
+
+//-------------------------------------------------------------------------------------------------
+void ThreadPool::runRanges(ParallelForJob& job)
+{
+	for (uint32_t range = job.m_nextRange++; range < job.m_rangesCount; range = job.m_nextRange++)
+	{
+		const uint64_t itemsCount = job.m_itemsCount;
+		const uint32_t first = static_cast<uint32_t>(itemsCount * range / job.m_rangesCount);
+		const uint32_t last = static_cast<uint32_t>(itemsCount * (range + 1) / job.m_rangesCount);
+		job.m_callback(job.m_context, range, first, last);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+ThreadPool::ParallelForJob* ThreadPool::claimableJob() const
+{
+	for (ParallelForJob* job : m_parallelJobs)
+	{
+		if (job->m_nextRange.load(std::memory_order_relaxed) < job->m_rangesCount)
+		{
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+void ThreadPool::workerLoop(std::stop_token stopToken)
+{
+	while (!stopToken.stop_requested())
+	{
+		Task            task;
+		ParallelForJob* job = nullptr;
+		{
+			std::unique_lock lock(m_mutex);
+			//-- Waiting parallelFor callers go before queued background tasks
+			const bool woken = m_taskAdded.wait(lock, stopToken, [this, &job]()
+				{
+					job = claimableJob();
+					return job != nullptr || !m_tasks.empty();
+				});
+			if (!woken)
+			{
+				return;
+			}
+
+			if (job)
+			{
+				++job->m_helpersCount;
+			}
+			else
+			{
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+		}
+
+		if (!job)
+		{
+			task();
+			continue;
+		}
+
+		runRanges(*job);
+
+		//-- Notified under lock, caller can't destroy the job before it is released
+		std::lock_guard lock(m_mutex);
+		if (--job->m_helpersCount == 0)
+		{
+			m_helpersFinished.notify_all();
+		}
+	}
+}
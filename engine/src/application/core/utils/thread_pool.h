@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------
+//-- Fixed set of worker threads taking tasks in submission order.
+//-- Tasks left in queue on destruction are dropped, running ones are finished
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	//-- Zero threads means all hardware threads except the main one. Parallel threads bound
+	//-- threads splitting one parallelFor, calling thread included, zero uses all of them
+	explicit ThreadPool(uint32_t threadsCount = 0, uint32_t parallelThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(Task task);
+	uint32_t threadsCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	//-- How many ranges parallelFor splits items into, each has at least minRangeSize items
+	//-- except when there are fewer items in total. Callers size per range outputs by it
+	uint32_t rangesCount(uint32_t itemsCount, uint32_t minRangeSize) const;
+	//-- Runs task(range, first, last) over ranges of items on workers and calling thread,
+	//-- returns once all ranges are done. Idle workers claim ranges by counter, so workers busy
+	//-- with background tasks never stall the caller, it just takes their ranges. Task is
+	//-- called by reference and nothing is allocated per call
+	template<typename RangeTask>
+	void parallelFor(uint32_t itemsCount, uint32_t minRangeSize, RangeTask&& task)
+	{
+		using TaskType = std::remove_reference_t<RangeTask>;
+		runParallelFor(itemsCount, minRangeSize, const_cast<void*>(static_cast<const void*>(&task))
+			, [](void* context, uint32_t range, uint32_t first, uint32_t last)
+			{
+				(*static_cast<TaskType*>(context))(range, first, last);
+			});
+	}
+
+private:
+	using RangeCallback = void (*)(void* context, uint32_t range, uint32_t first, uint32_t last);
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Lives on the stack of parallelFor caller. Workers find it in m_parallelJobs and count
+	//-- themselves as helpers under pool mutex, caller returns only when no helper is left
+	struct ParallelForJob
+	{
+		std::atomic<uint32_t> m_nextRange = 0;
+		uint32_t              m_rangesCount = 0;
+		uint32_t              m_itemsCount = 0;
+		void*                 m_context = nullptr;
+		RangeCallback         m_callback = nullptr;
+		//-- Guarded by pool mutex
+		uint32_t              m_helpersCount = 0;
+	};
+
+	void runParallelFor(uint32_t itemsCount, uint32_t minRangeSize, void* context, RangeCallback callback);
+	static void runRanges(ParallelForJob& job);
+	//-- Job with ranges nobody claimed yet, pool mutex has to be locked
+	ParallelForJob* claimableJob() const;
+	void workerLoop(std::stop_token stopToken);
+
+private:
+	//-- Main and render threads, nested calls from tasks on top
+	constexpr static inline uint32_t C_RESERVED_PARALLEL_JOBS = 8;
+
+	uint32_t                     m_parallelThreads = 1;
+	std::mutex                   m_mutex;
+	std::condition_variable_any  m_taskAdded;
+	std::deque<Task>             m_tasks;
+	//-- Reserved up front, so registering concurrent parallelFor calls doesn't allocate
+	std::vector<ParallelForJob*> m_parallelJobs;
+	std::condition_variable      m_helpersFinished;
+	//-- Declared last, workers are stopped and joined before the queue is destroyed
+	std::vector<std::jthread>    m_workers;
+};
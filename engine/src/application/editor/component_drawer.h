@@ -51,7 +51,20 @@ void ComponentDrawer::draw<TransformComponent>(Entity& innerEntity, Scene& m_sce
 	auto& comp = innerEntity.component<TransformComponent>();
 
 	const std::string imGuiId = std::format("##{}{}str", "TransformComponent", static_cast<uint32_t>(innerEntity.entityId()));
-	drawVec3Prop(comp.m_position, imGuiId.c_str());
+	const std::string rotationId = std::format("{}rotation", imGuiId);
+
+	bool changed = drawVec3Prop(comp.m_position, imGuiId.c_str());
+	ImGui::PushItemWidth(-FLT_MIN);
+	changed |= ImGui::SliderAngle(rotationId.c_str(), &comp.m_rotation);
+	ImGui::PopItemWidth();
+	changed |= drawVec2Prop(comp.m_scale, std::format("{}scale", imGuiId));
+	changed |= drawVec2Prop(comp.m_pivot, std::format("{}pivot", imGuiId));
+
+	//-- World matrices are cached, so edited entity and its children are recomputed next update
+	if (changed)
+	{
+		m_scene.markTransformDirty(innerEntity.entityId());
+	}
 }
 
 template<>
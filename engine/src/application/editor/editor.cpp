@@ -3,9 +3,20 @@
 #include <application/core/event_interface.h>
 #include <application/engine_context.h>
 #include <application/managers/renderer_manager.h>
+#include <application/managers/asset_registry.h>
+#include <application/managers/virtual_fs.h>
+#include <application/core/scene/scene_serializer.h>
+
+#include <absl/time/clock.h>
+
+#include <array>
+#include <print>
+#include <random>
 
 //-------------------------------------------------------------------------------------------------
-EditorSystem::EditorSystem(std::shared_ptr<EngineContext> context) : m_engineContext(context)
+EditorSystem::EditorSystem(std::shared_ptr<EngineContext> context, uint32_t stressSpritesCount, const std::string& scenePath)
+	: m_engineContext(context)
+	, m_scenePath(scenePath.empty() ? SceneFileConfig::C_DEFAULT_SCENE : scenePath)
 {
 	m_editorContext = std::make_shared<EditorContext>();
 	m_editorContext->m_currentScene = std::make_unique<Scene>(m_engineContext);
@@ -13,14 +24,80 @@ EditorSystem::EditorSystem(std::shared_ptr<EngineContext> context) : m_engineCon
 	m_scenePanel = ScenePanel(m_editorContext);
 	m_entityPanel = EntityPanel(m_editorContext);
 
+	//-- Test entities are built only when there is no scene to open
+	if (!scenePath.empty() && m_engineContext->m_managerHolder.getManager<VirtualFS>().isFileExist(m_scenePath))
+	{
+		openScene();
+		addStressSprites(stressSpritesCount);
+		return;
+	}
+
 	m_firstEnt = std::make_unique<Entity>(m_editorContext->m_currentScene->addEntity());
 	m_secondEnt = std::make_unique<Entity>(m_editorContext->m_currentScene->addEntity());
 
 	m_firstEnt->component<TransformComponent>().m_position = { 0.5f, 0.5f, 0.5f };
 	m_secondEnt->component<TransformComponent>().m_position = { 0.0f, 0.0f, 0.0f };
 
-	m_firstEnt->addComponent<SpriteComponent>("images/nyan_cat.png");
-	m_secondEnt->addComponent<SpriteComponent>("images/gg2.png");
+	auto& assetRegistry = m_engineContext->m_managerHolder.getManager<AssetRegistry>();
+	m_firstEnt->addComponent<SpriteComponent>(assetRegistry.textureHandle("images/nyan_cat.png"));
+	m_secondEnt->addComponent<SpriteComponent>(assetRegistry.textureHandle("images/gg2.png"));
+
+	addStressSprites(stressSpritesCount);
+}
+
+//-------------------------------------------------------------------------------------------------
+void EditorSystem::addStressSprites(uint32_t spritesCount)
+{
+	if (spritesCount == 0)
+	{
+		return;
+	}
+
+	//-- Fixed seed, runs with different thread counts draw the same scene. Area is wider than
+	//-- default camera view, so culling has work to do too
+	auto&                                 assetRegistry = m_engineContext->m_managerHolder.getManager<AssetRegistry>();
+	const std::array<TextureHandle, 2>    textures = {
+		assetRegistry.textureHandle("images/nyan_cat.png")
+		, assetRegistry.textureHandle("images/gg2.png")
+	};
+	std::mt19937                          random(C_STRESS_SPRITES_SEED);
+	std::uniform_real_distribution<float> planeCoord(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+	for (uint32_t i = 0; i < spritesCount; ++i)
+	{
+		Entity entity = m_editorContext->m_currentScene->addEntity();
+		entity.component<TransformComponent>().m_position = glm::vec3(planeCoord(random), planeCoord(random), depth(random));
+		entity.addComponent<SpriteComponent>(textures[i % textures.size()]);
+	}
+	std::println("Stress scene: {} extra sprites", spritesCount);
+}
+
+//-------------------------------------------------------------------------------------------------
+void EditorSystem::openScene()
+{
+	auto&            vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	auto&            assetRegistry = m_engineContext->m_managerHolder.getManager<AssetRegistry>();
+	const absl::Time loadStart = absl::Now();
+	if (!loadScene(*m_editorContext->m_currentScene, assetRegistry, vfs.virtualToNativePath(m_scenePath)))
+	{
+		std::println("Failed to load scene {}", m_scenePath);
+		return;
+	}
+
+	std::println("Scene {}: {} entities loaded in {:.1f} ms"
+		, m_scenePath
+		, m_editorContext->m_currentScene->registry().storage<entt::entity>().free_list()
+		, absl::ToDoubleMilliseconds(absl::Now() - loadStart));
+}
+
+//-------------------------------------------------------------------------------------------------
+void EditorSystem::saveCurrentScene() const
+{
+	auto&       vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	const auto& assetRegistry = m_engineContext->m_managerHolder.getManager<AssetRegistry>();
+	saveScene(*m_editorContext->m_currentScene, assetRegistry, vfs.virtualToNativePath(m_scenePath));
+	std::println("Scene saved to {}", m_scenePath);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -45,10 +122,18 @@ void EditorSystem::updateUI()
 	//-- Test integration
 	if (ImGui::Begin("Test Window"))
 	{
-		if (ImGui::Button("Switch Textures"))
+		if (ImGui::Button("Save Scene"))
+		{
+			saveCurrentScene();
+		}
+
+		//-- Opened scenes have no test entities
+		if (m_firstEnt && m_secondEnt && ImGui::Button("Switch Textures"))
 		{
-			std::swap(m_firstEnt->component<SpriteComponent>().m_texturePath
-				, m_secondEnt->component<SpriteComponent>().m_texturePath);
+			const TextureHandle firstTexture = m_firstEnt->component<SpriteComponent>().m_texture;
+			const TextureHandle secondTexture = m_secondEnt->component<SpriteComponent>().m_texture;
+			m_firstEnt->patchComponent<SpriteComponent>([secondTexture](SpriteComponent& sprite) { sprite.m_texture = secondTexture; });
+			m_secondEnt->patchComponent<SpriteComponent>([firstTexture](SpriteComponent& sprite) { sprite.m_texture = firstTexture; });
 		}
 
 		ImGui::End();
@@ -58,6 +143,45 @@ void EditorSystem::updateUI()
 	{
 		ImGui::Text("FPS: %d", static_cast<int>(m_fps));
 
+		const auto& stats = m_engineContext->m_managerHolder.getManager<RendererManager>().m_stats;
+		ImGui::Text("Sprites: %u, visible %u, culled %u"
+			, stats.m_spritesCount
+			, stats.m_visibleSpritesCount
+			, stats.culledSpritesCount());
+		ImGui::Text("Passes: %u opaque, %u cutout, %u translucent sprites"
+			, stats.m_opaqueSpritesCount
+			, stats.m_cutoutSpritesCount
+			, stats.translucentSpritesCount());
+		if (stats.m_overdrawMeasured)
+		{
+			ImGui::Text("Overdraw: %.2fx, %llu fragments shaded"
+				, stats.m_overdraw
+				, static_cast<unsigned long long>(stats.m_fragmentInvocations));
+		}
+		else
+		{
+			ImGui::Text("Overdraw: not measured by device");
+		}
+		ImGui::Text("Draw calls: %u", stats.m_drawCalls);
+		ImGui::Text("Sprite batching: %.3f ms in %u ranges", stats.m_batchingMs, stats.m_batchingRanges);
+		ImGui::Text("Sprites per draw call: %.1f", stats.spritesPerDrawCall());
+		ImGui::Text("GPU memory: %.1f / %.1f MB in %u blocks, %u allocations"
+			, stats.m_gpuMemoryUsed / (1024.0 * 1024.0)
+			, stats.m_gpuMemoryReserved / (1024.0 * 1024.0)
+			, stats.m_gpuMemoryBlocks
+			, stats.m_gpuAllocations);
+		if (stats.m_recordingTasks > 0)
+		{
+			ImGui::Text("Command recording: %.3f ms, %u batches in %u secondary buffers"
+				, stats.m_recordingMs
+				, stats.m_recordedBatches
+				, stats.m_recordingTasks);
+		}
+		else
+		{
+			ImGui::Text("Command recording: %.3f ms, %u batches inline", stats.m_recordingMs, stats.m_recordedBatches);
+		}
+
 		//ImGui::Text("Current Scene: %s", m_context->m_currentScene->name().c_str());
 		if (m_editorContext->m_selectedEntity)
 		{
@@ -70,4 +194,32 @@ void EditorSystem::updateUI()
 		}
 		ImGui::End();
 	}
+
+	if (ImGui::Begin("Texture streaming"))
+	{
+		const auto& textureLoads = m_engineContext->m_managerHolder.getManager<RendererManager>().m_textureLoads;
+		if (ImGui::BeginTable("TextureLoads", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+		{
+			ImGui::TableSetupColumn("Path");
+			ImGui::TableSetupColumn("State");
+			ImGui::TableSetupColumn("Size");
+			ImGui::TableSetupColumn("Latency, ms");
+			ImGui::TableHeadersRow();
+
+			for (const auto& textureLoad : textureLoads)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(textureLoad.m_path.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(textureLoadStateName(textureLoad.m_state));
+				ImGui::TableNextColumn();
+				ImGui::Text("%ux%u", textureLoad.m_width, textureLoad.m_height);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", textureLoad.m_latencyMs);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
 }
@@ -19,13 +19,16 @@ struct EngineContext;
 class EditorSystem
 {
 public:
-	EditorSystem(std::shared_ptr<EngineContext> context);
+	EditorSystem(std::shared_ptr<EngineContext> context, uint32_t stressSpritesCount = 0, const std::string& scenePath = {});
 
 	void update(float dt);
 	void onEvent(Event& event) const {}
 
 private:
 	void updateUI();
+	void addStressSprites(uint32_t spritesCount);
+	void openScene();
+	void saveCurrentScene() const;
 
 private:
 	std::shared_ptr<EngineContext>	m_engineContext;
@@ -38,4 +41,8 @@ private:
 	std::unique_ptr<Entity>	m_secondEnt;
 
 	float			m_fps = 0.0f;
+	//-- Virtual path scene is opened from and saved to
+	std::string		m_scenePath;
+
+	constexpr static uint32_t C_STRESS_SPRITES_SEED = 1337;
 };
@@ -7,4 +7,5 @@
 #include <imgui.h>
 #include <format>
 
-void drawVec3Prop(glm::vec3& val, std::string_view propName);
\ No newline at end of file
+bool drawVec3Prop(glm::vec3& val, std::string_view propName);
+bool drawVec2Prop(glm::vec2& val, std::string_view propName);
\ No newline at end of file
@@ -28,7 +28,37 @@ ImGuiIntegration::ImGuiIntegration(ImGuiInitInfo& initInfo)
 }
 
 //-------------------------------------------------------------------------------------------------
-void ImGuiIntegration::update(VkCommandBuffer commandBuffer, std::vector<std::function<void()>>& drawListImGuiUI)
+ImGuiDrawSnapshot::ImGuiDrawSnapshot(const ImDrawData* source)
+{
+	m_drawData.Valid = source->Valid;
+	m_drawData.TotalIdxCount = source->TotalIdxCount;
+	m_drawData.TotalVtxCount = source->TotalVtxCount;
+	m_drawData.DisplayPos = source->DisplayPos;
+	m_drawData.DisplaySize = source->DisplaySize;
+	m_drawData.FramebufferScale = source->FramebufferScale;
+	m_drawData.OwnerViewport = source->OwnerViewport;
+	//-- Textures are updated by the thread that built the frame
+	m_drawData.Textures = nullptr;
+
+	m_drawData.CmdLists.reserve(source->CmdLists.Size);
+	for (const ImDrawList* drawList : source->CmdLists)
+	{
+		m_drawData.CmdLists.push_back(drawList->CloneOutput());
+	}
+	m_drawData.CmdListsCount = m_drawData.CmdLists.Size;
+}
+
+//-------------------------------------------------------------------------------------------------
+ImGuiDrawSnapshot::~ImGuiDrawSnapshot()
+{
+	for (ImDrawList* drawList : m_drawData.CmdLists)
+	{
+		IM_DELETE(drawList);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+ImDrawData* ImGuiIntegration::buildFrame(std::vector<std::function<void()>>& drawListImGuiUI)
 {
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -74,9 +104,33 @@ void ImGuiIntegration::update(VkCommandBuffer commandBuffer, std::vector<std::fu
 		});
 
 	ImGui::Render();
+	return ImGui::GetDrawData();
+}
 
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+//-------------------------------------------------------------------------------------------------
+void ImGuiIntegration::updateTextures(uint32_t framesBehind)
+{
+	for (ImTextureData* texture : ImGui::GetPlatformIO().Textures)
+	{
+		//-- Backend counts only swapchain images, it doesn't know about frames queued ahead
+		const bool destroyTooEarly = texture->Status == ImTextureStatus_WantDestroy
+			&& texture->UnusedFrames < static_cast<int>(framesBehind);
+		if (texture->Status != ImTextureStatus_OK && !destroyTooEarly)
+		{
+			ImGui_ImplVulkan_UpdateTexture(texture);
+		}
+	}
+}
 
+//-------------------------------------------------------------------------------------------------
+void ImGuiIntegration::render(ImDrawData* drawData, VkCommandBuffer commandBuffer)
+{
+	ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
+}
+
+//-------------------------------------------------------------------------------------------------
+void ImGuiIntegration::renderPlatformWindows()
+{
 	ImGuiIO& io = ImGui::GetIO();
 	if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
 	{
@@ -5,6 +5,7 @@
 
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
+#include <imgui.h>
 
 class Event;
 
@@ -24,6 +25,24 @@ struct ImGuiInitInfo
 	GLFWwindow*      m_window;
 };
 
+//-------------------------------------------------------------------------------------------------
+//-- Deep copy of frame draw lists, ImGui reuses its own ones on the next frame.
+//-- Allocated with ImGui allocator, so created and destroyed on the thread building frames
+class ImGuiDrawSnapshot
+{
+public:
+	explicit ImGuiDrawSnapshot(const ImDrawData* source);
+	~ImGuiDrawSnapshot();
+
+	ImGuiDrawSnapshot(const ImGuiDrawSnapshot&) = delete;
+	ImGuiDrawSnapshot& operator=(const ImGuiDrawSnapshot&) = delete;
+
+	ImDrawData* drawData() { return &m_drawData; }
+
+private:
+	ImDrawData m_drawData;
+};
+
 //-------------------------------------------------------------------------------------------------
 class ImGuiIntegration
 {
@@ -31,7 +50,15 @@ public:
 	ImGuiIntegration() = default;
 	ImGuiIntegration(ImGuiInitInfo& initInfo);
 
-	void update(VkCommandBuffer commandBuffer, std::vector<std::function<void()>>& drawListImGuiUI);
+	//-- Runs UI callbacks and ends the frame, main thread only as GLFW input is read here
+	ImDrawData* buildFrame(std::vector<std::function<void()>>& drawListImGuiUI);
+	//-- Font atlas uploads, needed only when frame is rendered from a snapshot. Textures ImGui
+	//-- dropped are destroyed only after they were unused for framesBehind frames, snapshots
+	//-- queued to render thread and frames on GPU may still sample them
+	void updateTextures(uint32_t framesBehind);
+	void render(ImDrawData* drawData, VkCommandBuffer commandBuffer);
+	//-- Extra viewports are rendered and presented right away, main thread only
+	void renderPlatformWindows();
 	void shutdown();
 
 private:
@@ -8,9 +8,12 @@
 #include <application/editor/editor.h>
 #include <application/core/manager_interface.h>
 #include <application/managers/virtual_fs.h>
+#include <application/managers/asset_registry.h>
+#include <application/core/utils/thread_pool.h>
 
 //-------------------------------------------------------------------------------------------------
 Engine::Engine(const Config& config)
+	: m_framesCount(config.m_framesCount)
 {
 	WindowInfo winInfo = {
 		.m_windowName = "Simple"
@@ -28,17 +31,26 @@ Engine::Engine(const Config& config)
 	m_context->m_managerHolder.addManager<WindowManager>();
 	m_context->m_managerHolder.addManager<RendererManager>();
 	m_context->m_managerHolder.addManager<VirtualFS>(config.m_projectPath);
+	m_context->m_managerHolder.addManager<ThreadPool>(config.m_workerThreads, config.m_frameThreads);
+	m_context->m_managerHolder.addManager<AssetRegistry>();
 
-	//-- Create systems
-	m_systemHolder.addSystem<WindowSystem>(m_context, std::move(winInfo));
-	m_systemHolder.addSystem<RendererSystem>(m_context);
-	m_systemHolder.addSystem<EditorSystem>(m_context);
+	//-- Create systems, headless and null renderers need no window
+	if (!config.m_rendererConfig.windowless())
+	{
+		m_systemHolder.addSystem<WindowSystem>(m_context, std::move(winInfo));
+	}
+	m_systemHolder.addSystem<RendererSystem>(m_context, config.m_rendererConfig);
+	m_systemHolder.addSystem<EditorSystem>(m_context, config.m_stressSpritesCount, config.m_scenePath);
 }
 
 //-------------------------------------------------------------------------------------------------
 void Engine::run()
 {
-	float lastFrameDt = 0.0f;
+	float    lastFrameDt = 0.0f;
+	uint32_t framesCount = 0;
+	float    minFrameDt = std::numeric_limits<float>::max();
+	float    maxFrameDt = 0.0f;
+	auto     runStart = absl::Now();
 
 	while (m_running)
 	{
@@ -52,6 +64,25 @@ void Engine::run()
 
 		auto timeEnd = absl::Now();
 		lastFrameDt = absl::ToDoubleSeconds(timeEnd - timeStart);
+
+		minFrameDt = std::min(minFrameDt, lastFrameDt);
+		maxFrameDt = std::max(maxFrameDt, lastFrameDt);
+		if (++framesCount == m_framesCount)
+		{
+			m_running = false;
+		}
+	}
+
+	//-- Benchmark summary, frames run on render thread may still be in flight until shutdown
+	if (m_framesCount > 0)
+	{
+		const double totalMs = absl::ToDoubleMilliseconds(absl::Now() - runStart);
+		std::println("{} frames in {:.1f} ms: {:.3f} ms average, {:.3f} ms min, {:.3f} ms max"
+			, framesCount
+			, totalMs
+			, totalMs / framesCount
+			, minFrameDt * 1000.0f
+			, maxFrameDt * 1000.0f);
 	}
 }
 
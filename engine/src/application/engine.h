@@ -5,16 +5,29 @@
 #include <chrono>
 #include <ctime>
 #include <print>
+#include <limits>
 #include <absl/time/time.h>
 
 #include <absl/time/clock.h>
 
 #include <application/core/system_interface.h>
 #include <application/engine_context.h>
+#include <application/renderer/renderer_config.h>
 
 struct Config
 {
-	std::string m_projectPath;
+	std::string    m_projectPath;
+	RendererConfig m_rendererConfig;
+	//-- Zero means all hardware threads except the main one
+	uint32_t       m_workerThreads = 0;
+	//-- Threads splitting per frame sprite work, calling one included. Zero uses all workers
+	uint32_t       m_frameThreads = 0;
+	//-- Extra sprites scattered around the scene to measure how frame work scales
+	uint32_t       m_stressSpritesCount = 0;
+	//-- Virtual path of scene editor opens and saves, empty builds test scene and saves to default
+	std::string    m_scenePath;
+	//-- Engine stops after that many frames, zero runs until window is closed
+	uint32_t       m_framesCount = 0;
 };
 
 class Engine
@@ -32,5 +45,6 @@ private:
 	std::shared_ptr<EngineContext> m_context;
 	SystemHolder  m_systemHolder;
 
-	bool m_running = true;
+	uint32_t m_framesCount = 0;
+	bool     m_running = true;
 };
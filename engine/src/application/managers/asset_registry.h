@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include <application/core/utils/string_interner.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Texture path interned when sprite is assigned, components and draw lists carry it
+//-- instead of the path itself
+using TextureHandle = StringInterner::Id;
+constexpr TextureHandle C_INVALID_TEXTURE_HANDLE = StringInterner::C_INVALID_ID;
+
+//-------------------------------------------------------------------------------------------------
+//-- Shared by main and render threads, paths are looked up only when handle is seen first time
+class AssetRegistry
+{
+public:
+	//-------------------------------------------------------------------------------------------------
+	TextureHandle textureHandle(std::string_view texturePath)
+	{
+		return m_texturePaths.intern(texturePath);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	std::string_view texturePath(TextureHandle texture) const
+	{
+		return m_texturePaths.resolve(texture);
+	}
+
+private:
+	StringInterner m_texturePaths;
+};
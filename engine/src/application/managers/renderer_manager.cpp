@@ -1,9 +1,152 @@
 #include "renderer_manager.h"
 
+#include <algorithm>
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::clear()
+{
+	m_transforms.clear();
+	m_depths.clear();
+	m_textures.clear();
+	m_scales.clear();
+	m_rotations.clear();
+	m_colors.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::swap(SpriteDrawList& other) noexcept
+{
+	m_transforms.swap(other.m_transforms);
+	m_depths.swap(other.m_depths);
+	m_textures.swap(other.m_textures);
+	m_scales.swap(other.m_scales);
+	m_rotations.swap(other.m_rotations);
+	m_colors.swap(other.m_colors);
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t SpriteDrawList::append(uint32_t count)
+{
+	const uint32_t   first = size();
+	const SpriteInfo defaults;
+	m_transforms.resize(first + count, defaults.m_transform);
+	m_depths.resize(first + count, defaults.m_depth);
+	m_textures.resize(first + count, defaults.m_texture);
+	m_scales.resize(first + count, defaults.m_scale);
+	m_rotations.resize(first + count, defaults.m_rotation);
+	m_colors.resize(first + count, defaults.m_color);
+	return first;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::truncate(uint32_t count)
+{
+	if (count >= size())
+	{
+		return;
+	}
+
+	m_transforms.resize(count);
+	m_depths.resize(count);
+	m_textures.resize(count);
+	m_scales.resize(count);
+	m_rotations.resize(count);
+	m_colors.resize(count);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::moveSprites(uint32_t first, uint32_t count, uint32_t destination)
+{
+	if (first == destination)
+	{
+		return;
+	}
+
+	//-- Forward copy is safe for overlapping ranges moved towards the front
+	auto move = [first, count, destination](auto& attributes)
+		{
+			std::copy_n(attributes.begin() + first, count, attributes.begin() + destination);
+		};
+	move(m_transforms);
+	move(m_depths);
+	move(m_textures);
+	move(m_scales);
+	move(m_rotations);
+	move(m_colors);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::push(const SpriteInfo& sprite)
+{
+	m_transforms.push_back(sprite.m_transform);
+	m_depths.push_back(sprite.m_depth);
+	m_textures.push_back(sprite.m_texture);
+	m_scales.push_back(sprite.m_scale);
+	m_rotations.push_back(sprite.m_rotation);
+	m_colors.push_back(sprite.m_color);
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteDrawList::set(uint32_t index, const SpriteInfo& sprite)
+{
+	m_transforms[index] = sprite.m_transform;
+	m_depths[index] = sprite.m_depth;
+	m_textures[index] = sprite.m_texture;
+	m_scales[index] = sprite.m_scale;
+	m_rotations[index] = sprite.m_rotation;
+	m_colors[index] = sprite.m_color;
+}
+
+//-------------------------------------------------------------------------------------------------
+SpriteInfo SpriteDrawList::sprite(uint32_t index) const
+{
+	return {
+		.m_transform = m_transforms[index]
+		, .m_depth = m_depths[index]
+		, .m_texture = m_textures[index]
+		, .m_scale = m_scales[index]
+		, .m_rotation = m_rotations[index]
+		, .m_color = m_colors[index]
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererManager::addSpriteToDrawList(const SpriteInfo& spriteInfo)
+{
+	m_sprites.push(spriteInfo);
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t RendererManager::reserveSprites(uint32_t count)
+{
+	return m_sprites.append(count);
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t RendererManager::addRetainedSprite()
+{
+	if (m_freeSpriteSlots.empty())
+	{
+		return m_spriteSlotsCount++;
+	}
+
+	const uint32_t slot = m_freeSpriteSlots.back();
+	m_freeSpriteSlots.pop_back();
+	return slot;
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererManager::updateRetainedSprite(uint32_t slot, const SpriteInfo& spriteInfo)
+{
+	m_sprites.push(spriteInfo);
+	m_spriteSlots.push_back(slot);
+}
+
 //-------------------------------------------------------------------------------------------------
-void RendererManager::addSpriteToDrawList(SpriteInfo spriteInfo)
+void RendererManager::removeRetainedSprite(uint32_t slot)
 {
-	m_sprites.push_back(spriteInfo);
+	m_removedSpriteSlots.push_back(slot);
+	m_freeSpriteSlots.push_back(slot);
 }
 
 //-------------------------------------------------------------------------------------------------
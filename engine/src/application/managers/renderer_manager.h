@@ -4,14 +4,139 @@
 #include <string>
 #include <array>
 #include <functional>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
+#include <application/managers/asset_registry.h>
+
 //-------------------------------------------------------------------------------------------------
+//-- Unit quad around origin placed by 2D affine transform, as world transform of scene entity
 struct SpriteInfo
 {
-	glm::vec3   m_position;
-	std::string m_texturePath;
+	glm::mat3x2   m_transform = glm::mat3x2(1.0f);
+	float         m_depth = 0.0f;
+	TextureHandle m_texture = C_INVALID_TEXTURE_HANDLE;
+	//-- Same transform as scale and rotation, instanced quads are built from them
+	glm::vec2     m_scale = { 1.0f, 1.0f };
+	float         m_rotation = 0.0f;
+	glm::vec4     m_color = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Sprites of one frame, one array per attribute. Culling and sorting touch only attributes
+//-- they need. Storage is cleared but never released, so frames of steady size don't allocate
+struct SpriteDrawList
+{
+	//-------------------------------------------------------------------------------------------------
+	uint32_t size() const { return static_cast<uint32_t>(m_transforms.size()); }
+	bool empty() const { return m_transforms.empty(); }
+
+	void clear();
+	void swap(SpriteDrawList& other) noexcept;
+	//-- Adds count sprites with default attributes and returns index of the first one,
+	//-- caller writes them in place
+	uint32_t append(uint32_t count);
+	//-- Drops sprites from count on, when fewer were written than appended
+	void truncate(uint32_t count);
+	//-- Moves count sprites from first down to destination, which is not past first
+	void moveSprites(uint32_t first, uint32_t count, uint32_t destination);
+	void push(const SpriteInfo& sprite);
+	void set(uint32_t index, const SpriteInfo& sprite);
+	SpriteInfo sprite(uint32_t index) const;
+
+	std::vector<glm::mat3x2>   m_transforms;
+	std::vector<float>         m_depths;
+	std::vector<TextureHandle> m_textures;
+	std::vector<glm::vec2>     m_scales;
+	std::vector<float>         m_rotations;
+	std::vector<glm::vec4>     m_colors;
+};
+
+//-------------------------------------------------------------------------------------------------
+enum class TextureLoadState : uint8_t
+{
+	Queued,
+	Decoding,
+	//-- Pixels are ready, waiting for upload from renderer
+	Decoded,
+	Uploading,
+	Resident,
+	Failed
+};
+
+//-------------------------------------------------------------------------------------------------
+constexpr const char* textureLoadStateName(TextureLoadState state)
+{
+	switch (state)
+	{
+	case TextureLoadState::Queued: return "Queued";
+	case TextureLoadState::Decoding: return "Decoding";
+	case TextureLoadState::Decoded: return "Decoded";
+	case TextureLoadState::Uploading: return "Uploading";
+	case TextureLoadState::Resident: return "Resident";
+	case TextureLoadState::Failed: return "Failed";
+	}
+	return "Unknown";
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Streaming state of one requested image or cooked atlas page
+struct TextureLoadInfo
+{
+	std::string      m_path;
+	TextureLoadState m_state = TextureLoadState::Queued;
+	uint32_t         m_width = 0;
+	uint32_t         m_height = 0;
+	//-- From request to resident, time spent so far while loading
+	float            m_latencyMs = 0.0f;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Filled by renderer every frame
+struct RendererStats
+{
+	//-- Submitted sprites and ones left after frustum culling
+	uint32_t m_spritesCount = 0;
+	uint32_t m_visibleSpritesCount = 0;
+	//-- Visible sprites drawn by depth writing passes, the rest is blended
+	uint32_t m_opaqueSpritesCount = 0;
+	uint32_t m_cutoutSpritesCount = 0;
+	uint32_t m_drawCalls = 0;
+	//-- Culling, sorting and geometry generation, split into that many ranges over worker threads
+	float    m_batchingMs = 0.0f;
+	uint32_t m_batchingRanges = 0;
+	//-- Device memory allocator state
+	uint32_t m_gpuMemoryBlocks = 0;
+	uint32_t m_gpuAllocations = 0;
+	uint64_t m_gpuMemoryUsed = 0;
+	uint64_t m_gpuMemoryReserved = 0;
+	//-- Command recording of the previous frame, this one is still being recorded
+	float    m_recordingMs = 0.0f;
+	uint32_t m_recordedBatches = 0;
+	uint32_t m_recordingTasks = 0;
+	//-- Fragment shader invocations of sprites a few frames ago, when device can count them
+	bool     m_overdrawMeasured = false;
+	uint64_t m_fragmentInvocations = 0;
+	float    m_overdraw = 0.0f;
+
+	//-------------------------------------------------------------------------------------------------
+	float spritesPerDrawCall() const
+	{
+		return m_drawCalls > 0 ? static_cast<float>(m_visibleSpritesCount) / static_cast<float>(m_drawCalls) : 0.0f;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	uint32_t culledSpritesCount() const
+	{
+		return m_spritesCount - m_visibleSpritesCount;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	uint32_t translucentSpritesCount() const
+	{
+		return m_visibleSpritesCount - m_opaqueSpritesCount - m_cutoutSpritesCount;
+	}
 };
 
 //-------------------------------------------------------------------------------------------------
@@ -20,12 +145,35 @@ struct RendererManager
 	using ImGuiDrawCallback = std::function<void()>;
 
 	//-------------------------------------------------------------------------------------------------
-	void addSpriteToDrawList(SpriteInfo spriteInfo);
+	void addSpriteToDrawList(const SpriteInfo& spriteInfo);
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Bulk extraction, count sprites are appended at once and written in place through
+	//-- m_sprites arrays starting from returned index
+	uint32_t reserveSprites(uint32_t count);
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Retained mode. Slot names sprite kept by renderer until it's removed, freed slots are
+	//-- reused. Changed sprite is appended to m_sprites and its slot to m_spriteSlots
+	uint32_t addRetainedSprite();
+	void updateRetainedSprite(uint32_t slot, const SpriteInfo& spriteInfo);
+	void removeRetainedSprite(uint32_t slot);
 
 	//-------------------------------------------------------------------------------------------------
 	void addImGuiDrawCallback(ImGuiDrawCallback imGuiUpdateUi);
 
-	//-- User notation object
-	std::vector<SpriteInfo>        m_sprites;
+	//-- Set by renderer from its config before scenes are created
+	bool                           m_retainedSprites = false;
+	//-- User notation object, all frame sprites or only changed ones in retained mode
+	SpriteDrawList                 m_sprites;
+	//-- Retained mode, slot of every m_sprites entry and slots removed since the last frame.
+	//-- Removals are applied first, so freed slot may be reused in the same frame
+	std::vector<uint32_t>          m_spriteSlots;
+	std::vector<uint32_t>          m_removedSpriteSlots;
+	std::vector<uint32_t>          m_freeSpriteSlots;
+	uint32_t                       m_spriteSlotsCount = 0;
 	std::vector<ImGuiDrawCallback> m_imGuiUpdatesUi;
+	RendererStats                  m_stats;
+	//-- Updated by renderer while textures are streamed
+	std::vector<TextureLoadInfo>   m_textureLoads;
 };
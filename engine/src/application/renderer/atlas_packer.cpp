@@ -0,0 +1,140 @@
+#include "atlas_packer.h"
+
+#include <limits>
+#include <algorithm>
+
+//-------------------------------------------------------------------------------------------------
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height, uint32_t padding, uint32_t alignment)
+	: m_width(width)
+	, m_height(height)
+	, m_padding(padding)
+	, m_alignment(alignment)
+{
+	reset();
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<AtlasRect> SkylinePacker::insert(uint32_t width, uint32_t height)
+{
+	const uint32_t paddedWidth = (width + m_padding * 2 + m_alignment - 1) / m_alignment * m_alignment;
+	const uint32_t paddedHeight = (height + m_padding * 2 + m_alignment - 1) / m_alignment * m_alignment;
+
+	//-- Bottom-left heuristic: lowest top edge first, narrowest segment on ties
+	size_t   bestIndex = m_skyline.size();
+	uint32_t bestY = std::numeric_limits<uint32_t>::max();
+	uint32_t bestWidth = std::numeric_limits<uint32_t>::max();
+	for (size_t i = 0; i < m_skyline.size(); ++i)
+	{
+		const auto y = fitY(i, paddedWidth, paddedHeight);
+		if (!y)
+		{
+			continue;
+		}
+		const uint32_t bottom = *y + paddedHeight;
+		if (bottom < bestY || (bottom == bestY && m_skyline[i].m_width < bestWidth))
+		{
+			bestIndex = i;
+			bestY = bottom;
+			bestWidth = m_skyline[i].m_width;
+		}
+	}
+
+	if (bestIndex == m_skyline.size())
+	{
+		return std::nullopt;
+	}
+
+	const AtlasRect paddedRect = {
+		.m_x = m_skyline[bestIndex].m_x
+		, .m_y = bestY - paddedHeight
+		, .m_width = paddedWidth
+		, .m_height = paddedHeight
+	};
+	addSkylineLevel(bestIndex, paddedRect);
+	m_usedArea += static_cast<uint64_t>(paddedWidth) * paddedHeight;
+
+	return AtlasRect{
+		.m_x = paddedRect.m_x + m_padding
+		, .m_y = paddedRect.m_y + m_padding
+		, .m_width = width
+		, .m_height = height
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+void SkylinePacker::reset()
+{
+	m_skyline.clear();
+	m_skyline.push_back({ 0, 0, m_width });
+	m_usedArea = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+float SkylinePacker::occupancy() const
+{
+	return static_cast<float>(m_usedArea) / static_cast<float>(static_cast<uint64_t>(m_width) * m_height);
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<uint32_t> SkylinePacker::fitY(size_t nodeIndex, uint32_t width, uint32_t height) const
+{
+	const uint32_t x = m_skyline[nodeIndex].m_x;
+	if (x + width > m_width)
+	{
+		return std::nullopt;
+	}
+
+	//-- Rect rests on the highest segment it spans
+	uint32_t y = 0;
+	uint32_t widthLeft = width;
+	for (size_t i = nodeIndex; widthLeft > 0; ++i)
+	{
+		y = std::max(y, m_skyline[i].m_y);
+		if (y + height > m_height)
+		{
+			return std::nullopt;
+		}
+		widthLeft -= std::min(widthLeft, m_skyline[i].m_width);
+	}
+	return y;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SkylinePacker::addSkylineLevel(size_t nodeIndex, const AtlasRect& rect)
+{
+	const SkylineNode newNode = { rect.m_x, rect.m_y + rect.m_height, rect.m_width };
+	m_skyline.insert(m_skyline.begin() + nodeIndex, newNode);
+
+	//-- Cut or remove segments now hidden under the new one
+	const uint32_t newRight = newNode.m_x + newNode.m_width;
+	for (size_t i = nodeIndex + 1; i < m_skyline.size();)
+	{
+		SkylineNode& node = m_skyline[i];
+		if (node.m_x >= newRight)
+		{
+			break;
+		}
+
+		const uint32_t nodeRight = node.m_x + node.m_width;
+		if (nodeRight <= newRight)
+		{
+			m_skyline.erase(m_skyline.begin() + i);
+			continue;
+		}
+		node.m_width = nodeRight - newRight;
+		node.m_x = newRight;
+		break;
+	}
+
+	//-- Merge neighbours of the same height
+	for (size_t i = 0; i + 1 < m_skyline.size();)
+	{
+		if (m_skyline[i].m_y == m_skyline[i + 1].m_y)
+		{
+			m_skyline[i].m_width += m_skyline[i + 1].m_width;
+			m_skyline.erase(m_skyline.begin() + i + 1);
+			continue;
+		}
+		++i;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------
+struct AtlasRect
+{
+	uint32_t m_x = 0;
+	uint32_t m_y = 0;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Skyline bottom-left packer. Keeps only top edge of placed rects, so insert is
+//-- linear in skyline segments and packing can continue incrementally page by page
+class SkylinePacker
+{
+public:
+	//-- Padded rects are rounded up to alignment, so with aligned page size every rect starts
+	//-- at a multiple of it
+	SkylinePacker(uint32_t width, uint32_t height, uint32_t padding, uint32_t alignment = 1);
+
+	//-- Returned rect excludes padding, nothing is returned if page is full
+	std::optional<AtlasRect> insert(uint32_t width, uint32_t height);
+	void reset();
+
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+	float occupancy() const;
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct SkylineNode
+	{
+		uint32_t m_x;
+		uint32_t m_y;
+		uint32_t m_width;
+	};
+
+	//-- Lowest y where rect fits starting at node, nothing if it crosses page border
+	std::optional<uint32_t> fitY(size_t nodeIndex, uint32_t width, uint32_t height) const;
+	void addSkylineLevel(size_t nodeIndex, const AtlasRect& rect);
+
+private:
+	std::vector<SkylineNode> m_skyline;
+	uint32_t                 m_width = 0;
+	uint32_t                 m_height = 0;
+	uint32_t                 m_padding = 0;
+	uint32_t                 m_alignment = 1;
+	uint64_t                 m_usedArea = 0;
+};
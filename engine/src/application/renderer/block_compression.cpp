@@ -0,0 +1,344 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+//-------------------------------------------------------------------------------------------------
+constexpr uint32_t C_BLOCK_PIXELS = 16;
+//-- BC7 4 bit index interpolation weights out of 64
+constexpr std::array<uint32_t, 16> C_BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+using BlockColor = std::array<float, 4>;
+
+//-------------------------------------------------------------------------------------------------
+struct BlockEndpoints
+{
+	BlockColor m_start = {};
+	BlockColor m_end = {};
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Bits are appended from the least significant bit of byte 0, as BC7 layout expects
+struct BlockBitWriter
+{
+	//-------------------------------------------------------------------------------------------------
+	void write(uint32_t value, uint32_t bitsCount)
+	{
+		for (uint32_t i = 0; i < bitsCount; ++i, ++m_position)
+		{
+			if ((value >> i) & 1u)
+			{
+				m_block[m_position / 8] |= static_cast<uint8_t>(1u << (m_position % 8));
+			}
+		}
+	}
+
+	uint8_t* m_block = nullptr;
+	uint32_t m_position = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Endpoints on the line of the biggest color variance, they enclose all block pixels
+//-- projections. Only first channelsCount channels take part
+BlockEndpoints principalAxisEndpoints(const uint8_t* pixels, uint32_t channelsCount)
+{
+	BlockColor mean = {};
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		for (uint32_t c = 0; c < channelsCount; ++c)
+		{
+			mean[c] += pixels[i * 4 + c];
+		}
+	}
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		mean[c] /= C_BLOCK_PIXELS;
+	}
+
+	std::array<float, 16> covariance = {};
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		for (uint32_t a = 0; a < channelsCount; ++a)
+		{
+			for (uint32_t b = 0; b < channelsCount; ++b)
+			{
+				covariance[a * 4 + b] += (pixels[i * 4 + a] - mean[a]) * (pixels[i * 4 + b] - mean[b]);
+			}
+		}
+	}
+
+	//-- Flat block, both endpoints are its single color. Pixels are integers, so any variance
+	//-- is far above the threshold
+	float    trace = 0.0f;
+	uint32_t seedChannel = 0;
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		trace += covariance[c * 4 + c];
+		if (covariance[c * 4 + c] > covariance[seedChannel * 4 + seedChannel])
+		{
+			seedChannel = c;
+		}
+	}
+	if (trace < 0.5f)
+	{
+		return { .m_start = mean, .m_end = mean };
+	}
+
+	//-- Power iteration, a few steps are enough for 4x4 matrix. Seeded with the column of the
+	//-- most varying channel: a fixed seed like gray axis is orthogonal to hue ramps of constant
+	//-- brightness and collapses them, while this one never vanishes under the iteration
+	BlockColor axis = {};
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		axis[c] = covariance[c * 4 + seedChannel];
+	}
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		BlockColor next = {};
+		float      largest = 0.0f;
+		for (uint32_t a = 0; a < channelsCount; ++a)
+		{
+			for (uint32_t b = 0; b < channelsCount; ++b)
+			{
+				next[a] += covariance[a * 4 + b] * axis[b];
+			}
+			largest = std::max(largest, std::abs(next[a]));
+		}
+		for (uint32_t c = 0; c < channelsCount; ++c)
+		{
+			axis[c] = next[c] / largest;
+		}
+	}
+
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		length += axis[c] * axis[c];
+	}
+	length = std::sqrt(length);
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		axis[c] /= length;
+	}
+
+	float minProjection = std::numeric_limits<float>::max();
+	float maxProjection = std::numeric_limits<float>::lowest();
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		float projection = 0.0f;
+		for (uint32_t c = 0; c < channelsCount; ++c)
+		{
+			projection += (pixels[i * 4 + c] - mean[c]) * axis[c];
+		}
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	BlockEndpoints endpoints;
+	for (uint32_t c = 0; c < channelsCount; ++c)
+	{
+		endpoints.m_start[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+		endpoints.m_end[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+	}
+	return endpoints;
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Index of the nearest palette entry for every pixel
+template<size_t PaletteSize>
+std::array<uint32_t, C_BLOCK_PIXELS> nearestIndices(const uint8_t*                             pixels
+                                                    , const std::array<BlockColor, PaletteSize>& palette
+                                                    , uint32_t                                   firstChannel
+                                                    , uint32_t                                   channelsCount)
+{
+	std::array<uint32_t, C_BLOCK_PIXELS> indices = {};
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		float bestError = std::numeric_limits<float>::max();
+		for (uint32_t entry = 0; entry < PaletteSize; ++entry)
+		{
+			float error = 0.0f;
+			for (uint32_t c = firstChannel; c < firstChannel + channelsCount; ++c)
+			{
+				const float diff = pixels[i * 4 + c] - palette[entry][c];
+				error += diff * diff;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = entry;
+			}
+		}
+	}
+	return indices;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint16_t packRgb565(const BlockColor& color)
+{
+	const uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+	const uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+	const uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+//-------------------------------------------------------------------------------------------------
+BlockColor unpackRgb565(uint16_t packed)
+{
+	const uint32_t r = packed >> 11;
+	const uint32_t g = (packed >> 5) & 0x3F;
+	const uint32_t b = packed & 0x1F;
+	return {
+		static_cast<float>((r << 3) | (r >> 2))
+		, static_cast<float>((g << 2) | (g >> 4))
+		, static_cast<float>((b << 3) | (b >> 2))
+		, 0.0f
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- BC3 alpha half: two 8 bit endpoints and 3 bit indices, 8 levels mode
+void encodeAlphaBlock(const uint8_t* pixels, uint8_t* block)
+{
+	uint8_t maxAlpha = 0;
+	uint8_t minAlpha = 255;
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		maxAlpha = std::max(maxAlpha, pixels[i * 4 + 3]);
+		minAlpha = std::min(minAlpha, pixels[i * 4 + 3]);
+	}
+
+	std::array<BlockColor, 8> palette = {};
+	palette[0][3] = maxAlpha;
+	palette[1][3] = minAlpha;
+	for (uint32_t i = 1; i < 7; ++i)
+	{
+		palette[i + 1][3] = static_cast<float>(((7 - i) * maxAlpha + i * minAlpha) / 7);
+	}
+	const auto indices = nearestIndices(pixels, palette, 3, 1);
+
+	block[0] = maxAlpha;
+	block[1] = minAlpha;
+	uint64_t packedIndices = 0;
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+	}
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		block[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- BC3 color half is BC1 block always decoded in 4 colors mode
+void encodeColorBlock(const uint8_t* pixels, uint8_t* block)
+{
+	const BlockEndpoints endpoints = principalAxisEndpoints(pixels, 3);
+	const uint16_t       color0 = packRgb565(endpoints.m_end);
+	const uint16_t       color1 = packRgb565(endpoints.m_start);
+
+	std::array<BlockColor, 4> palette = { unpackRgb565(color0), unpackRgb565(color1) };
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+	const auto indices = nearestIndices(pixels, palette, 0, 3);
+
+	uint32_t packedIndices = 0;
+	for (uint32_t i = 0; i < C_BLOCK_PIXELS; ++i)
+	{
+		packedIndices |= indices[i] << (i * 2);
+	}
+
+	block[0] = static_cast<uint8_t>(color0 & 0xFF);
+	block[1] = static_cast<uint8_t>(color0 >> 8);
+	block[2] = static_cast<uint8_t>(color1 & 0xFF);
+	block[3] = static_cast<uint8_t>(color1 >> 8);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		block[4 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void encodeBC3Block(const uint8_t* pixels, uint8_t* block)
+{
+	encodeAlphaBlock(pixels, block);
+	encodeColorBlock(pixels, block + 8);
+}
+
+//-------------------------------------------------------------------------------------------------
+void encodeBC7Block(const uint8_t* pixels, uint8_t* block)
+{
+	const BlockEndpoints endpoints = principalAxisEndpoints(pixels, 4);
+
+	//-- 7 bit endpoint plus p-bit shared by all channels of the endpoint
+	std::array<std::array<uint32_t, 4>, 2> quantized = {};
+	std::array<uint32_t, 2>                pBits = {};
+	for (uint32_t e = 0; e < 2; ++e)
+	{
+		const BlockColor& color = e == 0 ? endpoints.m_start : endpoints.m_end;
+
+		float bestError = std::numeric_limits<float>::max();
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			std::array<uint32_t, 4> candidate = {};
+			float                   error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((color[c] - p) / 2.0f), 0l, 127l));
+				const float diff = static_cast<float>((candidate[c] << 1) | p) - color[c];
+				error += diff * diff;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				quantized[e] = candidate;
+				pBits[e] = p;
+			}
+		}
+	}
+
+	std::array<BlockColor, 16> palette = {};
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		const uint32_t start = (quantized[0][c] << 1) | pBits[0];
+		const uint32_t end = (quantized[1][c] << 1) | pBits[1];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			palette[i][c] = static_cast<float>(((64 - C_BC7_WEIGHTS[i]) * start + C_BC7_WEIGHTS[i] * end + 32) >> 6);
+		}
+	}
+	auto indices = nearestIndices(pixels, palette, 0, 4);
+
+	//-- Anchor index is stored without its top bit, so it has to be below 8
+	if (indices[0] >= 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint32_t& index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	std::fill_n(block, 16, uint8_t(0));
+	BlockBitWriter writer = { block };
+	writer.write(1u << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.write(quantized[0][c], 7);
+		writer.write(quantized[1][c], 7);
+	}
+	writer.write(pBits[0], 1);
+	writer.write(pBits[1], 1);
+	writer.write(indices[0], 3);
+	for (uint32_t i = 1; i < C_BLOCK_PIXELS; ++i)
+	{
+		writer.write(indices[i], 4);
+	}
+}
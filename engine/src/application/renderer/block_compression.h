@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+//-------------------------------------------------------------------------------------------------
+//-- Fast single pass encoders of 4x4 RGBA8 blocks into 16 bytes, endpoints are taken along
+//-- principal axis of block colors. Pixels are row major, 4 bytes each
+void encodeBC3Block(const uint8_t* pixels, uint8_t* block);
+//-- Mode 6 only: one subset, RGBA endpoints with p-bits and 16 interpolation levels
+void encodeBC7Block(const uint8_t* pixels, uint8_t* block);
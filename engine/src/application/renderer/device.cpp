@@ -1,62 +1,128 @@
 #include "device.h"
 
 #include <application/core/utils/engine_assert.h>
+#include <application/core/utils/thread_pool.h>
 #include <application/engine_context.h>
 #include <application/managers/virtual_fs.h>
+#include <application/renderer/shader_cache.h>
+#include <application/renderer/shader_manifest.h>
 
 #include <backends/imgui_impl_vulkan.h>
 #include <backends/imgui_impl_glfw.h>
 
+#include <atomic>
+#include <chrono>
+
 //-------------------------------------------------------------------------------------------------
 //-- Helper functions, maybe need to move in an another module
-std::vector<uint32_t> compileShaderFromSource(const std::string& source, shaderc_shader_kind kind, const std::string& name)
+vk::VertexInputBindingDescription getBindingDescription()
+{
+	vk::VertexInputBindingDescription bindingDescription = {};
+	bindingDescription.setBinding(0)
+		.setStride(sizeof(VertexData))
+		.setInputRate(vk::VertexInputRate::eVertex);
+	return bindingDescription;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions()
 {
-	shaderc::Compiler       compiler;
-	shaderc::CompileOptions options;
+	std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions = {};
+	attributeDescriptions[0].setBinding(0)
+		.setFormat(vk::Format::eR32G32B32A32Sfloat)
+		.setLocation(0)
+		.setOffset(offsetof(VertexData, m_vertex));
 
-	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	attributeDescriptions[1].setBinding(0)
+		.setFormat(vk::Format::eR32G32B32Sfloat)
+		.setLocation(1)
+		.setOffset(offsetof(VertexData, m_color));
 
-	auto result = compiler.CompileGlslToSpv(source, kind, name.c_str(), options);
+	attributeDescriptions[2].setBinding(0)
+		.setFormat(vk::Format::eR32G32Sfloat)
+		.setLocation(2)
+		.setOffset(offsetof(VertexData, m_texCoord));
 
-	engineAssert(result.GetCompilationStatus() == shaderc_compilation_status_success
-		, std::format("Shader: '{}' compilation failed", name));
+	attributeDescriptions[3].setBinding(0)
+		.setFormat(vk::Format::eR32Uint)
+		.setLocation(3)
+		.setOffset(offsetof(VertexData, m_textureIndex));
 
-	// Spirv binary code
-	return { result.cbegin(), result.cend() };
+	return attributeDescriptions;
 }
 
 //-------------------------------------------------------------------------------------------------
-vk::VertexInputBindingDescription getBindingDescription()
+vk::VertexInputBindingDescription getInstanceBindingDescription()
 {
 	vk::VertexInputBindingDescription bindingDescription = {};
 	bindingDescription.setBinding(0)
-		.setStride(sizeof(VertexData))
-		.setInputRate(vk::VertexInputRate::eVertex);
+		.setStride(sizeof(SpriteInstanceData))
+		.setInputRate(vk::VertexInputRate::eInstance);
 	return bindingDescription;
 }
 
 //-------------------------------------------------------------------------------------------------
-std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions()
+std::array<vk::VertexInputAttributeDescription, 6> getInstanceAttributeDescriptions()
 {
-	std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = {};
+	std::array<vk::VertexInputAttributeDescription, 6> attributeDescriptions = {};
 	attributeDescriptions[0].setBinding(0)
 		.setFormat(vk::Format::eR32G32Sfloat)
 		.setLocation(0)
-		.setOffset(offsetof(VertexData, m_vertex));
+		.setOffset(offsetof(SpriteInstanceData, m_position));
 
 	attributeDescriptions[1].setBinding(0)
-		.setFormat(vk::Format::eR32G32B32Sfloat)
+		.setFormat(vk::Format::eR32Sfloat)
 		.setLocation(1)
-		.setOffset(offsetof(VertexData, m_color));
+		.setOffset(offsetof(SpriteInstanceData, m_depth));
 
 	attributeDescriptions[2].setBinding(0)
-		.setFormat(vk::Format::eR32G32Sfloat)
+		.setFormat(vk::Format::eR16G16Sfloat)
 		.setLocation(2)
-		.setOffset(offsetof(VertexData, m_texCoord));
+		.setOffset(offsetof(SpriteInstanceData, m_scale));
+
+	attributeDescriptions[3].setBinding(0)
+		.setFormat(vk::Format::eR16G16B16A16Unorm)
+		.setLocation(3)
+		.setOffset(offsetof(SpriteInstanceData, m_uvRect));
+
+	attributeDescriptions[4].setBinding(0)
+		.setFormat(vk::Format::eR8G8B8A8Unorm)
+		.setLocation(4)
+		.setOffset(offsetof(SpriteInstanceData, m_color));
+
+	attributeDescriptions[5].setBinding(0)
+		.setFormat(vk::Format::eR32Uint)
+		.setLocation(5)
+		.setOffset(offsetof(SpriteInstanceData, m_rotationAndTexture));
 
 	return attributeDescriptions;
 }
 
+//-------------------------------------------------------------------------------------------------
+//-- Shared by recording tasks of one frame. Task taken from pool after all ranges are claimed
+//-- touches only this state, so it's kept alive by tasks themselves
+struct BatchRecordingJob
+{
+	std::atomic<uint32_t>                              m_nextRange = 0;
+	std::atomic<uint32_t>                              m_recordedRanges = 0;
+	uint32_t                                           m_rangesCount = 0;
+	std::vector<std::chrono::steady_clock::time_point> m_rangeFinishTimes;
+};
+
+//-------------------------------------------------------------------------------------------------
+void beginSecondaryCommandBuffer(vk::CommandBuffer commandBuffer, vk::RenderPass renderPass, vk::Framebuffer framebuffer)
+{
+	vk::CommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.setRenderPass(renderPass)
+		.setSubpass(0)
+		.setFramebuffer(framebuffer);
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
+		.setPInheritanceInfo(&inheritanceInfo);
+	commandBuffer.begin(beginInfo);
+}
+
 //-------------------------------------------------------------------------------------------------
 VkGraphicDevice::~VkGraphicDevice()
 {
@@ -66,32 +132,52 @@ VkGraphicDevice::~VkGraphicDevice()
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::init(GLFWwindow* window)
 {
-	engineAssert(window != nullptr, "GLFW Window not initialized");
+	engineAssert(m_headless || window != nullptr, "GLFW Window not initialized");
 	m_window = window;
+	const auto initStart = std::chrono::steady_clock::now();
 
 	createVkInstance();
 	//-- Create surface earlier than other devices types since we need it
 	//-- in checking queue that can support presentation operations
-	std::println("createSurface");
-	createSurface();
+	if (!m_headless)
+	{
+		std::println("createSurface");
+		createSurface();
+	}
 	std::println("setupPhysicalDevice");
 	setupPhysicalDevice();
 	std::println("createLogicalDevice");
 	createLogicalDevice();
-	std::println("createSwapchain");
-	createSwapchain();
+	if (m_headless)
+	{
+		std::println("createOffscreenImages");
+		createOffscreenImages();
+	}
+	else
+	{
+		std::println("createSwapchain");
+		createSwapchain();
+	}
 	std::println("createShaderModule");
 	createShaderModule();
 	std::println("createRenderPass");
 	createRenderPass();
 	std::println("createDescriptorSetLayout");
 	createDescriptorSetLayout();
+	std::println("createBindlessTextures");
+	createBindlessTextures();
+	std::println("createPipelineCache");
+	createPipelineCache();
 	std::println("createPipeline");
 	createPipeline();
+	std::println("createDepthResources");
+	createDepthResources();
 	std::println("createFramebuffer");
 	createFramebuffer();
 	std::println("createCommandPool");
 	createCommandPool();
+	std::println("createUploadContext");
+	createUploadContext();
 	std::println("createTextureSampler");
 	createTextureSampler();
 	std::println("createUniformBuffers");
@@ -102,9 +188,22 @@ void VkGraphicDevice::init(GLFWwindow* window)
 	createDescriptorsSets();
 	std::println("createCommandBuffer");
 	createCommandBuffer();
+	std::println("createRecordingSlots");
+	createRecordingSlots();
+	std::println("createQueryPools");
+	createQueryPools();
 	std::println("createSyncObjects");
 	createSyncObjects();
-	std::println("Vulkan objects initialized");
+	const auto initTime = std::chrono::steady_clock::now() - initStart;
+	std::println("Vulkan objects initialized in {:.1f} ms, {} start"
+		, std::chrono::duration<float, std::milli>(initTime).count()
+		, m_pipelineCacheWarm ? "warm" : "cold");
+
+	//-- Nothing to show UI on, renderer doesn't build ImGui frames either
+	if (m_headless)
+	{
+		return;
+	}
 
 	ImGuiInitInfo imGuiIntegrationInfo{
 		.m_apiVersion = apiVersion()
@@ -126,10 +225,18 @@ void VkGraphicDevice::init(GLFWwindow* window)
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::shutdown()
 {
-	m_imGuiIntegration.shutdown();
+	if (!m_headless)
+	{
+		m_imGuiIntegration.shutdown();
+	}
 
 	m_queues.m_graphicQueue.waitIdle();
 	m_queues.m_presentationQueue.waitIdle();
+	if (m_queues.m_transferQueue)
+	{
+		m_queues.m_transferQueue.waitIdle();
+	}
+	m_uploadContext.reset();
 
 	for (int i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
 	{
@@ -137,31 +244,54 @@ void VkGraphicDevice::shutdown()
 		m_logicalDevice.destroySemaphore(m_renderFinishedSemaphores[i]);
 		m_logicalDevice.destroyFence(m_inFlightFences[i]);
 	}
-	for (const auto& buf : m_uniformBuffers)
+	for (const auto& uniformBuffer : m_uniformBuffers)
 	{
-		m_logicalDevice.destroyBuffer(buf);
-	}
-	for (const auto& mem : m_uniformBuffersMemory)
-	{
-		m_logicalDevice.freeMemory(mem);
+		clearBuffer(uniformBuffer);
 	}
 	m_logicalDevice.destroyDescriptorPool(m_descriptorPool);
 	m_logicalDevice.destroyDescriptorSetLayout(m_uniformsSetLayout);
 	m_logicalDevice.destroyDescriptorSetLayout(m_texturesSetLayout);
+	m_logicalDevice.destroyDescriptorPool(m_bindlessDescriptorPool);
+	m_logicalDevice.destroyDescriptorSetLayout(m_bindlessSetLayout);
 	m_logicalDevice.freeCommandBuffers(m_commandPool, m_commandBuffers);
 	m_logicalDevice.destroyCommandPool(m_commandPool);
+	for (auto& frameSlots : m_recordingSlots)
+	{
+		for (const auto& slot : frameSlots)
+		{
+			//-- Buffers are freed together with their pool
+			m_logicalDevice.destroyCommandPool(slot.m_commandPool);
+		}
+		frameSlots.clear();
+	}
+	for (const auto& queryPool : m_overdrawQueryPools)
+	{
+		m_logicalDevice.destroyQueryPool(queryPool);
+	}
 	cleanupSwapchain();
 
 	m_logicalDevice.destroySampler(m_textureSampler);
 
-	m_logicalDevice.destroyPipeline(m_graphicsPipeline);
+	for (size_t pass = 0; pass < m_vertexPipelines.size(); ++pass)
+	{
+		m_logicalDevice.destroyPipeline(m_vertexPipelines[pass]);
+		m_logicalDevice.destroyPipeline(m_instancedPipelines[pass]);
+	}
+	savePipelineCache();
+	m_logicalDevice.destroyPipelineCache(m_pipelineCache);
 	m_logicalDevice.destroyPipelineLayout(m_pipelineLayout);
 	m_logicalDevice.destroyRenderPass(m_renderPass);
 	m_logicalDevice.destroyShaderModule(m_vertexShaderModule);
+	m_logicalDevice.destroyShaderModule(m_instancedVertexShaderModule);
 	m_logicalDevice.destroyShaderModule(m_fragmentShaderModule);
+	m_logicalDevice.destroyShaderModule(m_cutoutFragmentShaderModule);
+	m_memoryAllocator.reset();
 	m_logicalDevice.destroy();
 
-	m_vkInstance.destroySurfaceKHR(m_surface);
+	if (!m_headless)
+	{
+		m_vkInstance.destroySurfaceKHR(m_surface);
+	}
 	m_vkInstance.destroy();
 }
 
@@ -177,37 +307,79 @@ void VkGraphicDevice::beginFrame(float)
 	auto res = m_logicalDevice.waitForFences(m_inFlightFences[m_currFrame]
 		, vk::True
 		, UINT64_MAX);
+	readOverdrawQueries();
 
-	auto [result, imageIndex] = m_logicalDevice.acquireNextImageKHR(m_swapchain
-		, UINT64_MAX
-		, m_imageAvailableSemaphores[m_currFrame]);
-
-	m_currImageIndex = imageIndex;
-
-	if (result == vk::Result::eErrorOutOfDateKHR)
+	if (m_headless)
 	{
-		recreateSwapChain();
-		return;
+		//-- Offscreen image per frame in flight, the fence above already guards it
+		m_currImageIndex = m_currFrame;
 	}
-	else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+	else
 	{
-		throw std::runtime_error("failed to acquire swap chain image!");
+		auto [result, imageIndex] = m_logicalDevice.acquireNextImageKHR(m_swapchain
+			, UINT64_MAX
+			, m_imageAvailableSemaphores[m_currFrame]);
+
+		m_currImageIndex = imageIndex;
+
+		if (result == vk::Result::eErrorOutOfDateKHR)
+		{
+			recreateSwapChain();
+			return;
+		}
+		else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+		{
+			throw std::runtime_error("failed to acquire swap chain image!");
+		}
 	}
 	//-- Only reset the fence if we are submitting work
 	m_logicalDevice.resetFences(m_inFlightFences[m_currFrame]);
 
+	//-- Fence is passed, owners free relocated allocations only after theirs, so blocks they
+	//-- emptied aren't read by GPU anymore
+	m_memoryAllocator->releaseEmptyBlocks();
+	if (++m_framesSinceDefragment >= C_DEFRAGMENT_INTERVAL_FRAMES)
+	{
+		m_framesSinceDefragment = 0;
+		m_memoryAllocator->defragment(C_DEFRAGMENT_MAX_OCCUPANCY);
+	}
+
 	m_commandBuffers[m_currFrame].reset();
+	//-- Fence is passed, secondaries of this frame aren't used by GPU anymore
+	for (const auto& slot : m_recordingSlots[m_currFrame])
+	{
+		m_logicalDevice.resetCommandPool(slot.m_commandPool);
+	}
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::endFrame(const TexturedGeometryBatch& geometryBatch, const BatchIndecies& indicesBatch)
+void VkGraphicDevice::endFrame(const TexturedGeometryBatch& geometryBatch, vk::Buffer quadIndexBuffer)
 {
 	recordCommandBuffer(m_commandBuffers[m_currFrame]
 		, m_currImageIndex
 		, geometryBatch
-		, indicesBatch);
+		, quadIndexBuffer);
 	updateUniformBuffer();
 
+	//-- Uploads recorded since the last frame go first, same queue keeps them ordered
+	m_uploadContext->submit();
+
+	std::unique_lock queueLock(m_graphicQueueMutex);
+
+	//-- Nothing is presented, so there are no semaphores to wait on or signal
+	if (m_headless)
+	{
+		vk::SubmitInfo submitInfo = {};
+		submitInfo.setCommandBuffers(m_commandBuffers[m_currFrame]);
+		m_queues.m_graphicQueue.submit(submitInfo, m_inFlightFences[m_currFrame]);
+		queueLock.unlock();
+
+		m_lastImageIndex = m_currImageIndex;
+		m_frameSubmitted = true;
+		m_currFrame = (m_currFrame + 1) % C_MAX_FRAMES_IN_FLIGHT;
+		return;
+	}
+
 	//-- Submitting command buffer
 	vk::SubmitInfo         submitInfo = {};
 	vk::PipelineStageFlags waitStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
@@ -233,6 +405,7 @@ void VkGraphicDevice::endFrame(const TexturedGeometryBatch& geometryBatch, const
 	presentInfo.pImageIndices = &m_currImageIndex;
 
 	VkResult result = vkQueuePresentKHR(m_queues.m_presentationQueue, &presentInfo);
+	queueLock.unlock();
 
 	if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
@@ -248,16 +421,16 @@ void VkGraphicDevice::endFrame(const TexturedGeometryBatch& geometryBatch, const
 }
 
 //-------------------------------------------------------------------------------------------------
-auto VkGraphicDevice::createIndexBuffer(uint16_t spriteCount) -> VulkanBufferMemory
+auto VkGraphicDevice::createQuadIndexBuffer(uint32_t spriteCount) -> VulkanBufferMemory
 {
-	std::vector<uint16_t> indicies;
-	indicies.resize(spriteCount * 6);
+	std::vector<uint32_t> indicies;
+	indicies.resize(static_cast<size_t>(spriteCount) * 6);
 	constexpr uint32_t C_VERTICES_IN_QUAD = 4;
 	uint32_t           offset = 0;
 
 	for (uint32_t sprite = 0; sprite < spriteCount; ++sprite)
 	{
-		uint32_t baseIndex = sprite * 6;
+		size_t baseIndex = static_cast<size_t>(sprite) * 6;
 
 		indicies[baseIndex + 0] = offset + 0;
 		indicies[baseIndex + 1] = offset + 1;
@@ -270,34 +443,13 @@ auto VkGraphicDevice::createIndexBuffer(uint16_t spriteCount) -> VulkanBufferMem
 		offset += C_VERTICES_IN_QUAD;
 	}
 
-	VulkanBufferMemory resultMemory;
-
-	auto bufferSize = indicies.size() * sizeof(uint16_t);
-
-	vk::Buffer       stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
+	auto bufferSize = indicies.size() * sizeof(uint32_t);
 
-	createBuffer(bufferSize
-		, vk::BufferUsageFlagBits::eTransferSrc
-		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		, stagingBuffer
-		, stagingBufferMemory);
-
-	void* data = nullptr;
-	auto  res = m_logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize, {}, &data);
-	memcpy(data, indicies.data(), bufferSize);
-
-	m_logicalDevice.unmapMemory(stagingBufferMemory);
-
-	createBuffer(bufferSize
+	VulkanBufferMemory resultMemory = createBuffer(bufferSize
 		, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer
-		, vk::MemoryPropertyFlagBits::eDeviceLocal
-		, resultMemory.m_buffer
-		, resultMemory.m_bufferMem);
+		, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-	copyBuffer(stagingBuffer, resultMemory.m_buffer, bufferSize);
-	m_logicalDevice.destroyBuffer(stagingBuffer);
-	m_logicalDevice.freeMemory(stagingBufferMemory);
+	m_uploadContext->uploadBuffer(resultMemory.m_buffer, 0, indicies.data(), bufferSize);
 
 	return resultMemory;
 }
@@ -306,47 +458,7 @@ auto VkGraphicDevice::createIndexBuffer(uint16_t spriteCount) -> VulkanBufferMem
 void VkGraphicDevice::clearBuffer(VulkanBufferMemory memory)
 {
 	m_logicalDevice.destroyBuffer(memory.m_buffer);
-	m_logicalDevice.freeMemory(memory.m_bufferMem);
-}
-
-//-------------------------------------------------------------------------------------------------
-VulkanBufferMemory VkGraphicDevice::createCombinedVertexBuffer(const std::vector<std::array<VertexData, 4>>& sprites)
-{
-	size_t totalVertices = sprites.size() * 4;
-	auto   bufferSize = totalVertices * sizeof(VertexData);
-
-	VulkanBufferMemory resultMemory;
-	vk::Buffer         stagingBuffer;
-	vk::DeviceMemory   stagingBufferMemory;
-
-	createBuffer(bufferSize
-		, vk::BufferUsageFlagBits::eTransferSrc
-		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		, stagingBuffer
-		, stagingBufferMemory);
-
-	void* data = nullptr;
-	auto  mapResult = m_logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize, {}, &data);
-
-	VertexData* vertexData = static_cast<VertexData*>(data);
-	size_t      vertexIndex = 0;
-
-	memcpy(data, sprites.data(), bufferSize);
-
-	m_logicalDevice.unmapMemory(stagingBufferMemory);
-
-	createBuffer(bufferSize
-		, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer
-		, vk::MemoryPropertyFlagBits::eDeviceLocal
-		, resultMemory.m_buffer
-		, resultMemory.m_bufferMem);
-
-	copyBuffer(stagingBuffer, resultMemory.m_buffer, bufferSize);
-
-	m_logicalDevice.destroyBuffer(stagingBuffer);
-	m_logicalDevice.freeMemory(stagingBufferMemory);
-
-	return resultMemory;
+	freeMemory(memory.m_allocation);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -364,49 +476,24 @@ uint8_t VkGraphicDevice::currFrame() const
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::waitGraphicIdle()
 {
+	std::lock_guard queueLock(m_graphicQueueMutex);
 	m_queues.m_graphicQueue.waitIdle();
 }
 
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::updateUniformBuffer()
 {
-	int w = 0, h = 0;
-	glfwGetFramebufferSize(m_window, &w, &h);
-	if (w == 0)
-	{
-		w = 1;
-	}
-	if (h == 0)
-	{
-		h = 1;
-	}
-
 	UniformBufferObject ubo = {};
-	ubo.m_view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f)
-		, glm::vec3(0.0f, 0.0f, 0.0f)
-		, glm::vec3(0.0f, 1.0f, 0.0f));
-	ubo.m_proj = glm::perspective(glm::radians(45.0f), (float)w / (float)h, 0.1f, 10.0f);
-	ubo.m_proj[1][1] *= -1;
-	memcpy(m_uniformBuffersMapped[m_currFrame], &ubo, sizeof(UniformBufferObject));
+	ubo.m_view = m_camera.m_view;
+	ubo.m_proj = m_camera.m_proj;
+	memcpy(m_uniformBuffers[m_currFrame].m_allocation.m_mapped, &ubo, sizeof(UniformBufferObject));
 }
 
 //-------------------------------------------------------------------------------------------------
 uint32_t VkGraphicDevice::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
 {
-	vk::PhysicalDeviceMemoryProperties physDeviceMemProps = m_physicalDevice.getMemoryProperties();
-	std::vector<uint32_t>              indices(physDeviceMemProps.memoryTypeCount);
-	std::iota(indices.begin(), indices.end(), 0);
-
-	auto it = std::find_if(indices.begin()
-		, indices.end()
-		, [&](uint32_t i)
-		{
-			return (typeFilter & (1 << i)) &&
-				(physDeviceMemProps.memoryTypes[i].propertyFlags & properties) == properties;
-		});
-
-	engineAssert(it != indices.end(), std::format("Didn't find suitable memory type"));
-	return *it;
+	//-- Allocator keeps memory properties queried once on device creation
+	return m_memoryAllocator->findMemoryType(typeFilter, properties);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -433,12 +520,16 @@ void VkGraphicDevice::createVkInstance()
 	//-- Create collection to hold instance extensions
 	std::vector<const char*> instanceextensions;
 
-	uint32_t     extensionsCount = 0;
-	const char** glfwExtensionsList = glfwGetRequiredInstanceExtensions(&extensionsCount);
-	instanceextensions.reserve(extensionsCount);
-	for (uint32_t i = 0; i < extensionsCount; ++i)
+	//-- Headless device has no surface, so it needs no window system extensions
+	if (!m_headless)
 	{
-		instanceextensions.push_back(glfwExtensionsList[i]);
+		uint32_t     extensionsCount = 0;
+		const char** glfwExtensionsList = glfwGetRequiredInstanceExtensions(&extensionsCount);
+		instanceextensions.reserve(extensionsCount);
+		for (uint32_t i = 0; i < extensionsCount; ++i)
+		{
+			instanceextensions.push_back(glfwExtensionsList[i]);
+		}
 	}
 
 	//-- Check if all requested extensions supported
@@ -477,6 +568,10 @@ void VkGraphicDevice::createLogicalDevice()
 		m_physicalDeviceData.m_queueFamilies.m_graphicQueue
 		, m_physicalDeviceData.m_queueFamilies.m_presentationQueue
 	};
+	if (m_physicalDeviceData.m_queueFamilies.m_transferQueue >= 0)
+	{
+		queueFamilyIdices.insert(m_physicalDeviceData.m_queueFamilies.m_transferQueue);
+	}
 	queuesCreateInfos.reserve(queueFamilyIdices.size());
 
 	for (int queueIndex : queueFamilyIdices)
@@ -486,14 +581,51 @@ void VkGraphicDevice::createLogicalDevice()
 		vk::DeviceQueueCreateInfo queueCreateInfo({}, queueIndex, 1, &priority);
 		queuesCreateInfos.push_back(queueCreateInfo);
 	}
+	//-- Descriptor indexing is core since 1.2, older devices expose it as extension
+	std::vector<const char*> deviceExtensions = requiredDeviceExtensions();
+	m_bindlessTextures = m_bindlessRequested && checkDescriptorIndexingSupport(m_physicalDevice);
+	if (m_bindlessTextures && m_physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_2)
+	{
+		deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
+	std::println("Bindless textures: {}", m_bindlessTextures ? "enabled" : "disabled");
+
+	vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+	indexingFeatures.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE)
+		.setDescriptorBindingPartiallyBound(VK_TRUE)
+		.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE)
+		.setRuntimeDescriptorArray(VK_TRUE);
+
+	//-- Compressed formats are enabled when present, textures fall back to RGBA8 otherwise
+	const vk::PhysicalDeviceFeatures supportedFeatures = m_physicalDevice.getFeatures();
+
 	//-- Device info itself
 	vk::PhysicalDeviceFeatures deviceFeatures = {};
-	deviceFeatures.setSamplerAnisotropy(VK_TRUE);
+	deviceFeatures.setSamplerAnisotropy(supportedFeatures.samplerAnisotropy)
+		.setTextureCompressionBC(supportedFeatures.textureCompressionBC)
+		.setTextureCompressionASTC_LDR(supportedFeatures.textureCompressionASTC_LDR)
+		.setPipelineStatisticsQuery(supportedFeatures.pipelineStatisticsQuery);
+	m_pipelineStatistics = supportedFeatures.pipelineStatisticsQuery;
+	//-- Software rasterizers may lack it, sprites are sampled without it then
+	m_samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
+	m_supportedTextureFormats[static_cast<size_t>(TextureFormat::RGBA8)] = true;
+	m_supportedTextureFormats[static_cast<size_t>(TextureFormat::BC3)] = checkTextureFormatSupport(vk::Format::eBc3UnormBlock
+		, supportedFeatures.textureCompressionBC);
+	m_supportedTextureFormats[static_cast<size_t>(TextureFormat::BC7)] = checkTextureFormatSupport(vk::Format::eBc7UnormBlock
+		, supportedFeatures.textureCompressionBC);
+	m_supportedTextureFormats[static_cast<size_t>(TextureFormat::ASTC4x4)] = checkTextureFormatSupport(vk::Format::eAstc4x4UnormBlock
+		, supportedFeatures.textureCompressionASTC_LDR);
+	std::println("Texture compression: BC {}, ASTC {}"
+		, supportedFeatures.textureCompressionBC ? "supported" : "unsupported"
+		, supportedFeatures.textureCompressionASTC_LDR ? "supported" : "unsupported");
+	std::println("Overdraw measurement: {}", m_pipelineStatistics ? "enabled" : "disabled");
 	vk::DeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.setQueueCreateInfos(queuesCreateInfos)
 		.setPEnabledFeatures(&deviceFeatures)
-		.setEnabledExtensionCount(C_DEVICE_EXTENSIONS.size())
-		.setPEnabledExtensionNames(C_DEVICE_EXTENSIONS);
+		.setEnabledExtensionCount(deviceExtensions.size())
+		.setPEnabledExtensionNames(deviceExtensions)
+		.setPNext(m_bindlessTextures ? &indexingFeatures : nullptr);
 
 	//-- Creating logical device
 	auto [res, device] = m_physicalDevice.createDevice(deviceCreateInfo);
@@ -508,6 +640,16 @@ void VkGraphicDevice::createLogicalDevice()
 	m_logicalDevice.getQueue(m_physicalDeviceData.m_queueFamilies.m_presentationQueue
 		, 0
 		, &m_queues.m_presentationQueue);
+
+	if (m_physicalDeviceData.m_queueFamilies.m_transferQueue >= 0)
+	{
+		m_logicalDevice.getQueue(m_physicalDeviceData.m_queueFamilies.m_transferQueue
+			, 0
+			, &m_queues.m_transferQueue);
+	}
+	std::println("Dedicated transfer queue: {}", m_queues.m_transferQueue ? "enabled" : "disabled");
+
+	m_memoryAllocator = std::make_unique<GpuMemoryAllocator>(m_logicalDevice, m_physicalDevice.getMemoryProperties());
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -522,7 +664,10 @@ void VkGraphicDevice::createSurface()
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::recreateSwapChain()
 {
-	m_logicalDevice.waitIdle();
+	{
+		std::lock_guard queueLock(m_graphicQueueMutex);
+		m_logicalDevice.waitIdle();
+	}
 
 	cleanupSwapchain();
 
@@ -531,6 +676,7 @@ void VkGraphicDevice::recreateSwapChain()
 	m_physicalDeviceData.m_swapchainDetails = swapchainDetails(m_physicalDevice);
 
 	createSwapchain();
+	createDepthResources();
 	createFramebuffer();
 }
 
@@ -597,37 +743,109 @@ void VkGraphicDevice::createSwapchain()
 	m_imageExtent = extent;
 }
 
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createOffscreenImages()
+{
+	//-- Same layout as on screen, so readback bytes go to image data as they are
+	m_surfaceFormat = vk::SurfaceFormatKHR(vk::Format::eR8G8B8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear);
+	m_imageExtent = vk::Extent2D(std::max(m_camera.m_framebufferSize.x, 1u), std::max(m_camera.m_framebufferSize.y, 1u));
+
+	for (int i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		vk::ImageCreateInfo imageInfo = {};
+		imageInfo.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(m_imageExtent.width, m_imageExtent.height, 1))
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setFormat(m_surfaceFormat.format)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+		auto [res, image] = m_logicalDevice.createImage(imageInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to create offscreen image");
+
+		SwapchainImage offscreenImage;
+		offscreenImage.m_image = image;
+		offscreenImage.m_memory = allocateImageMemory(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		offscreenImage.m_imageView = createImageView(image, m_surfaceFormat.format, vk::ImageAspectFlagBits::eColor);
+		m_swapchainImages.push_back(offscreenImage);
+	}
+	std::println("Headless rendering into {} offscreen images {}x{}"
+		, m_swapchainImages.size()
+		, m_imageExtent.width
+		, m_imageExtent.height);
+}
+
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::createShaderModule()
 {
 	constexpr auto C_V_SHADER = "shaders/hello.vert";
 	constexpr auto C_F_SHADER = "shaders/hello.frag";
+	constexpr auto C_INSTANCED_V_SHADER = "shaders/sprite_instanced.vert";
+
+	const auto shadersStart = std::chrono::steady_clock::now();
+
+	auto&          vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	ShaderManifest manifest;
+	const bool     cooked = manifest.load(vfs);
+#ifdef ENGINE_SHADER_COMPILER
+	//-- Development path: sources are compiled through SPIR-V cache, changed ones only
+	const bool  compileShaders = m_compileShadersRequested || !cooked;
+	ShaderCache shaderCache(vfs);
+#else
+	engineAssert(cooked, "Shader manifest is missing, build shader_cooker target first");
+	if (m_compileShadersRequested)
+	{
+		std::println("Shaders: engine is built without shader compiler, using cooked ones");
+	}
+#endif
 
-	auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
-	engineAssert(vfs.isFileExist(C_V_SHADER), "Shader don't exist");
-	engineAssert(vfs.isFileExist(C_F_SHADER), "Shader don't exist");
-
-	auto full_vertex_shader_path = vfs.virtualToNativePath(C_V_SHADER);
-	auto full_fragment_shader_path = vfs.virtualToNativePath(C_F_SHADER);
-
-	std::cout << std::format("Vertex Shader path: '{}'", full_vertex_shader_path.generic_string()) << std::endl;
-	std::cout << std::format("Fragment Shader path: '{}'", full_fragment_shader_path.generic_string()) << std::endl;
-
-	auto vertexShaderFile = m_engineContext->m_managerHolder.getManager<VirtualFS>().loadFile(full_vertex_shader_path.generic_string());
-	auto fragmentShaderFile = m_engineContext->m_managerHolder.getManager<VirtualFS>().loadFile(full_fragment_shader_path.generic_string());
-
-	std::vector<uint32_t> compiled_vertex_shader = compileShaderFromSource(
-		vertexShaderFile.toString()
-		, shaderc_vertex_shader
-		, "test_vertex_shader"
-	);
-	std::vector<uint32_t> compiled_fragment_shader = compileShaderFromSource(
-		fragmentShaderFile.toString()
-		, shaderc_fragment_shader
-		, "test_fragment_shader"
-	);
+	auto loadSpirv = [&](const char* path, ShaderStage stage, const std::vector<std::string>& macros = {})
+	{
+#ifdef ENGINE_SHADER_COMPILER
+		if (compileShaders)
+		{
+			return shaderCache.spirv(path, stage, macros);
+		}
+#endif
+		const ShaderManifestEntry* entry = manifest.find(path, stage, macros);
+		engineAssert(entry != nullptr
+			, std::format("Shader '{}' ({}) [{}] isn't cooked", path, shaderStageName(stage), joinShaderMacros(macros)));
+
+		const File blob = vfs.loadFile(entry->m_spirvPath);
+		engineAssert(!blob.m_buffer.empty() && blob.m_buffer.size() % sizeof(uint32_t) == 0
+			, std::format("Cooked shader '{}' is broken", entry->m_spirvPath));
+
+		std::vector<uint32_t> code(blob.m_buffer.size() / sizeof(uint32_t));
+		memcpy(code.data(), blob.m_buffer.data(), blob.m_buffer.size());
+		return code;
+	};
 
-	std::cout << "Successfully compiled shaders" << std::endl;
+	std::vector<std::string> fragmentMacros;
+	if (m_bindlessTextures)
+	{
+		fragmentMacros.push_back("BINDLESS_TEXTURES");
+	}
+	std::vector<uint32_t> compiled_vertex_shader = loadSpirv(C_V_SHADER, ShaderStage::Vertex);
+	std::vector<uint32_t> compiled_fragment_shader = loadSpirv(C_F_SHADER, ShaderStage::Fragment, fragmentMacros);
+	fragmentMacros.push_back("ALPHA_CUTOUT");
+	std::vector<uint32_t> compiled_cutout_fragment_shader = loadSpirv(C_F_SHADER, ShaderStage::Fragment, fragmentMacros);
+	std::vector<uint32_t> compiled_instanced_vertex_shader = loadSpirv(C_INSTANCED_V_SHADER, ShaderStage::Vertex);
+
+	const auto  shadersTime = std::chrono::steady_clock::now() - shadersStart;
+	std::string shadersSource = "cooked";
+#ifdef ENGINE_SHADER_COMPILER
+	if (compileShaders)
+	{
+		shadersSource = std::format("{} from cache, {} compiled", shaderCache.hitsCount(), shaderCache.compiledCount());
+	}
+#endif
+	std::println("Shaders: {} in {:.1f} ms"
+		, shadersSource
+		, std::chrono::duration<float, std::milli>(shadersTime).count());
 
 	vk::ShaderModuleCreateInfo vertexShaderModuleCreateInfo = {};
 	vertexShaderModuleCreateInfo.setCodeSize(compiled_vertex_shader.size() * sizeof(uint32_t))
@@ -644,6 +862,22 @@ void VkGraphicDevice::createShaderModule()
 	auto [fRes, fragmentShaderModule] = m_logicalDevice.createShaderModule(fragmentShaderModuleCreateInfo);
 	engineAssert(fRes == vk::Result::eSuccess, "Failed to create fragment shader module");
 	m_fragmentShaderModule = fragmentShaderModule;
+
+	vk::ShaderModuleCreateInfo cutoutFragmentShaderModuleCreateInfo = {};
+	cutoutFragmentShaderModuleCreateInfo.setCodeSize(compiled_cutout_fragment_shader.size() * sizeof(uint32_t))
+		.setPCode(compiled_cutout_fragment_shader.data());
+
+	auto [cRes, cutoutFragmentShaderModule] = m_logicalDevice.createShaderModule(cutoutFragmentShaderModuleCreateInfo);
+	engineAssert(cRes == vk::Result::eSuccess, "Failed to create cutout fragment shader module");
+	m_cutoutFragmentShaderModule = cutoutFragmentShaderModule;
+
+	vk::ShaderModuleCreateInfo instancedVertexShaderModuleCreateInfo = {};
+	instancedVertexShaderModuleCreateInfo.setCodeSize(compiled_instanced_vertex_shader.size() * sizeof(uint32_t))
+		.setPCode(compiled_instanced_vertex_shader.data());
+
+	auto [iRes, instancedVertexShaderModule] = m_logicalDevice.createShaderModule(instancedVertexShaderModuleCreateInfo);
+	engineAssert(iRes == vk::Result::eSuccess, "Failed to create instanced vertex shader module");
+	m_instancedVertexShaderModule = instancedVertexShaderModule;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -682,6 +916,8 @@ void VkGraphicDevice::createDescriptorSetLayout()
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::createPipeline()
 {
+	const auto pipelinesStart = std::chrono::steady_clock::now();
+
 	vk::PipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {};
 	vertexShaderStageCreateInfo.setStage(vk::ShaderStageFlagBits::eVertex)
 		.setModule(m_vertexShaderModule)
@@ -744,7 +980,8 @@ void VkGraphicDevice::createPipeline()
 		.setRasterizerDiscardEnable(VK_FALSE)
 		.setPolygonMode(vk::PolygonMode::eFill) //-- Try line
 		.setLineWidth(1.0f)
-		.setCullMode(vk::CullModeFlagBits::eBack)
+		//-- Mirrored transforms flip winding of sprite quads, both sides are drawn
+		.setCullMode(vk::CullModeFlagBits::eNone)
 		.setFrontFace(vk::FrontFace::eCounterClockwise)
 		.setDepthBiasEnable(VK_FALSE);
 
@@ -765,6 +1002,18 @@ void VkGraphicDevice::createPipeline()
 		.setDstAlphaBlendFactor(vk::BlendFactor::eZero)
 		.setAlphaBlendOp(vk::BlendOp::eAdd);
 
+	//-- Opaque and cutout sprites overwrite color, translucent ones blend over them
+	vk::PipelineColorBlendAttachmentState opaqueBlendAttachment = colorBlendAttachment;
+	opaqueBlendAttachment.setBlendEnable(VK_FALSE);
+
+	//-- Less or equal lets later sprite of the same depth win, as with blending only
+	vk::PipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.setDepthTestEnable(VK_TRUE)
+		.setDepthWriteEnable(VK_TRUE)
+		.setDepthCompareOp(vk::CompareOp::eLessOrEqual)
+		.setDepthBoundsTestEnable(VK_FALSE)
+		.setStencilTestEnable(VK_FALSE);
+
 	//-- TODO: Check how to use it
 	vk::PipelineColorBlendStateCreateInfo colorBlending = {};
 	colorBlending.setLogicOpEnable(VK_FALSE)
@@ -773,7 +1022,10 @@ void VkGraphicDevice::createPipeline()
 		.setPAttachments(&colorBlendAttachment);
 
 	//-- We will need layout for uniforms
-	std::array<vk::DescriptorSetLayout, 2> layouts = { m_uniformsSetLayout, m_texturesSetLayout };
+	std::array<vk::DescriptorSetLayout, 2> layouts = {
+		m_uniformsSetLayout
+		, m_bindlessTextures ? m_bindlessSetLayout : m_texturesSetLayout
+	};
 	vk::PipelineLayoutCreateInfo           pipelineLayoutInfo = {};
 	pipelineLayoutInfo.setSetLayouts(layouts)
 		.setSetLayoutCount(2);
@@ -792,7 +1044,7 @@ void VkGraphicDevice::createPipeline()
 		.setPViewportState(&viewportStateCreateInfo)
 		.setPRasterizationState(&rasterizerCreateInfo)
 		.setPMultisampleState(&multisampling)
-		.setPDepthStencilState(nullptr) // Optional
+		.setPDepthStencilState(&depthStencil)
 		.setPColorBlendState(&colorBlending)
 		.setPDynamicState(&dynamicStateCreateInfo)
 		//-- Layout, describing uniforms
@@ -800,14 +1052,103 @@ void VkGraphicDevice::createPipeline()
 		//-- Render pass
 		.setRenderPass(m_renderPass)
 		.setSubpass(0);
+
+	//-- Passes differ by fragment variant, depth write and blending only
+	auto createSpritePipelines = [&](SpritePipelines& pipelines)
+		{
+			for (size_t pass = 0; pass < pipelines.size(); ++pass)
+			{
+				const bool cutout = static_cast<SpritePass>(pass) == SpritePass::Cutout;
+				const bool translucent = static_cast<SpritePass>(pass) == SpritePass::Translucent;
+				shaderStages[1].setModule(cutout ? m_cutoutFragmentShaderModule : m_fragmentShaderModule);
+				depthStencil.setDepthWriteEnable(translucent ? VK_FALSE : VK_TRUE);
+				colorBlending.setPAttachments(translucent ? &colorBlendAttachment : &opaqueBlendAttachment);
+
+				auto res = m_logicalDevice.createGraphicsPipelines(m_pipelineCache
+					, 1
+					, &pipelineInfo
+					, nullptr
+					, &pipelines[pass]);
+				engineAssert(res == vk::Result::eSuccess, "Failed to createGraphicsPipelines");
+			}
+		};
+	createSpritePipelines(m_vertexPipelines);
+
+	//-- Instanced sprites pipeline differs only by vertex stage and per instance input
+	auto instanceBindingDescription = getInstanceBindingDescription();
+	auto instanceAttributeDescriptions = getInstanceAttributeDescriptions();
+	vertexInputCreateInfo.setVertexBindingDescriptions(instanceBindingDescription)
+		.setVertexAttributeDescriptions(instanceAttributeDescriptions);
+	shaderStages[0].setModule(m_instancedVertexShaderModule);
+	createSpritePipelines(m_instancedPipelines);
+
+	const auto pipelinesTime = std::chrono::steady_clock::now() - pipelinesStart;
+	std::println("Pipelines: created in {:.1f} ms, {} pipeline cache"
+		, std::chrono::duration<float, std::milli>(pipelinesTime).count()
+		, m_pipelineCacheWarm ? "warm" : "cold");
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createPipelineCache()
+{
+	auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+
+	//-- Blob of another driver or device is rejected here, driver would ignore it at best
+	std::vector<char> initialData;
+	if (vfs.isFileExist(ShaderCacheConfig::C_PIPELINE_CACHE_PATH))
+	{
+		initialData = vfs.loadFile(ShaderCacheConfig::C_PIPELINE_CACHE_PATH).m_buffer;
+		if (!checkPipelineCacheCompatible(initialData))
+		{
+			std::println("Pipeline cache: stored blob doesn't match device, starting empty");
+			initialData.clear();
+		}
+	}
+	m_pipelineCacheWarm = !initialData.empty();
+
+	vk::PipelineCacheCreateInfo createInfo = {};
+	createInfo.setInitialDataSize(initialData.size())
+		.setPInitialData(initialData.data());
+
+	auto [res, pipelineCache] = m_logicalDevice.createPipelineCache(createInfo);
+	engineAssert(res == vk::Result::eSuccess, "Failed to createPipelineCache");
+	m_pipelineCache = pipelineCache;
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::savePipelineCache()
+{
+	auto [res, data] = m_logicalDevice.getPipelineCacheData(m_pipelineCache);
+	if (res != vk::Result::eSuccess || data.empty())
+	{
+		return;
+	}
+
+	auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	std::filesystem::create_directories(vfs.virtualToNativePath(ShaderCacheConfig::C_PIPELINE_CACHE_PATH).parent_path());
+
+	File file = vfs.createFile(ShaderCacheConfig::C_PIPELINE_CACHE_PATH);
+	file.m_buffer.assign(data.begin(), data.end());
+	vfs.writeFile(file);
+}
+
+//-------------------------------------------------------------------------------------------------
+bool VkGraphicDevice::checkPipelineCacheCompatible(const std::vector<char>& data) const
+{
+	//-- Header layout is fixed by VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+	VkPipelineCacheHeaderVersionOne header = {};
+	if (data.size() < sizeof(header))
 	{
-		auto res = m_logicalDevice.createGraphicsPipelines(VK_NULL_HANDLE
-			, 1
-			, &pipelineInfo
-			, nullptr
-			, &m_graphicsPipeline);
-		engineAssert(res == vk::Result::eSuccess, "Failed to createGraphicsPipelines");
+		return false;
 	}
+	memcpy(&header, data.data(), sizeof(header));
+
+	const vk::PhysicalDeviceProperties props = m_physicalDevice.getProperties();
+	return header.headerSize >= sizeof(header)
+	       && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+	       && header.vendorID == props.vendorID
+	       && header.deviceID == props.deviceID
+	       && memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -821,27 +1162,48 @@ void VkGraphicDevice::createRenderPass()
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+		.setFinalLayout(m_headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR);
+
+	//-- Depth lives only inside the pass, it's never stored
+	m_depthFormat = chooseDepthFormat();
+	vk::AttachmentDescription depthAttachment = {};
+	depthAttachment.setFormat(m_depthFormat)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setLoadOp(vk::AttachmentLoadOp::eClear)
+		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
 	vk::AttachmentReference colorAttachmentRef = {};
 	colorAttachmentRef.setAttachment(0)
 		.setLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
+	vk::AttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.setAttachment(1)
+		.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
 	vk::SubpassDescription subpass = {};
 	subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
 		.setColorAttachmentCount(1)
-		.setPColorAttachments(&colorAttachmentRef);
+		.setPColorAttachments(&colorAttachmentRef)
+		.setPDepthStencilAttachment(&depthAttachmentRef);
 
+	//-- Depth image is shared by frames in flight, clear waits for depth tests of the previous frame
 	vk::SubpassDependency dependency = {};
 	dependency.setSrcSubpass(VK_SUBPASS_EXTERNAL)
 		.setDstSubpass(0)
-		.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+		.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests)
+		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+		.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+	const std::array<vk::AttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 
 	vk::RenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.setAttachmentCount(1)
-		.setAttachments(colorAttachment)
+	renderPassInfo.setAttachmentCount(attachments.size())
+		.setAttachments(attachments)
 		.setSubpassCount(1)
 		.setSubpasses(subpass)
 		.setDependencyCount(1)
@@ -852,18 +1214,40 @@ void VkGraphicDevice::createRenderPass()
 	m_renderPass = renderPass;
 }
 
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createDepthResources()
+{
+	vk::ImageCreateInfo imageInfo = {};
+	imageInfo.setImageType(vk::ImageType::e2D)
+		.setExtent(vk::Extent3D(m_imageExtent.width, m_imageExtent.height, 1))
+		.setMipLevels(1)
+		.setArrayLayers(1)
+		.setFormat(m_depthFormat)
+		.setTiling(vk::ImageTiling::eOptimal)
+		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	auto [res, image] = m_logicalDevice.createImage(imageInfo);
+	engineAssert(res == vk::Result::eSuccess, "Failed to create depth image");
+	m_depthImage = image;
+	m_depthImageMemory = allocateImageMemory(m_depthImage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	m_depthImageView = createImageView(m_depthImage, m_depthFormat, vk::ImageAspectFlagBits::eDepth);
+}
+
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::createFramebuffer()
 {
 	m_swapChainFramebuffers.resize(m_swapchainImages.size());
 	int i = 0;
-	for (const auto& [_, imageView] : m_swapchainImages)
+	for (const auto& swapchainImage : m_swapchainImages)
 	{
-		std::array<vk::ImageView, 1> attachments = { imageView };
+		std::array<vk::ImageView, 2> attachments = { swapchainImage.m_imageView, m_depthImageView };
 
 		vk::FramebufferCreateInfo framebufferInfo = {};
 		framebufferInfo.setRenderPass(m_renderPass)
-			.setAttachmentCount(1)
+			.setAttachmentCount(attachments.size())
 			.setPAttachments(attachments.data())
 			.setWidth(m_imageExtent.width)
 			.setHeight(m_imageExtent.height)
@@ -888,27 +1272,46 @@ void VkGraphicDevice::createCommandPool()
 	m_commandPool = commandPool;
 }
 
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createUploadContext()
+{
+	const QueueFamilies& queueFamilies = m_physicalDeviceData.m_queueFamilies;
+
+	UploadQueues uploadQueues = {};
+	uploadQueues.m_graphicQueue = m_queues.m_graphicQueue;
+	uploadQueues.m_graphicFamily = queueFamilies.m_graphicQueue;
+	uploadQueues.m_graphicQueueMutex = &m_graphicQueueMutex;
+	if (queueFamilies.m_transferQueue >= 0)
+	{
+		uploadQueues.m_transferQueue = m_queues.m_transferQueue;
+		uploadQueues.m_transferFamily = queueFamilies.m_transferQueue;
+	}
+
+	m_uploadContext = std::make_unique<UploadContext>(m_logicalDevice, *m_memoryAllocator, uploadQueues);
+}
+
 //-------------------------------------------------------------------------------------------------
 void VkGraphicDevice::createTextureSampler()
 {
 	const auto            props = m_physicalDevice.getProperties();
 	const auto            maxAnisotropy = props.limits.maxSamplerAnisotropy;
 	vk::SamplerCreateInfo createInfo = {};
+	//-- Minified sprites blend between mips, magnified ones keep pixel art crisp
 	createInfo.setMagFilter(vk::Filter::eNearest)
-		.setMinFilter(vk::Filter::eNearest)
+		.setMinFilter(vk::Filter::eLinear)
 		.setAddressModeU(vk::SamplerAddressMode::eRepeat)
 		.setAddressModeV(vk::SamplerAddressMode::eRepeat)
 		.setAddressModeW(vk::SamplerAddressMode::eRepeat)
-		.setAnisotropyEnable(VK_TRUE)
-		.setMaxAnisotropy(maxAnisotropy)
+		.setAnisotropyEnable(m_samplerAnisotropy)
+		.setMaxAnisotropy(m_samplerAnisotropy ? maxAnisotropy : 1.0f)
 		.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
 		.setUnnormalizedCoordinates(VK_FALSE)
 		.setCompareEnable(VK_FALSE)
 		.setCompareOp(vk::CompareOp::eAlways)
-		.setMipmapMode(vk::SamplerMipmapMode::eNearest)
+		.setMipmapMode(vk::SamplerMipmapMode::eLinear)
 		.setMipLodBias(0.0f)
 		.setMinLod(0.0f)
-		.setMaxLod(0.0f);
+		.setMaxLod(VK_LOD_CLAMP_NONE);
 
 	auto [res, sampler] = m_logicalDevice.createSampler(createInfo);
 	engineAssert(res == vk::Result::eSuccess, "Failed to createSampler");
@@ -921,22 +1324,13 @@ void VkGraphicDevice::createUniformBuffers()
 	auto bufferSize = sizeof(UniformBufferObject);
 
 	m_uniformBuffers.resize(C_MAX_FRAMES_IN_FLIGHT);
-	m_uniformBuffersMemory.resize(C_MAX_FRAMES_IN_FLIGHT);
-	m_uniformBuffersMapped.resize(C_MAX_FRAMES_IN_FLIGHT);
 
+	//-- Host visible blocks are persistently mapped by allocator
 	for (uint32_t i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		createBuffer(bufferSize
+		m_uniformBuffers[i] = createBuffer(bufferSize
 			, vk::BufferUsageFlagBits::eUniformBuffer
-			, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-			, m_uniformBuffers[i]
-			, m_uniformBuffersMemory[i]);
-
-		auto res = m_logicalDevice.mapMemory(m_uniformBuffersMemory[i]
-			, 0
-			, bufferSize
-			, {}
-		, &m_uniformBuffersMapped[i]);
+			, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 	}
 }
 
@@ -974,7 +1368,7 @@ void VkGraphicDevice::createDescriptorsSets()
 	for (uint32_t i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		vk::DescriptorBufferInfo bufferInfo = {};
-		bufferInfo.setBuffer(m_uniformBuffers[i])
+		bufferInfo.setBuffer(m_uniformBuffers[i].m_buffer)
 			.setOffset(0)
 			.setRange(sizeof(UniformBufferObject));
 
@@ -997,29 +1391,309 @@ void VkGraphicDevice::freeDescriptorSetFromPool(vk::DescriptorSet& descriptorSet
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::createCommandBuffer()
+void VkGraphicDevice::createBindlessTextures()
 {
-	vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {};
-	commandBufferAllocateInfo.setCommandBufferCount(C_MAX_FRAMES_IN_FLIGHT)
-		.setCommandPool(m_commandPool)
-		.setLevel(vk::CommandBufferLevel::ePrimary);
+	if (!m_bindlessTextures)
+	{
+		return;
+	}
 
-	auto [res, commandBuffers] = m_logicalDevice.allocateCommandBuffers(commandBufferAllocateInfo);
-	engineAssert(res == vk::Result::eSuccess, "Failed to allocateCommandBuffers");
-	m_commandBuffers = commandBuffers;
+	vk::PhysicalDeviceDescriptorIndexingProperties indexingProps = {};
+	vk::PhysicalDeviceProperties2                  props = {};
+	props.setPNext(&indexingProps);
+	m_physicalDevice.getProperties2(&props);
+
+	m_maxBindlessTextures = std::min({ C_MAX_BINDLESS_TEXTURES
+		, indexingProps.maxDescriptorSetUpdateAfterBindSampledImages
+		, indexingProps.maxDescriptorSetUpdateAfterBindSamplers
+		, indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages
+		, indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+	//-- Partially bound lets free slots stay empty, update after bind lets textures be added
+	//-- while the set is bound by frames in flight
+	vk::DescriptorSetLayoutBinding texturesBinding = {};
+	texturesBinding.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setDescriptorCount(m_maxBindlessTextures)
+		.setBinding(0)
+		.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+
+	const vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound
+		| vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.setBindingFlags(bindingFlags);
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.setBindings(texturesBinding)
+		.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+		.setPNext(&bindingFlagsInfo);
+	{
+		auto [res, bindlessSetLayout] = m_logicalDevice.createDescriptorSetLayout(layoutInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to create bindless descriptor set layout");
+		m_bindlessSetLayout = bindlessSetLayout;
+	}
+
+	vk::DescriptorPoolSize poolSize = {};
+	poolSize.setType(vk::DescriptorType::eCombinedImageSampler)
+		.setDescriptorCount(m_maxBindlessTextures);
+
+	vk::DescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.setPoolSizes(poolSize)
+		.setMaxSets(1)
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind);
+	{
+		auto [res, bindlessPool] = m_logicalDevice.createDescriptorPool(poolInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to create bindless descriptor pool");
+		m_bindlessDescriptorPool = bindlessPool;
+	}
+
+	vk::DescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.setDescriptorPool(m_bindlessDescriptorPool)
+		.setSetLayouts(m_bindlessSetLayout);
+	{
+		auto [res, bindlessSets] = m_logicalDevice.allocateDescriptorSets(allocInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to allocate bindless descriptor set");
+		m_bindlessDescriptorSet = bindlessSets[0];
+	}
+
+	std::println("Bindless texture slots: {}", m_maxBindlessTextures);
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::createSyncObjects()
+uint32_t VkGraphicDevice::registerBindlessTexture(vk::ImageView imageView)
 {
-	m_imageAvailableSemaphores.reserve(C_MAX_FRAMES_IN_FLIGHT);
-	m_renderFinishedSemaphores.reserve(C_MAX_FRAMES_IN_FLIGHT);
-	m_inFlightFences.reserve(C_MAX_FRAMES_IN_FLIGHT);
+	engineAssert(m_bindlessTextures, "Bindless textures are not enabled");
 
-	vk::FenceCreateInfo fenceInfo = {};
-	fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-
-	for (int i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
+	uint32_t textureSlot = 0;
+	if (!m_freeBindlessSlots.empty())
+	{
+		textureSlot = m_freeBindlessSlots.back();
+		m_freeBindlessSlots.pop_back();
+	}
+	else
+	{
+		engineAssert(m_bindlessSlotsUsed < m_maxBindlessTextures, "Out of bindless texture slots");
+		textureSlot = m_bindlessSlotsUsed++;
+	}
+
+	vk::DescriptorImageInfo imageInfo = {};
+	imageInfo.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+		.setImageView(imageView)
+		.setSampler(m_textureSampler);
+
+	vk::WriteDescriptorSet descriptorsWrite = {};
+	descriptorsWrite.setImageInfo(imageInfo)
+		.setDstSet(m_bindlessDescriptorSet)
+		.setDstBinding(0)
+		.setDstArrayElement(textureSlot)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setDescriptorCount(1);
+
+	m_logicalDevice.updateDescriptorSets(descriptorsWrite, {});
+
+	return textureSlot;
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::unregisterBindlessTexture(uint32_t textureSlot)
+{
+	//-- Slot stays written until reused, no sprite references it after texture is gone
+	m_freeBindlessSlots.push_back(textureSlot);
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuTexture VkGraphicDevice::createTexture(const TextureData& texture)
+{
+	const vk::Format vkFormat = textureVkFormat(texture.m_format);
+	const uint32_t   mipLevels = static_cast<uint32_t>(texture.m_mips.size());
+
+	vk::ImageCreateInfo imageInfo = {};
+	imageInfo.setImageType(vk::ImageType::e2D)
+		.setExtent(vk::Extent3D(texture.width(), texture.height(), 1))
+		.setMipLevels(mipLevels)
+		.setArrayLayers(1)
+		.setFormat(vkFormat)
+		.setTiling(vk::ImageTiling::eOptimal)
+		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setUsage(vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	GpuTexture gpuTexture;
+	auto [imageRes, image] = m_logicalDevice.createImage(imageInfo);
+	engineAssert(imageRes == vk::Result::eSuccess, "Failed to create texture image");
+	gpuTexture.m_image = image;
+	gpuTexture.m_memory = allocateImageMemory(gpuTexture.m_image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+	//-- Upload is recorded into frame batch, all levels are copied into staging right away
+	gpuTexture.m_uploadTicket = m_uploadContext->uploadTexture(gpuTexture.m_image, texture);
+
+	vk::ImageViewCreateInfo viewInfo = {};
+	viewInfo.setImage(gpuTexture.m_image)
+		.setViewType(vk::ImageViewType::e2D)
+		.setFormat(vkFormat)
+		.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1));
+
+	auto [imageViewRes, imageView] = m_logicalDevice.createImageView(viewInfo);
+	engineAssert(imageViewRes == vk::Result::eSuccess, "Failed to create texture image view");
+	gpuTexture.m_imageView = imageView;
+
+	if (m_bindlessTextures)
+	{
+		gpuTexture.m_bindlessIndex = registerBindlessTexture(gpuTexture.m_imageView);
+	}
+	else
+	{
+		gpuTexture.m_descriptorSet = createTextureDescriptorSet(gpuTexture.m_image, gpuTexture.m_imageView);
+	}
+	return gpuTexture;
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::updateTexture(GpuTexture& texture, uint32_t x, uint32_t y, const TextureData& region)
+{
+	//-- Sprites already placed on the image keep drawing
+	texture.m_uploadTicket = m_uploadContext->uploadTexture(texture.m_image, region, vk::ImageLayout::eShaderReadOnlyOptimal, x, y);
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::destroyTexture(GpuTexture& texture)
+{
+	//-- Pending upload still references the image
+	m_uploadContext->wait(texture.m_uploadTicket);
+
+	if (m_bindlessTextures)
+	{
+		unregisterBindlessTexture(texture.m_bindlessIndex);
+	}
+	else
+	{
+		freeDescriptorSetFromPool(texture.m_descriptorSet);
+	}
+
+	m_logicalDevice.destroyImageView(texture.m_imageView);
+	m_logicalDevice.destroyImage(texture.m_image);
+	freeMemory(texture.m_memory);
+	texture = {};
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createCommandBuffer()
+{
+	vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {};
+	commandBufferAllocateInfo.setCommandBufferCount(C_MAX_FRAMES_IN_FLIGHT)
+		.setCommandPool(m_commandPool)
+		.setLevel(vk::CommandBufferLevel::ePrimary);
+
+	auto [res, commandBuffers] = m_logicalDevice.allocateCommandBuffers(commandBufferAllocateInfo);
+	engineAssert(res == vk::Result::eSuccess, "Failed to allocateCommandBuffers");
+	m_commandBuffers = commandBuffers;
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createRecordingSlots()
+{
+	if (m_recordingThreads == 0)
+	{
+		return;
+	}
+
+	//-- Main thread records a range too
+	const uint32_t workersCount = m_engineContext->m_managerHolder.getManager<ThreadPool>().threadsCount();
+	m_recordingThreads = std::min(m_recordingThreads, workersCount + 1);
+	std::println("Sprite batches are recorded by {} threads", m_recordingThreads);
+
+	for (auto& frameSlots : m_recordingSlots)
+	{
+		frameSlots.resize(m_recordingThreads + 1);
+		for (auto& slot : frameSlots)
+		{
+			//-- Buffers are re-recorded every frame, whole pool is reset at once
+			vk::CommandPoolCreateInfo poolInfo = {};
+			poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+				.setQueueFamilyIndex(m_physicalDeviceData.m_queueFamilies.m_graphicQueue);
+
+			auto [poolRes, commandPool] = m_logicalDevice.createCommandPool(poolInfo);
+			engineAssert(poolRes == vk::Result::eSuccess, "Failed to create recording command pool");
+			slot.m_commandPool = commandPool;
+
+			vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {};
+			commandBufferAllocateInfo.setCommandBufferCount(1)
+				.setCommandPool(slot.m_commandPool)
+				.setLevel(vk::CommandBufferLevel::eSecondary);
+
+			auto [bufferRes, commandBuffers] = m_logicalDevice.allocateCommandBuffers(commandBufferAllocateInfo);
+			engineAssert(bufferRes == vk::Result::eSuccess, "Failed to allocate secondary command buffer");
+			slot.m_commandBuffer = commandBuffers[0];
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createQueryPools()
+{
+	if (!m_pipelineStatistics)
+	{
+		return;
+	}
+
+	//-- Query can't span secondary command buffers, so every recorded range counts its own
+	m_overdrawQueriesCount = std::max(m_recordingThreads, 1u);
+	for (auto& queryPool : m_overdrawQueryPools)
+	{
+		vk::QueryPoolCreateInfo createInfo = {};
+		createInfo.setQueryType(vk::QueryType::ePipelineStatistics)
+			.setQueryCount(m_overdrawQueriesCount)
+			.setPipelineStatistics(vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+
+		auto [res, pool] = m_logicalDevice.createQueryPool(createInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to create overdraw query pool");
+		queryPool = pool;
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::readOverdrawQueries()
+{
+	const uint32_t queriesUsed = m_overdrawQueriesUsed[m_currFrame];
+	m_overdrawQueriesUsed[m_currFrame] = 0;
+	if (!m_pipelineStatistics || queriesUsed == 0)
+	{
+		return;
+	}
+
+	//-- Frame fence is passed, results are available without waiting
+	std::vector<uint64_t> invocations(queriesUsed, 0);
+	const vk::Result      res = m_logicalDevice.getQueryPoolResults(m_overdrawQueryPools[m_currFrame]
+		, 0
+		, queriesUsed
+		, invocations.size() * sizeof(uint64_t)
+		, invocations.data()
+		, sizeof(uint64_t)
+		, vk::QueryResultFlagBits::e64);
+	if (res != vk::Result::eSuccess)
+	{
+		return;
+	}
+
+	const uint64_t pixelsCount = static_cast<uint64_t>(m_imageExtent.width) * m_imageExtent.height;
+	m_overdrawStats.m_measured = true;
+	m_overdrawStats.m_fragmentInvocations = std::accumulate(invocations.begin(), invocations.end(), uint64_t{ 0 });
+	m_overdrawStats.m_overdraw = pixelsCount > 0
+		? static_cast<float>(m_overdrawStats.m_fragmentInvocations) / static_cast<float>(pixelsCount)
+		: 0.0f;
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::createSyncObjects()
+{
+	m_imageAvailableSemaphores.reserve(C_MAX_FRAMES_IN_FLIGHT);
+	m_renderFinishedSemaphores.reserve(C_MAX_FRAMES_IN_FLIGHT);
+	m_inFlightFences.reserve(C_MAX_FRAMES_IN_FLIGHT);
+
+	vk::FenceCreateInfo fenceInfo = {};
+	fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
+
+	for (int i = 0; i < C_MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		{
 			auto [res, semaphor] = m_logicalDevice.createSemaphore(vk::SemaphoreCreateInfo());
@@ -1067,6 +1741,10 @@ void VkGraphicDevice::setupPhysicalDevice()
 	engineAssert(bestScore > 0, "No suitable videocard found");
 	engineAssert(m_physicalDevice != VK_NULL_HANDLE, "Physical device is NULL");
 	engineAssert(m_physicalDeviceData.m_queueFamilies.isValid(), "Queue families are not valid");
+	if (m_headless)
+	{
+		return;
+	}
 	//-- Maybe check if it supports specific modes we wanna see like mailbox & RGB8UNORM
 	engineAssert(!m_physicalDeviceData.m_swapchainDetails.m_presentMode.empty(), "Present mode is empty");
 	engineAssert(!m_physicalDeviceData.m_swapchainDetails.m_surfaceSupportedFormats.empty()
@@ -1103,24 +1781,163 @@ vk::DescriptorSet VkGraphicDevice::createTextureDescriptorSet(vk::Image& image,
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const TexturedGeometryBatch& geometryBatch, const BatchIndecies& indicesBatch)
+void VkGraphicDevice::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const TexturedGeometryBatch& geometryBatch, vk::Buffer quadIndexBuffer)
 {
 	vk::CommandBufferBeginInfo cmdBBeginfo = {};
 	commandBuffer.begin(cmdBBeginfo);
 
-	vk::RenderPassBeginInfo renderPassInfo = {};
-	vk::Rect2D              renderArea = {};
-	vk::ClearValue          clearValue = { vk::ClearColorValue(0.2f, 0.2f, 0.2f, 1.0f) };
+	//-- Queries are reset outside of render pass, ranges recorded below begin them
+	if (m_pipelineStatistics)
+	{
+		commandBuffer.resetQueryPool(m_overdrawQueryPools[m_currFrame], 0, m_overdrawQueriesCount);
+	}
+
+	vk::RenderPassBeginInfo             renderPassInfo = {};
+	vk::Rect2D                          renderArea = {};
+	const std::array<vk::ClearValue, 2> clearValues = {
+		vk::ClearColorValue(0.2f, 0.2f, 0.2f, 1.0f)
+		, vk::ClearDepthStencilValue(1.0f, 0)
+	};
 	renderArea.setOffset({ 0, 0 }).setExtent(m_imageExtent);
 	renderPassInfo.setRenderPass(m_renderPass)
 		.setFramebuffer(m_swapChainFramebuffers[imageIndex])
 		.setRenderArea(renderArea)
-		.setClearValueCount(1)
-		.setClearValues({ clearValue });
+		.setClearValueCount(clearValues.size())
+		.setClearValues(clearValues);
+
+	//-- Subpass contents are either inline or secondaries only, ImGui follows the same mode
+	if (m_recordingThreads > 0)
+	{
+		commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+		recordSecondaryCommandBuffers(commandBuffer, imageIndex, geometryBatch, quadIndexBuffer);
+	}
+	else
+	{
+		commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+
+		const auto recordingStart = std::chrono::steady_clock::now();
+		recordSpritesState(commandBuffer, quadIndexBuffer);
+		recordBatches(commandBuffer, geometryBatch, 0, static_cast<uint32_t>(geometryBatch.size()), 0);
+		m_overdrawQueriesUsed[m_currFrame] = m_pipelineStatistics ? 1 : 0;
+		m_recordingStats = {
+			.m_recordingMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - recordingStart).count()
+			, .m_batchesCount = static_cast<uint32_t>(geometryBatch.size())
+			, .m_tasksCount = 0
+		};
+
+		if (m_imGuiDrawData != nullptr)
+		{
+			m_imGuiIntegration.render(m_imGuiDrawData, commandBuffer);
+		}
+	}
+
+	commandBuffer.endRenderPass();
+	commandBuffer.end();
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::recordSecondaryCommandBuffers(vk::CommandBuffer              commandBuffer
+                                                    , uint32_t                     imageIndex
+                                                    , const TexturedGeometryBatch& geometryBatch
+                                                    , vk::Buffer                   quadIndexBuffer)
+{
+	const auto     recordingStart = std::chrono::steady_clock::now();
+	const auto&    slots = m_recordingSlots[m_currFrame];
+	const uint32_t batchesCount = static_cast<uint32_t>(geometryBatch.size());
+
+	auto job = std::make_shared<BatchRecordingJob>();
+	job->m_rangesCount = std::min(m_recordingThreads
+		, (batchesCount + C_MIN_BATCHES_PER_RECORDING_TASK - 1) / C_MIN_BATCHES_PER_RECORDING_TASK);
+	job->m_rangeFinishTimes.resize(job->m_rangesCount, recordingStart);
+
+	//-- Ranges are claimed by counter and main thread claims them too, so tasks queued
+	//-- behind texture decoding in the pool never stall the frame
+	auto recordRanges = [this, job, &slots, imageIndex, &geometryBatch, quadIndexBuffer]()
+		{
+			for (uint32_t range = job->m_nextRange++; range < job->m_rangesCount; range = job->m_nextRange++)
+			{
+				const uint64_t rangeScale = geometryBatch.size();
+				const uint32_t firstBatch = static_cast<uint32_t>(rangeScale * range / job->m_rangesCount);
+				const uint32_t lastBatch = static_cast<uint32_t>(rangeScale * (range + 1) / job->m_rangesCount);
+				recordBatchRange(slots[range].m_commandBuffer, imageIndex, geometryBatch, firstBatch, lastBatch, quadIndexBuffer, range);
+
+				job->m_rangeFinishTimes[range] = std::chrono::steady_clock::now();
+				if (++job->m_recordedRanges == job->m_rangesCount)
+				{
+					job->m_recordedRanges.notify_one();
+				}
+			}
+		};
+
+	auto& threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+	for (uint32_t task = 1; task < job->m_rangesCount; ++task)
+	{
+		threadPool.submit(recordRanges);
+	}
+	recordRanges();
+
+	//-- ImGui backend keeps its own per frame buffers, so it's recorded by this thread
+	//-- while workers finish their ranges
+	const vk::CommandBuffer imGuiCommandBuffer = slots.back().m_commandBuffer;
+	beginSecondaryCommandBuffer(imGuiCommandBuffer, m_renderPass, m_swapChainFramebuffers[imageIndex]);
+	if (m_imGuiDrawData != nullptr)
+	{
+		m_imGuiIntegration.render(m_imGuiDrawData, imGuiCommandBuffer);
+	}
+	imGuiCommandBuffer.end();
+
+	for (uint32_t recorded = job->m_recordedRanges; recorded < job->m_rangesCount; recorded = job->m_recordedRanges)
+	{
+		job->m_recordedRanges.wait(recorded);
+	}
+
+	m_overdrawQueriesUsed[m_currFrame] = m_pipelineStatistics ? job->m_rangesCount : 0;
+
+	//-- Executed in range order, so draw order is the same as inline recording
+	std::vector<vk::CommandBuffer> secondaryCommandBuffers;
+	secondaryCommandBuffers.reserve(job->m_rangesCount + 1);
+	for (uint32_t range = 0; range < job->m_rangesCount; ++range)
+	{
+		secondaryCommandBuffers.push_back(slots[range].m_commandBuffer);
+	}
+	secondaryCommandBuffers.push_back(imGuiCommandBuffer);
+	commandBuffer.executeCommands(secondaryCommandBuffers);
+
+	auto recordingEnd = recordingStart;
+	for (const auto& finishTime : job->m_rangeFinishTimes)
+	{
+		recordingEnd = std::max(recordingEnd, finishTime);
+	}
+	m_recordingStats = {
+		.m_recordingMs = std::chrono::duration<float, std::milli>(recordingEnd - recordingStart).count()
+		, .m_batchesCount = batchesCount
+		, .m_tasksCount = job->m_rangesCount
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::recordBatchRange(vk::CommandBuffer              commandBuffer
+                                       , uint32_t                     imageIndex
+                                       , const TexturedGeometryBatch& geometryBatch
+                                       , uint32_t                     firstBatch
+                                       , uint32_t                     lastBatch
+                                       , vk::Buffer                   quadIndexBuffer
+                                       , uint32_t                     overdrawQuery)
+{
+	//-- Secondary buffer inherits nothing but render pass, all state is set again
+	beginSecondaryCommandBuffer(commandBuffer, m_renderPass, m_swapChainFramebuffers[imageIndex]);
+	recordSpritesState(commandBuffer, quadIndexBuffer);
+	recordBatches(commandBuffer, geometryBatch, firstBatch, lastBatch, overdrawQuery);
+	commandBuffer.end();
+}
 
-	commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_graphicsPipeline);
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::recordSpritesState(vk::CommandBuffer commandBuffer, vk::Buffer quadIndexBuffer)
+{
+	const bool instanced = m_spriteRenderPath == SpriteRenderPath::Instanced;
 
+	//-- Pipeline depends on batch pass, it's bound by recordBatches. Dynamic state and sets
+	//-- set here stay valid across pipelines of the same layout
 	vk::Viewport viewport = {};
 	viewport.setX(0.0f).setY(0.0f)
 		.setWidth(m_imageExtent.width)
@@ -1133,27 +1950,80 @@ void VkGraphicDevice::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint3
 	scissor.setExtent(m_imageExtent).setOffset({ 0, 0 });
 	commandBuffer.setScissor(0, scissor);
 
-	for (uint32_t i = 0; i < geometryBatch.size(); ++i)
+	//-- Every batch starts from vertex 0 of its own region, so one quad index buffer fits all
+	if (!instanced)
 	{
-		commandBuffer.bindVertexBuffers(0, geometryBatch[i].m_memory.m_buffer, { 0 });
-		commandBuffer.bindIndexBuffer(indicesBatch[i].m_buffer, 0, vk::IndexType::eUint16);
+		commandBuffer.bindIndexBuffer(quadIndexBuffer, 0, vk::IndexType::eUint32);
+	}
 
+	//-- All textures are reachable by index, sets are bound once for the whole frame
+	if (m_bindlessTextures)
+	{
 		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics
 			, m_pipelineLayout
 			, 0
 			, {
 				m_descriptorSets[m_currFrame]
-				, geometryBatch[i].m_textureDescriptorSet
+				, m_bindlessDescriptorSet
 			}
 		, {});
+	}
+}
 
-		commandBuffer.drawIndexed(geometryBatch[i].m_spritesCount * 6, 1, 0, 0, 0);
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::recordBatches(vk::CommandBuffer              commandBuffer
+                                    , const TexturedGeometryBatch& geometryBatch
+                                    , uint32_t                     firstBatch
+                                    , uint32_t                     lastBatch
+                                    , uint32_t                     overdrawQuery)
+{
+	const bool             instanced = m_spriteRenderPath == SpriteRenderPath::Instanced;
+	const SpritePipelines& pipelines = instanced ? m_instancedPipelines : m_vertexPipelines;
+
+	if (m_pipelineStatistics)
+	{
+		commandBuffer.beginQuery(m_overdrawQueryPools[m_currFrame], overdrawQuery, {});
 	}
 
-	m_imGuiIntegration.update(m_commandBuffers[m_currFrame], m_imGuiDrawCallbacks);
+	//-- Batches are sorted by pass, so pipeline changes at most once per pass
+	SpritePass currentPass = SpritePass::Count;
+	for (uint32_t i = firstBatch; i < lastBatch; ++i)
+	{
+		if (geometryBatch[i].m_pass != currentPass)
+		{
+			currentPass = geometryBatch[i].m_pass;
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[static_cast<size_t>(currentPass)]);
+		}
 
-	commandBuffer.endRenderPass();
-	commandBuffer.end();
+		commandBuffer.bindVertexBuffers(0, geometryBatch[i].m_vertexBuffer, geometryBatch[i].m_vertexOffset);
+
+		if (!m_bindlessTextures)
+		{
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics
+				, m_pipelineLayout
+				, 0
+				, {
+					m_descriptorSets[m_currFrame]
+					, geometryBatch[i].m_textureDescriptorSet
+				}
+			, {});
+		}
+
+		if (instanced)
+		{
+			//-- Quad corners come from gl_VertexIndex, buffer holds one record per sprite
+			commandBuffer.draw(6, geometryBatch[i].m_spritesCount, 0, 0);
+		}
+		else
+		{
+			commandBuffer.drawIndexed(geometryBatch[i].m_spritesCount * 6, 1, 0, 0, 0);
+		}
+	}
+
+	if (m_pipelineStatistics)
+	{
+		commandBuffer.endQuery(m_overdrawQueryPools[m_currFrame], overdrawQuery);
+	}
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1201,6 +2071,35 @@ void VkGraphicDevice::checkValidationLayerSupport(const std::vector<const char*>
 	}
 }
 
+//-------------------------------------------------------------------------------------------------
+bool VkGraphicDevice::checkDescriptorIndexingSupport(vk::PhysicalDevice physicalDevice) const
+{
+	if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_2
+		&& !checkDeviceExtensionsSupport({ VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME }, physicalDevice))
+	{
+		return false;
+	}
+
+	vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+	vk::PhysicalDeviceFeatures2                  features = {};
+	features.setPNext(&indexingFeatures);
+	physicalDevice.getFeatures2(&features);
+
+	return indexingFeatures.shaderSampledImageArrayNonUniformIndexing
+	       && indexingFeatures.descriptorBindingPartiallyBound
+	       && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+	       && indexingFeatures.runtimeDescriptorArray;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool VkGraphicDevice::checkTextureFormatSupport(vk::Format format, vk::Bool32 featureEnabled) const
+{
+	const vk::FormatProperties properties = m_physicalDevice.getFormatProperties(format);
+	return featureEnabled
+	       && (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)
+	       && (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+}
+
 //-------------------------------------------------------------------------------------------------
 bool VkGraphicDevice::checkDeviceExtensionsSupport(const std::vector<const char*>& deviceExtentions, vk::PhysicalDevice physicalDevice) const
 {
@@ -1240,14 +2139,18 @@ PhysicalDeviceData VkGraphicDevice::checkIfPhysicalDeviceSuitable(vk::PhysicalDe
 	}
 
 	//-- Device extensions
-	if (checkDeviceExtensionsSupport(C_DEVICE_EXTENSIONS, device))
+	if (checkDeviceExtensionsSupport(requiredDeviceExtensions(), device))
 	{
 		data.m_score += 10;
 	}
 
-	data.m_swapchainDetails = swapchainDetails(device);
-	bool swapchainValid = !data.m_swapchainDetails.m_presentMode.empty()
-		&& !data.m_swapchainDetails.m_surfaceSupportedFormats.empty();
+	//-- Headless device is never presenting, any swapchain details are fine
+	if (!m_headless)
+	{
+		data.m_swapchainDetails = swapchainDetails(device);
+	}
+	bool swapchainValid = m_headless
+		|| (!data.m_swapchainDetails.m_presentMode.empty() && !data.m_swapchainDetails.m_surfaceSupportedFormats.empty());
 	if (swapchainValid)
 	{
 		data.m_score += 10;
@@ -1280,12 +2183,20 @@ QueueFamilies VkGraphicDevice::checkQueueFamilies(vk::PhysicalDevice device) con
 				queueFamilies.m_graphicQueue = index;
 			}
 
-			auto [res, presentSupport] = device.getSurfaceSupportKHR(index, m_surface);
-			engineAssert(res == vk::Result::eSuccess, "Failed to getSurfaceSupportKHR");
-
-			if (presentSupport == VK_TRUE)
+			//-- Headless frames are never presented, graphic queue stands in for presentation one
+			if (m_headless)
 			{
-				queueFamilies.m_presentationQueue = index;
+				queueFamilies.m_presentationQueue = queueFamilies.m_graphicQueue;
+			}
+			else
+			{
+				auto [res, presentSupport] = device.getSurfaceSupportKHR(index, m_surface);
+				engineAssert(res == vk::Result::eSuccess, "Failed to getSurfaceSupportKHR");
+
+				if (presentSupport == VK_TRUE)
+				{
+					queueFamilies.m_presentationQueue = index;
+				}
 			}
 		}
 		if (queueFamilies.isValid())
@@ -1297,6 +2208,20 @@ QueueFamilies VkGraphicDevice::checkQueueFamilies(vk::PhysicalDevice device) con
 		++index;
 	}
 
+	//-- Transfer only family is usually backed by copy engines running next to graphic work
+	index = 0;
+	for (auto& familyProp : queueFamilyProps)
+	{
+		if (familyProp.queueCount > 0
+			&& !!(familyProp.queueFlags & vk::QueueFlagBits::eTransfer)
+			&& !(familyProp.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+		{
+			queueFamilies.m_transferQueue = index;
+			break;
+		}
+		++index;
+	}
+
 	return queueFamilies;
 }
 
@@ -1364,10 +2289,8 @@ vk::Extent2D VkGraphicDevice::chooseSwapChainExtent(const vk::SurfaceCapabilitie
 		return capabilities.currentExtent;
 	}
 
-	int width = 0;
-	int height = 0;;
-	glfwGetFramebufferSize(m_window, &width, &height);
-	vk::Extent2D ret = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	//-- Window may be driven by another thread, size comes with camera
+	vk::Extent2D ret = { m_camera.m_framebufferSize.x, m_camera.m_framebufferSize.y };
 	ret.width = std::clamp(ret.width
 		, capabilities.minImageExtent.width
 		, capabilities.maxImageExtent.width);
@@ -1378,6 +2301,27 @@ vk::Extent2D VkGraphicDevice::chooseSwapChainExtent(const vk::SurfaceCapabilitie
 	return ret;
 }
 
+//-------------------------------------------------------------------------------------------------
+vk::Format VkGraphicDevice::chooseDepthFormat() const
+{
+	//-- Stencil isn't used, formats with it are only a fallback
+	constexpr std::array<vk::Format, 3> C_DEPTH_FORMATS = {
+		vk::Format::eD32Sfloat
+		, vk::Format::eD32SfloatS8Uint
+		, vk::Format::eD24UnormS8Uint
+	};
+	for (const vk::Format format : C_DEPTH_FORMATS)
+	{
+		const vk::FormatProperties props = m_physicalDevice.getFormatProperties(format);
+		if (props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+		{
+			return format;
+		}
+	}
+	engineAssert(false, "No supported depth format");
+	return vk::Format::eUndefined;
+}
+
 //-------------------------------------------------------------------------------------------------
 vk::ImageView VkGraphicDevice::createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags)
 {
@@ -1399,8 +2343,10 @@ vk::ImageView VkGraphicDevice::createImageView(vk::Image image, vk::Format forma
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usageFlags, vk::MemoryPropertyFlags memPropFlags, vk::Buffer& buffer, vk::DeviceMemory& deviceMemory)
+VulkanBufferMemory VkGraphicDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usageFlags, vk::MemoryPropertyFlags memPropFlags, GpuAllocationStrategy strategy, GpuAllocationOwner* owner)
 {
+	VulkanBufferMemory bufferMemory;
+
 	vk::BufferCreateInfo bufferInfo = {};
 	bufferInfo.setSize(size)
 		.setUsage(usageFlags)
@@ -1408,152 +2354,163 @@ void VkGraphicDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usa
 	{
 		auto [res, createdBuffer] = m_logicalDevice.createBuffer(bufferInfo);
 		engineAssert(res == vk::Result::eSuccess, "Failed to createBuffer");
-		buffer = createdBuffer;
+		bufferMemory.m_buffer = createdBuffer;
 	}
 
-	vk::MemoryRequirements memReq = m_logicalDevice.getBufferMemoryRequirements(buffer);
-	uint32_t               memType = findMemoryType(memReq.memoryTypeBits, memPropFlags);
+	vk::MemoryRequirements memReq = m_logicalDevice.getBufferMemoryRequirements(bufferMemory.m_buffer);
+	bufferMemory.m_allocation = m_memoryAllocator->allocate(memReq, memPropFlags, GpuResourceKind::Buffer, strategy, owner);
+	m_logicalDevice.bindBufferMemory(bufferMemory.m_buffer
+		, bufferMemory.m_allocation.m_memory
+		, bufferMemory.m_allocation.m_offset);
 
-	vk::MemoryAllocateInfo allocInfo = {};
-	allocInfo.setMemoryTypeIndex(memType)
-		.setAllocationSize(memReq.size);
-	{
-		auto [res, allocatedMemory] = m_logicalDevice.allocateMemory(allocInfo);
-		engineAssert(res == vk::Result::eSuccess, "Failed to allocateMemory");
-		deviceMemory = allocatedMemory;
-	}
-	m_logicalDevice.bindBufferMemory(buffer, deviceMemory, 0);
+	return bufferMemory;
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::transitionImage(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+GpuAllocation VkGraphicDevice::allocateImageMemory(vk::Image image, vk::MemoryPropertyFlags memPropFlags)
 {
-	auto commandBuffer = beginSingleTimeCommands();
+	vk::MemoryRequirements memReq = m_logicalDevice.getImageMemoryRequirements(image);
+	GpuAllocation          allocation = m_memoryAllocator->allocate(memReq, memPropFlags, GpuResourceKind::Image);
+	m_logicalDevice.bindImageMemory(image, allocation.m_memory, allocation.m_offset);
 
-	vk::AccessFlags        srcAccess = {};
-	vk::AccessFlags        dstAccess = {};
-	vk::PipelineStageFlags srcStage = {};
-	vk::PipelineStageFlags dstStage = {};
+	return allocation;
+}
 
-	if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal)
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::freeMemory(GpuAllocation& allocation)
+{
+	m_memoryAllocator->free(allocation);
+}
+
+//-------------------------------------------------------------------------------------------------
+void VkGraphicDevice::cleanupSwapchain()
+{
+	for (auto& framebuffer : m_swapChainFramebuffers)
 	{
-		srcAccess = vk::AccessFlagBits::eNone;
-		dstAccess = vk::AccessFlagBits::eTransferWrite;
-		srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
-		dstStage = vk::PipelineStageFlagBits::eTransfer;
+		m_logicalDevice.destroyFramebuffer(framebuffer);
 	}
-	else
+	for (auto& swapchainImage : m_swapchainImages)
 	{
-		srcAccess = vk::AccessFlagBits::eTransferWrite;
-		dstAccess = vk::AccessFlagBits::eShaderRead;
-		srcStage = vk::PipelineStageFlagBits::eTransfer;
-		dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+		m_logicalDevice.destroyImageView(swapchainImage.m_imageView);
+		//-- Offscreen images are owned by device, swapchain ones go away with swapchain
+		if (m_headless)
+		{
+			m_logicalDevice.destroyImage(swapchainImage.m_image);
+			freeMemory(swapchainImage.m_memory);
+		}
+	}
+	m_logicalDevice.destroyImageView(m_depthImageView);
+	m_logicalDevice.destroyImage(m_depthImage);
+	freeMemory(m_depthImageMemory);
+	//-- Swapchain extension isn't even enabled on headless device
+	if (!m_headless)
+	{
+		m_logicalDevice.destroySwapchainKHR(m_swapchain);
 	}
-
-	vk::ImageMemoryBarrier barrier = {};
-	barrier.setOldLayout(oldLayout)
-		.setNewLayout(newLayout)
-		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-		.setImage(image)
-		.setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
-		.setSrcAccessMask(srcAccess)
-		.setDstAccessMask(dstAccess);
-
-	commandBuffer.pipelineBarrier(srcStage
-		, dstStage
-		, vk::DependencyFlagBits::eByRegion
-		, {}
-		, {}
-	, barrier);
-
-	endSingleTimeCommand(commandBuffer);
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height)
+std::vector<const char*> VkGraphicDevice::requiredDeviceExtensions() const
 {
-	auto commandBuffer = beginSingleTimeCommands();
-
-	vk::BufferImageCopy region = {};
-	region.setBufferOffset(0)
-		.setBufferRowLength(0)
-		.setBufferImageHeight(0)
-		.setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
-		.setImageOffset({ 0, 0, 0 })
-		.setImageExtent({ width, height, 1 });
-
-	commandBuffer.copyBufferToImage(buffer
-		, image
-		, vk::ImageLayout::eTransferDstOptimal
-		, { region });
-
-	endSingleTimeCommand(commandBuffer);
+	//-- Swapchain is the only one required extension and headless device doesn't need it
+	return m_headless ? std::vector<const char*>() : C_DEVICE_EXTENSIONS;
 }
 
 //-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size)
+std::optional<ImageData> VkGraphicDevice::readbackLastFrame()
 {
-	auto commandBuffer = beginSingleTimeCommands();
-
-	vk::BufferCopy bufferCopy = {};
-	bufferCopy.setSize(size)
-		.setSrcOffset(0)
-		.setDstOffset(0);
+	if (!m_headless || !m_frameSubmitted)
+	{
+		return std::nullopt;
+	}
+	waitGraphicIdle();
 
-	commandBuffer.copyBuffer(srcBuffer, dstBuffer, { bufferCopy });
+	const uint32_t       width = m_imageExtent.width;
+	const uint32_t       height = m_imageExtent.height;
+	const vk::DeviceSize rowSize = static_cast<vk::DeviceSize>(width) * 4;
+	VulkanBufferMemory   readbackBuffer = createBuffer(rowSize * height
+		, vk::BufferUsageFlagBits::eTransferDst
+		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-	endSingleTimeCommand(commandBuffer);
-}
-
-//-------------------------------------------------------------------------------------------------
-vk::CommandBuffer VkGraphicDevice::beginSingleTimeCommands()
-{
-	vk::CommandBufferAllocateInfo allocateInfo = {};
-	allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary)
+	vk::CommandBufferAllocateInfo allocInfo = {};
+	allocInfo.setCommandBufferCount(1)
 		.setCommandPool(m_commandPool)
-		.setCommandBufferCount(1);
-
-	vk::CommandBuffer commandBuffer = {};
-	auto [res, commandBuffers] = m_logicalDevice.allocateCommandBuffers(allocateInfo);
-	engineAssert(res == vk::Result::eSuccess, "Failed to allocateCommandBuffers");
-
-	commandBuffer = *commandBuffers.begin();
+		.setLevel(vk::CommandBufferLevel::ePrimary);
+	auto [res, commandBuffers] = m_logicalDevice.allocateCommandBuffers(allocInfo);
+	engineAssert(res == vk::Result::eSuccess, "Failed to allocate readback command buffer");
+	vk::CommandBuffer commandBuffer = commandBuffers[0];
 
 	vk::CommandBufferBeginInfo beginInfo = {};
 	beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
 	commandBuffer.begin(beginInfo);
-	return commandBuffer;
-}
 
-//-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::endSingleTimeCommand(vk::CommandBuffer commandBuffer)
-{
+	//-- Render pass left image in transfer source layout, only its writes have to be made visible
+	vk::ImageMemoryBarrier imageBarrier = {};
+	imageBarrier.setImage(m_swapchainImages[m_lastImageIndex].m_image)
+		.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+		.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+		.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput
+		, vk::PipelineStageFlagBits::eTransfer
+		, {}
+		, {}
+		, {}
+		, imageBarrier);
+
+	vk::BufferImageCopy copyRegion = {};
+	copyRegion.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+		.setImageExtent(vk::Extent3D(width, height, 1));
+	commandBuffer.copyImageToBuffer(m_swapchainImages[m_lastImageIndex].m_image
+		, vk::ImageLayout::eTransferSrcOptimal
+		, readbackBuffer.m_buffer
+		, copyRegion);
+
+	vk::BufferMemoryBarrier bufferBarrier = {};
+	bufferBarrier.setBuffer(readbackBuffer.m_buffer)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eHostRead)
+		.setSize(VK_WHOLE_SIZE);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer
+		, vk::PipelineStageFlagBits::eHost
+		, {}
+		, {}
+		, bufferBarrier
+		, {});
 	commandBuffer.end();
 
-	vk::SubmitInfo submitInfo = {};
-	submitInfo.setCommandBufferCount(1)
-		.setCommandBuffers({ commandBuffer });
-
-	m_queues.m_graphicQueue.submit(submitInfo);
-	m_queues.m_graphicQueue.waitIdle();
-
-	m_logicalDevice.freeCommandBuffers(m_commandPool, { commandBuffer });
-}
-
-//-------------------------------------------------------------------------------------------------
-void VkGraphicDevice::cleanupSwapchain()
-{
-	for (auto& framebuffer : m_swapChainFramebuffers)
 	{
-		m_logicalDevice.destroyFramebuffer(framebuffer);
+		std::lock_guard queueLock(m_graphicQueueMutex);
+		vk::SubmitInfo submitInfo = {};
+		submitInfo.setCommandBuffers(commandBuffer);
+		m_queues.m_graphicQueue.submit(submitInfo);
+		m_queues.m_graphicQueue.waitIdle();
+	}
+	m_logicalDevice.freeCommandBuffers(m_commandPool, commandBuffer);
+
+	//-- Framebuffer rows go top down, image data keeps loader order with the bottom row first.
+	//-- Swapchain is presented opaque, so alpha left by blending is dropped the same way
+	ImageData frame;
+	frame.m_width = width;
+	frame.m_height = height;
+	frame.m_pixels.resize(rowSize * height);
+	const auto* mapped = static_cast<const uint8_t*>(readbackBuffer.m_allocation.m_mapped);
+	for (uint32_t row = 0; row < height; ++row)
+	{
+		std::memcpy(frame.m_pixels.data() + rowSize * row, mapped + rowSize * (height - 1 - row), rowSize);
 	}
-	for (auto& [_, imageView] : m_swapchainImages)
+	for (size_t alpha = 3; alpha < frame.m_pixels.size(); alpha += 4)
 	{
-		m_logicalDevice.destroyImageView(imageView);
+		frame.m_pixels[alpha] = 255;
 	}
-	m_logicalDevice.destroySwapchainKHR(m_swapchain);
+	clearBuffer(readbackBuffer);
+
+	return frame;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -21,31 +21,39 @@
 #include <filesystem>
 #include <cstdio>
 #include <fstream>
-#include <shaderc/shaderc.hpp>
 #include <cstdlib>
 #include <print>
 #include <numeric>
+#include <mutex>
+#include <atomic>
+#include <optional>
 
 #include <application/managers/renderer_manager.h>
 #include <application/editor/imgui_integration.h>
-
-constexpr int C_MAX_FRAMES_IN_FLIGHT = 2;
+#include <application/renderer/render_packet.h>
+#include <application/renderer/renderer_config.h>
+#include <application/renderer/gpu_memory_allocator.h>
+#include <application/renderer/upload_context.h>
+#include <application/renderer/graphic_device.h>
+
+//-- Upper bound of bindless texture array, clamped by device limits.
+//-- Slot index is packed into 16 bits of sprite instance data
+constexpr uint32_t C_MAX_BINDLESS_TEXTURES = 4096;
+//-- Fewer batches per secondary command buffer cost more in task handoff than they save
+constexpr uint32_t C_MIN_BATCHES_PER_RECORDING_TASK = 16;
+//-- Memory blocks filled up to this fraction are evacuated, checked once per that many frames
+constexpr float    C_DEFRAGMENT_MAX_OCCUPANCY = 0.25f;
+constexpr uint32_t C_DEFRAGMENT_INTERVAL_FRAMES = 600;
 
 struct EngineContext;
 
-//-------------------------------------------------------------------------------------------------
-struct VertexData
-{
-	glm::vec4 m_vertex;
-	glm::vec3 m_color;
-	glm::vec2 m_texCoord;
-};
-
 //-------------------------------------------------------------------------------------------------
 struct QueueFamilies
 {
 	int m_graphicQueue = -1;
 	int m_presentationQueue = -1;
+	//-- Optional family with transfer but without graphic capabilities
+	int m_transferQueue = -1;
 
 	bool isValid() const
 	{
@@ -59,13 +67,17 @@ struct Queues
 {
 	vk::Queue m_graphicQueue;
 	vk::Queue m_presentationQueue;
+	vk::Queue m_transferQueue;
 };
 
 //-------------------------------------------------------------------------------------------------
+//-- Image of swapchain or offscreen color target in headless mode
 struct SwapchainImage
 {
 	vk::Image     m_image = VK_NULL_HANDLE;
 	vk::ImageView m_imageView = VK_NULL_HANDLE;
+	//-- Offscreen images only, swapchain owns memory of its images
+	GpuAllocation m_memory;
 };
 
 //-------------------------------------------------------------------------------------------------
@@ -94,42 +106,57 @@ struct UniformBufferObject
 	glm::mat4 m_proj;
 };
 
-//-------------------------------------------------------------------------------------------------
-struct VulkanBufferMemory
-{
-	vk::Buffer       m_buffer;
-	vk::DeviceMemory m_bufferMem;
-};
+using SpritePipelines = std::array<vk::Pipeline, static_cast<size_t>(SpritePass::Count)>;
 
 //-------------------------------------------------------------------------------------------------
-struct TexturedGeometry
+//-- Command pool is externally synchronized, so every parallel recorded range owns one
+struct RecordingSlot
 {
-	VulkanBufferMemory m_memory;
-	vk::DescriptorSet  m_textureDescriptorSet;
-	uint32_t           m_spritesCount;
+	vk::CommandPool   m_commandPool;
+	vk::CommandBuffer m_commandBuffer;
 };
 
-using TexturedGeometryBatch = std::vector<TexturedGeometry>;
-using BatchIndecies = std::vector<VulkanBufferMemory>;
-
 //-------------------------------------------------------------------------------------------------
-class VkGraphicDevice
+class VkGraphicDevice : public GraphicDevice
 {
 public:
 	explicit VkGraphicDevice(std::shared_ptr<EngineContext> context) : m_engineContext(context) {}
-	~VkGraphicDevice();
+	~VkGraphicDevice() override;
 
-	void init(GLFWwindow* window);
+	void init(GLFWwindow* window) override;
 	void shutdown();
-	void resizedWindow();
-	void beginFrame(float /*dt*/);
-	void endFrame(const TexturedGeometryBatch& geometryBatch, const BatchIndecies& indicesBatch);
-	auto createIndexBuffer(uint16_t spriteCount) -> VulkanBufferMemory;
-	void clearBuffer(VulkanBufferMemory memory);
-	VulkanBufferMemory createCombinedVertexBuffer(const std::vector<std::array<VertexData, 4>>& sprites);
-	uint8_t maxFrames() const;
-	uint8_t currFrame() const;
-	void waitGraphicIdle();
+	void resizedWindow() override;
+	void beginFrame(float /*dt*/) override;
+	void endFrame(const TexturedGeometryBatch& geometryBatch, vk::Buffer quadIndexBuffer) override;
+	VulkanBufferMemory createQuadIndexBuffer(uint32_t spriteCount) override;
+	void clearBuffer(VulkanBufferMemory memory) override;
+	void setSpriteRenderPath(SpriteRenderPath renderPath) { m_spriteRenderPath = renderPath; }
+	//-- Has to be requested before init, actual mode depends on device features
+	void requestBindlessTextures(bool requested) { m_bindlessRequested = requested; }
+	bool bindlessTextures() const override { return m_bindlessTextures; }
+	//-- Has to be requested before init, needs engine built with ENGINE_SHADER_COMPILER
+	void requestShaderCompilation(bool requested) { m_compileShadersRequested = requested; }
+	//-- Has to be requested before init, zero records all batches inline into primary buffer
+	void requestRecordingThreads(uint32_t threadsCount) { m_recordingThreads = threadsCount; }
+	//-- Has to be requested before init: no window, surface, swapchain and ImGui, frames are
+	//-- rendered into offscreen images sized by camera framebuffer size
+	void requestHeadless(bool headless) { m_headless = headless; }
+	bool headless() const { return m_headless; }
+	//-- Headless only, copy of the last submitted frame, empty when nothing was rendered yet
+	std::optional<ImageData> readbackLastFrame() override;
+	const CommandRecordingStats& recordingStats() const override { return m_recordingStats; }
+	const OverdrawStats& overdrawStats() const override { return m_overdrawStats; }
+	GpuMemoryStats memoryStats() const override { return m_memoryAllocator->stats(); }
+	bool supportsTextureFormat(TextureFormat format) const override { return m_supportedTextureFormats[static_cast<size_t>(format)]; }
+	GpuTexture createTexture(const TextureData& texture) override;
+	void updateTexture(GpuTexture& texture, uint32_t x, uint32_t y, const TextureData& region) override;
+	void destroyTexture(GpuTexture& texture) override;
+	bool isUploadComplete(UploadTicket ticket) override { return m_uploadContext->isComplete(ticket); }
+	uint32_t registerBindlessTexture(vk::ImageView imageView);
+	void unregisterBindlessTexture(uint32_t textureSlot);
+	uint8_t maxFrames() const override;
+	uint8_t currFrame() const override;
+	void waitGraphicIdle() override;
 	void updateUniformBuffer();
 	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 	vk::Device& getLogicalDevice();
@@ -138,54 +165,78 @@ public:
 	void createSurface();
 	void recreateSwapChain();
 	void createSwapchain();
+	void createOffscreenImages();
 	void createShaderModule();
 	void createDescriptorSetLayout();
+	void createPipelineCache();
+	void savePipelineCache();
 	void createPipeline();
 	void createRenderPass();
+	void createDepthResources();
 	void createFramebuffer();
 	void createCommandPool();
+	void createUploadContext();
 	void createTextureSampler();
 	void createUniformBuffers();
 	void createDescriptorPool();
 	void createDescriptorsSets();
+	void createBindlessTextures();
 	void freeDescriptorSetFromPool(vk::DescriptorSet& descriptorSet);
 	void createCommandBuffer();
+	void createRecordingSlots();
+	void createQueryPools();
+	void readOverdrawQueries();
 	void createSyncObjects();
 	void setupPhysicalDevice();
 	vk::DescriptorSet createTextureDescriptorSet(vk::Image& image, vk::ImageView& imageView);
 	void recordCommandBuffer(vk::CommandBuffer              commandBuffer
 	                         , uint32_t                     imageIndex
 	                         , const TexturedGeometryBatch& geometryBatch
-	                         , const BatchIndecies&         indicesBatch);
+	                         , vk::Buffer                   quadIndexBuffer);
+	void recordSecondaryCommandBuffers(vk::CommandBuffer              commandBuffer
+	                                   , uint32_t                     imageIndex
+	                                   , const TexturedGeometryBatch& geometryBatch
+	                                   , vk::Buffer                   quadIndexBuffer);
+	void recordBatchRange(vk::CommandBuffer              commandBuffer
+	                      , uint32_t                     imageIndex
+	                      , const TexturedGeometryBatch& geometryBatch
+	                      , uint32_t                     firstBatch
+	                      , uint32_t                     lastBatch
+	                      , vk::Buffer                   quadIndexBuffer
+	                      , uint32_t                     overdrawQuery);
+	void recordSpritesState(vk::CommandBuffer commandBuffer, vk::Buffer quadIndexBuffer);
+	void recordBatches(vk::CommandBuffer              commandBuffer
+	                   , const TexturedGeometryBatch& geometryBatch
+	                   , uint32_t                     firstBatch
+	                   , uint32_t                     lastBatch
+	                   , uint32_t                     overdrawQuery);
 	
 	//-- const char* here because glfw returns const char** as extentions list
 	void checkExtensionsSupport(const std::vector<const char*>& instanceExtentionsAppNeed) const;
 	void checkValidationLayerSupport(const std::vector<const char*>& validationLayerAppNeed) const;
+	bool checkDescriptorIndexingSupport(vk::PhysicalDevice physicalDevice) const;
+	bool checkTextureFormatSupport(vk::Format format, vk::Bool32 featureEnabled) const;
+	bool checkPipelineCacheCompatible(const std::vector<char>& data) const;
 	bool checkDeviceExtensionsSupport(const std::vector<const char*>& deviceExtentions
 	                                  , vk::PhysicalDevice            physicalDevice) const;
+	std::vector<const char*> requiredDeviceExtensions() const;
 	PhysicalDeviceData checkIfPhysicalDeviceSuitable(vk::PhysicalDevice device) const;
 	QueueFamilies checkQueueFamilies(vk::PhysicalDevice device) const;
 	SwapChainDetails swapchainDetails(vk::PhysicalDevice device) const;
 	vk::SurfaceFormatKHR chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& supportedFormats);
 	vk::PresentModeKHR choosePresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes);
 	vk::Extent2D chooseSwapChainExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
+	vk::Format chooseDepthFormat() const;
 	vk::ImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags);
-	void createBuffer(vk::DeviceSize            size
-	                  , vk::BufferUsageFlags    usageFlags
-	                  , vk::MemoryPropertyFlags memPropFlags
-	                  , vk::Buffer&             buffer
-	                  , vk::DeviceMemory&       deviceMemory);
-	void transitionImage(vk::Image         image
-	                     , vk::Format      format
-	                     , vk::ImageLayout oldLayout
-	                     , vk::ImageLayout newLayout);
-	void copyBufferToImage(vk::Buffer  buffer
-	                       , vk::Image image
-	                       , uint32_t  width
-	                       , uint32_t  height);
-	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
-	vk::CommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommand(vk::CommandBuffer commandBuffer);
+	VulkanBufferMemory createBuffer(vk::DeviceSize            size
+	                                , vk::BufferUsageFlags    usageFlags
+	                                , vk::MemoryPropertyFlags memPropFlags
+	                                , GpuAllocationStrategy   strategy = GpuAllocationStrategy::Buddy
+	                                , GpuAllocationOwner*     owner = nullptr) override;
+	GpuAllocation allocateImageMemory(vk::Image image, vk::MemoryPropertyFlags memPropFlags);
+	void freeMemory(GpuAllocation& allocation);
+	GpuMemoryAllocator& memoryAllocator() { return *m_memoryAllocator; }
+	UploadContext& uploadContext() { return *m_uploadContext; }
 	void cleanupSwapchain();
 	void setMaxTextures(uint32_t maxPossibleTextures);
 
@@ -201,10 +252,10 @@ public:
 	vk::DescriptorPool descriptorPool() const { return m_descriptorPool; }
 	vk::RenderPass renderPass() const { return m_renderPass; }
 
-	void setImGuiDrawCallbacks(std::vector<RendererManager::ImGuiDrawCallback>& imGuiDrawCallbacks)
-	{
-		m_imGuiDrawCallbacks = imGuiDrawCallbacks;
-	}
+	void setImGuiDrawData(ImDrawData* imGuiDrawData) override { m_imGuiDrawData = imGuiDrawData; }
+	void setCamera(const RenderCamera& camera) override { m_camera = camera; }
+	ImGuiIntegration* imGui() override { return m_headless ? nullptr : &m_imGuiIntegration; }
+	std::mutex& graphicQueueMutex() override { return m_graphicQueueMutex; }
 
 private:
 	const std::vector<const char*> C_DEVICE_EXTENSIONS
@@ -226,24 +277,50 @@ private:
 	vk::SurfaceKHR                 m_surface;
 	vk::SwapchainKHR               m_swapchain;
 	vk::ShaderModule               m_vertexShaderModule;
+	vk::ShaderModule               m_instancedVertexShaderModule;
 	vk::ShaderModule               m_fragmentShaderModule;
+	//-- ALPHA_CUTOUT variant of sprite fragment shader
+	vk::ShaderModule               m_cutoutFragmentShaderModule;
 	vk::RenderPass                 m_renderPass;
 	vk::DescriptorSetLayout        m_uniformsSetLayout;
 	vk::DescriptorSetLayout        m_texturesSetLayout;
 	vk::DescriptorPool             m_descriptorPool;
 	std::vector<vk::DescriptorSet> m_descriptorSets;
+	//-- Bindless mode: all textures live in one update after bind set
+	vk::DescriptorSetLayout        m_bindlessSetLayout;
+	vk::DescriptorPool             m_bindlessDescriptorPool;
+	vk::DescriptorSet              m_bindlessDescriptorSet;
+	std::vector<uint32_t>          m_freeBindlessSlots;
 	vk::PipelineLayout             m_pipelineLayout;
-	vk::Pipeline                   m_graphicsPipeline;
+	//-- Indexed by SpritePass
+	SpritePipelines                m_vertexPipelines;
+	SpritePipelines                m_instancedPipelines;
+	//-- Persisted between launches next to shader blobs
+	vk::PipelineCache              m_pipelineCache;
+	bool                           m_pipelineCacheWarm = false;
 
-	std::vector<vk::Buffer>       m_uniformBuffers;
-	std::vector<vk::DeviceMemory> m_uniformBuffersMemory;
-	std::vector<void*>            m_uniformBuffersMapped;
+	std::unique_ptr<GpuMemoryAllocator> m_memoryAllocator;
+	std::vector<VulkanBufferMemory>     m_uniformBuffers;
+	std::unique_ptr<UploadContext>      m_uploadContext;
 
 	vk::Sampler m_textureSampler;
 
 	vk::CommandPool                m_commandPool;
 	std::vector<vk::CommandBuffer> m_commandBuffers;
 	std::vector<vk::Framebuffer>   m_swapChainFramebuffers;
+	//-- Shared by all swapchain framebuffers, recreated with them
+	vk::Image                      m_depthImage;
+	GpuAllocation                  m_depthImageMemory;
+	vk::ImageView                  m_depthImageView;
+	vk::Format                     m_depthFormat = vk::Format::eUndefined;
+	//-- Per frame in flight: one slot per recording thread and the last one for ImGui
+	std::array<std::vector<RecordingSlot>, C_MAX_FRAMES_IN_FLIGHT> m_recordingSlots;
+	CommandRecordingStats                                          m_recordingStats;
+	//-- Per frame in flight: one pipeline statistics query per recorded range
+	std::array<vk::QueryPool, C_MAX_FRAMES_IN_FLIGHT> m_overdrawQueryPools;
+	std::array<uint32_t, C_MAX_FRAMES_IN_FLIGHT>      m_overdrawQueriesUsed = {};
+	uint32_t                                          m_overdrawQueriesCount = 0;
+	OverdrawStats                                     m_overdrawStats;
 
 	vk::SurfaceFormatKHR m_surfaceFormat;
 	vk::Extent2D         m_imageExtent;
@@ -253,15 +330,35 @@ private:
 	std::vector<vk::Semaphore> m_renderFinishedSemaphores;
 	std::vector<vk::Fence>     m_inFlightFences;
 
-	ImGuiIntegration                                m_imGuiIntegration;
-	std::vector<RendererManager::ImGuiDrawCallback> m_imGuiDrawCallbacks;
+	ImGuiIntegration m_imGuiIntegration;
+	ImDrawData*      m_imGuiDrawData = nullptr;
+	RenderCamera     m_camera;
+	std::mutex       m_graphicQueueMutex;
 
 	uint32_t m_apiVersion = 0;
 	uint32_t m_currFrame = 0;
 	uint32_t m_currImageIndex = 0;
+	uint32_t m_framesSinceDefragment = 0;
+	//-- Headless readback source
+	uint32_t m_lastImageIndex = 0;
+	bool     m_frameSubmitted = false;
 	uint32_t m_maxTextures = 200;
-
-	bool m_framebufferResized = false;
+	uint32_t m_maxBindlessTextures = 0;
+	uint32_t m_bindlessSlotsUsed = 0;
+	uint32_t m_recordingThreads = 0;
+
+	SpriteRenderPath m_spriteRenderPath = SpriteRenderPath::Instanced;
+	bool             m_bindlessRequested = true;
+	bool             m_bindlessTextures = false;
+	bool             m_compileShadersRequested = false;
+	bool             m_pipelineStatistics = false;
+	bool             m_samplerAnisotropy = false;
+	bool             m_headless = false;
+	//-- Filled on logical device creation, indexed by TextureFormat
+	std::array<bool, static_cast<size_t>(TextureFormat::Count)> m_supportedTextureFormats = {};
+
+	//-- Set from window events on main thread
+	std::atomic<bool> m_framebufferResized = false;
 #ifdef NDEBUG
 	const bool						m_enableValidationLayers = false;
 #else
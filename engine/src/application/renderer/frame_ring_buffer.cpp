@@ -0,0 +1,118 @@
+#include "frame_ring_buffer.h"
+
+#include <application/core/utils/engine_assert.h>
+
+#include <algorithm>
+#include <print>
+
+//-------------------------------------------------------------------------------------------------
+FrameRingBuffer::FrameRingBuffer(std::shared_ptr<GraphicDevice>   graphicDevice
+                                 , vk::BufferUsageFlags           usage
+                                 , vk::DeviceSize                 initialSize)
+	: m_graphicDevice(graphicDevice)
+	, m_usage(usage)
+{
+	m_frameBuffers.resize(m_graphicDevice->maxFrames());
+	for (auto& frameBuffer : m_frameBuffers)
+	{
+		createFrameBuffer(frameBuffer, initialSize);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameRingBuffer::~FrameRingBuffer()
+{
+	for (auto& frameBuffer : m_frameBuffers)
+	{
+		destroyFrameBuffer(frameBuffer);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameRingBuffer::beginFrame(uint8_t frameIndex, vk::DeviceSize requiredSize)
+{
+	m_frameIndex = frameIndex;
+	m_head = 0;
+
+	auto& frameBuffer = m_frameBuffers[m_frameIndex];
+	if (requiredSize <= frameBuffer.m_capacity && !frameBuffer.m_relocating)
+	{
+		return;
+	}
+
+	//-- Frame fence is already waited so GPU doesn't read this buffer anymore
+	vk::DeviceSize newCapacity = std::max<vk::DeviceSize>(frameBuffer.m_capacity, 1);
+	while (newCapacity < requiredSize)
+	{
+		newCapacity *= 2;
+	}
+
+	if (newCapacity != frameBuffer.m_capacity)
+	{
+		std::println("FrameRingBuffer: frame {} grows {} -> {} bytes", m_frameIndex, frameBuffer.m_capacity, newCapacity);
+	}
+
+	destroyFrameBuffer(frameBuffer);
+	createFrameBuffer(frameBuffer, newCapacity);
+}
+
+//-------------------------------------------------------------------------------------------------
+FrameAllocation FrameRingBuffer::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	auto& frameBuffer = m_frameBuffers[m_frameIndex];
+
+	const vk::DeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+	engineAssert(offset + size <= frameBuffer.m_capacity
+		, std::format("Frame ring buffer overflow, reserve {} bytes in beginFrame", offset + size));
+
+	m_head = offset + size;
+
+	return {
+		.m_buffer = frameBuffer.m_memory.m_buffer
+		, .m_offset = offset
+		, .m_data = static_cast<uint8_t*>(frameBuffer.m_mapped) + offset
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameRingBuffer::relocate(const GpuAllocation& allocation)
+{
+	for (auto& frameBuffer : m_frameBuffers)
+	{
+		const GpuAllocation& current = frameBuffer.m_memory.m_allocation;
+		if (current.m_memory == allocation.m_memory && current.m_offset == allocation.m_offset)
+		{
+			frameBuffer.m_relocating = true;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameRingBuffer::createFrameBuffer(FrameBuffer& frameBuffer, vk::DeviceSize size)
+{
+	//-- Allocator maps host visible blocks once, region stays mapped while buffer lives
+	frameBuffer.m_memory = m_graphicDevice->createBuffer(size
+		, m_usage
+		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		, GpuAllocationStrategy::Buddy
+		, this);
+
+	frameBuffer.m_mapped = frameBuffer.m_memory.m_allocation.m_mapped;
+	frameBuffer.m_capacity = size;
+}
+
+//-------------------------------------------------------------------------------------------------
+void FrameRingBuffer::destroyFrameBuffer(FrameBuffer& frameBuffer)
+{
+	if (frameBuffer.m_memory.m_buffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	m_graphicDevice->clearBuffer(frameBuffer.m_memory);
+
+	frameBuffer.m_memory = {};
+	frameBuffer.m_mapped = nullptr;
+	frameBuffer.m_capacity = 0;
+	frameBuffer.m_relocating = false;
+}
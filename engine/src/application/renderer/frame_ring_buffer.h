@@ -0,0 +1,61 @@
+#pragma once
+
+#define VULKAN_HPP_NO_EXCEPTIONS
+#include <vulkan/vulkan.hpp>
+
+#include <memory>
+#include <vector>
+
+#include <application/renderer/graphic_device.h>
+
+//-------------------------------------------------------------------------------------------------
+struct FrameAllocation
+{
+	vk::Buffer     m_buffer = VK_NULL_HANDLE;
+	vk::DeviceSize m_offset = 0;
+	void*          m_data = nullptr;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Host visible buffer per frame in flight, mapped once for its whole lifetime.
+//-- Frame data is suballocated linearly and the frame region is reused as soon as
+//-- the frame fence was waited in GraphicDevice::beginFrame. Relocated frame buffers are
+//-- recreated at the same point
+class FrameRingBuffer : public GpuAllocationOwner
+{
+public:
+	FrameRingBuffer(std::shared_ptr<GraphicDevice>   graphicDevice
+	                , vk::BufferUsageFlags           usage
+	                , vk::DeviceSize                 initialSize);
+	~FrameRingBuffer() override;
+
+	//-- Resets frame region, grows it geometrically if requiredSize doesn't fit
+	void beginFrame(uint8_t frameIndex, vk::DeviceSize requiredSize);
+	FrameAllocation allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+	vk::DeviceSize capacity() const { return m_frameBuffers[m_frameIndex].m_capacity; }
+	vk::DeviceSize usedSize() const { return m_head; }
+
+	void relocate(const GpuAllocation& allocation) override;
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct FrameBuffer
+	{
+		VulkanBufferMemory m_memory;
+		void*              m_mapped = nullptr;
+		vk::DeviceSize     m_capacity = 0;
+		//-- Memory block is evacuated, buffer moves when its frame comes next
+		bool               m_relocating = false;
+	};
+
+	void createFrameBuffer(FrameBuffer& frameBuffer, vk::DeviceSize size);
+	void destroyFrameBuffer(FrameBuffer& frameBuffer);
+
+private:
+	std::shared_ptr<GraphicDevice>   m_graphicDevice;
+	std::vector<FrameBuffer>         m_frameBuffers;
+	vk::BufferUsageFlags             m_usage;
+	vk::DeviceSize                   m_head = 0;
+	uint8_t                          m_frameIndex = 0;
+};
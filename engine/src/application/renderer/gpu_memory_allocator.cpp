@@ -0,0 +1,415 @@
+#include "gpu_memory_allocator.h"
+
+#include <application/core/utils/engine_assert.h>
+#include <application/core/utils/buddy_allocator.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <bit>
+#include <algorithm>
+#include <format>
+#include <print>
+#include <optional>
+
+//-------------------------------------------------------------------------------------------------
+constexpr vk::DeviceSize C_DEVICE_LOCAL_BLOCK_SIZE = 64ull * 1024 * 1024;
+constexpr vk::DeviceSize C_HOST_VISIBLE_BLOCK_SIZE = 16ull * 1024 * 1024;
+//-- Small heaps (integrated GPUs BAR, etc) are never taken by one block
+constexpr vk::DeviceSize C_MAX_HEAP_FRACTION = 8;
+
+//-------------------------------------------------------------------------------------------------
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Bump allocator, individual frees only count down live allocations
+struct LinearAllocator
+{
+	//-------------------------------------------------------------------------------------------------
+	std::optional<vk::DeviceSize> allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		const vk::DeviceSize offset = alignUp(m_head, alignment);
+		if (offset + size > m_size)
+		{
+			return std::nullopt;
+		}
+		m_head = offset + size;
+		++m_allocationsCount;
+		return offset;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	void free()
+	{
+		if (--m_allocationsCount == 0)
+		{
+			m_head = 0;
+		}
+	}
+
+	vk::DeviceSize m_size = 0;
+	vk::DeviceSize m_head = 0;
+	uint32_t       m_allocationsCount = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+struct GpuMemoryBlock
+{
+	uint32_t allocationsCount() const
+	{
+		return m_buddy ? m_buddy->allocationsCount() : m_linear.m_allocationsCount;
+	}
+
+	vk::DeviceSize usedSize() const
+	{
+		return m_buddy ? m_buddy->usedSize() : m_linear.m_head;
+	}
+
+	vk::DeviceMemory                m_memory = VK_NULL_HANDLE;
+	vk::DeviceSize                  m_size = 0;
+	void*                           m_mapped = nullptr;
+	uint32_t                        m_memoryType = 0;
+	bool                            m_dedicated = false;
+	//-- Block being evacuated by defragmentation doesn't accept new allocations
+	bool                            m_evacuating = false;
+	//-- Owners of buddy allocations by offset, allocations without owner aren't listed
+	absl::flat_hash_map<vk::DeviceSize, GpuAllocationOwner*> m_owners;
+	std::unique_ptr<BuddyAllocator> m_buddy;
+	LinearAllocator                 m_linear;
+};
+
+//-------------------------------------------------------------------------------------------------
+GpuMemoryAllocator::GpuMemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties& memoryProperties)
+	: m_device(device)
+	, m_memoryProperties(memoryProperties)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuMemoryAllocator::~GpuMemoryAllocator()
+{
+	const GpuMemoryStats leaked = stats();
+	if (leaked.m_allocationsCount > 0)
+	{
+		std::println("GpuMemoryAllocator: {} allocations ({} bytes) are still alive on shutdown"
+			, leaked.m_allocationsCount
+			, leaked.m_usedBytes);
+	}
+
+	for (auto& pool : m_pools)
+	{
+		for (auto& block : pool.m_blocks)
+		{
+			destroyBlock(*block);
+		}
+	}
+	for (auto& block : m_dedicatedBlocks)
+	{
+		destroyBlock(*block);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t GpuMemoryAllocator::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	engineAssert(false, std::format("Didn't find suitable memory type"));
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuAllocation GpuMemoryAllocator::allocate(const vk::MemoryRequirements& requirements
+                                           , vk::MemoryPropertyFlags     properties
+                                           , GpuResourceKind             resourceKind
+                                           , GpuAllocationStrategy       strategy
+                                           , GpuAllocationOwner*         owner)
+{
+	const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+	MemoryPool&    memoryPool = pool(memoryType, resourceKind, strategy);
+
+	auto makeAllocation = [&](GpuMemoryBlock& block, vk::DeviceSize offset)
+	{
+		return GpuAllocation{
+			.m_memory = block.m_memory
+			, .m_offset = offset
+			, .m_size = requirements.size
+			, .m_mapped = block.m_mapped ? static_cast<uint8_t*>(block.m_mapped) + offset : nullptr
+			, .m_block = &block
+			, .m_owner = owner
+		};
+	};
+
+	if (requirements.size > memoryPool.m_blockSize / 2)
+	{
+		//-- Whole block belongs to one allocation, linear state only serves stats
+		auto& block = m_dedicatedBlocks.emplace_back(createBlock(memoryType, requirements.size, GpuAllocationStrategy::Linear));
+		block->m_dedicated = true;
+		block->m_linear.m_head = requirements.size;
+		block->m_linear.m_allocationsCount = 1;
+		return makeAllocation(*block, 0);
+	}
+
+	auto tryAllocate = [&](GpuMemoryBlock& block) -> std::optional<vk::DeviceSize>
+	{
+		if (block.m_evacuating)
+		{
+			return std::nullopt;
+		}
+		return block.m_buddy
+			? block.m_buddy->allocate(requirements.size, requirements.alignment)
+			: block.m_linear.allocate(requirements.size, requirements.alignment);
+	};
+
+	auto addAllocation = [&](GpuMemoryBlock& block, vk::DeviceSize offset)
+	{
+		if (owner != nullptr && block.m_buddy)
+		{
+			block.m_owners[offset] = owner;
+		}
+		return makeAllocation(block, offset);
+	};
+
+	for (auto& block : memoryPool.m_blocks)
+	{
+		if (auto offset = tryAllocate(*block))
+		{
+			return addAllocation(*block, *offset);
+		}
+	}
+
+	auto& block = memoryPool.m_blocks.emplace_back(createBlock(memoryType, memoryPool.m_blockSize, strategy));
+	auto  offset = tryAllocate(*block);
+	engineAssert(offset.has_value(), "Allocation doesn't fit into empty memory block");
+
+	return addAllocation(*block, *offset);
+}
+
+//-------------------------------------------------------------------------------------------------
+void GpuMemoryAllocator::free(GpuAllocation& allocation)
+{
+	if (!allocation.isValid())
+	{
+		return;
+	}
+
+	GpuMemoryBlock& block = *allocation.m_block;
+	if (block.m_dedicated)
+	{
+		//-- Dedicated memory goes back to driver right away
+		auto it = std::ranges::find_if(m_dedicatedBlocks, [&](const auto& dedicated) { return dedicated.get() == &block; });
+		engineAssert(it != m_dedicatedBlocks.end(), "Unknown dedicated memory block");
+		destroyBlock(block);
+		m_dedicatedBlocks.erase(it);
+	}
+	else if (block.m_buddy)
+	{
+		block.m_buddy->free(allocation.m_offset);
+		block.m_owners.erase(allocation.m_offset);
+	}
+	else
+	{
+		block.m_linear.free();
+	}
+
+	allocation = {};
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t GpuMemoryAllocator::releaseEmptyBlocks()
+{
+	//-- One empty block per pool is kept to avoid allocate/free ping-pong
+	uint32_t released = 0;
+	for (auto& memoryPool : m_pools)
+	{
+		bool keptEmpty = false;
+		std::erase_if(memoryPool.m_blocks, [&](std::unique_ptr<GpuMemoryBlock>& block)
+			{
+				if (block->allocationsCount() > 0)
+				{
+					return false;
+				}
+				if (!keptEmpty && !block->m_evacuating)
+				{
+					keptEmpty = true;
+					return false;
+				}
+				destroyBlock(*block);
+				++released;
+				return true;
+			});
+	}
+	return released;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t GpuMemoryAllocator::defragment(float maxOccupancy)
+{
+	//-- Collect first, owners may allocate while they are told to relocate
+	std::vector<GpuAllocation> handedOff;
+	uint32_t                   evacuatedBlocks = 0;
+	for (auto& memoryPool : m_pools)
+	{
+		for (auto& block : memoryPool.m_blocks)
+		{
+			//-- Linear blocks hold transient data and rewind by themselves, evacuating ones
+			//-- were handed off already
+			if (!block->m_buddy || block->m_evacuating || block->allocationsCount() == 0)
+			{
+				continue;
+			}
+
+			const float occupancy = static_cast<float>(block->usedSize()) / static_cast<float>(block->m_size);
+			if (occupancy > maxOccupancy)
+			{
+				continue;
+			}
+
+			//-- Allocation nobody can move would keep the block forever
+			if (block->m_owners.size() != block->allocationsCount())
+			{
+				continue;
+			}
+
+			block->m_evacuating = true;
+			++evacuatedBlocks;
+			block->m_buddy->forEachAllocation([&](uint64_t offset, uint64_t size)
+				{
+					handedOff.push_back({
+						.m_memory = block->m_memory
+						, .m_offset = offset
+						, .m_size = size
+						, .m_mapped = block->m_mapped ? static_cast<uint8_t*>(block->m_mapped) + offset : nullptr
+						, .m_block = block.get()
+						, .m_owner = block->m_owners.at(offset)
+					});
+				});
+		}
+	}
+
+	for (const auto& allocation : handedOff)
+	{
+		allocation.m_owner->relocate(allocation);
+	}
+
+	if (!handedOff.empty())
+	{
+		std::println("GpuMemoryAllocator: {} allocations of {} sparse blocks handed to owners for relocation"
+			, handedOff.size()
+			, evacuatedBlocks);
+	}
+	return static_cast<uint32_t>(handedOff.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuMemoryStats GpuMemoryAllocator::stats() const
+{
+	GpuMemoryStats result;
+	for (const auto& memoryPool : m_pools)
+	{
+		for (const auto& block : memoryPool.m_blocks)
+		{
+			++result.m_blocksCount;
+			result.m_allocationsCount += block->allocationsCount();
+			result.m_reservedBytes += block->m_size;
+			result.m_usedBytes += block->usedSize();
+		}
+	}
+	for (const auto& block : m_dedicatedBlocks)
+	{
+		++result.m_dedicatedBlocksCount;
+		++result.m_allocationsCount;
+		result.m_reservedBytes += block->m_size;
+		result.m_usedBytes += block->m_size;
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuMemoryAllocator::MemoryPool& GpuMemoryAllocator::pool(uint32_t memoryType, GpuResourceKind resourceKind, GpuAllocationStrategy strategy)
+{
+	for (auto& memoryPool : m_pools)
+	{
+		if (memoryPool.m_memoryType == memoryType
+			&& memoryPool.m_resourceKind == resourceKind
+			&& memoryPool.m_strategy == strategy)
+		{
+			return memoryPool;
+		}
+	}
+
+	MemoryPool& memoryPool = m_pools.emplace_back();
+	memoryPool.m_memoryType = memoryType;
+	memoryPool.m_resourceKind = resourceKind;
+	memoryPool.m_strategy = strategy;
+	memoryPool.m_blockSize = preferredBlockSize(memoryType);
+	return memoryPool;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::unique_ptr<GpuMemoryBlock> GpuMemoryAllocator::createBlock(uint32_t memoryType, vk::DeviceSize size, GpuAllocationStrategy strategy)
+{
+	auto block = std::make_unique<GpuMemoryBlock>();
+	block->m_size = size;
+	block->m_memoryType = memoryType;
+
+	vk::MemoryAllocateInfo allocInfo = {};
+	allocInfo.setMemoryTypeIndex(memoryType)
+		.setAllocationSize(size);
+	{
+		auto [res, memory] = m_device.allocateMemory(allocInfo);
+		engineAssert(res == vk::Result::eSuccess, std::format("Failed to allocate {} bytes of device memory", size));
+		block->m_memory = memory;
+	}
+
+	if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+	{
+		auto res = m_device.mapMemory(block->m_memory, 0, size, {}, &block->m_mapped);
+		engineAssert(res == vk::Result::eSuccess, "Failed to map memory block");
+	}
+
+	if (strategy == GpuAllocationStrategy::Buddy)
+	{
+		block->m_buddy = std::make_unique<BuddyAllocator>(size);
+	}
+	else
+	{
+		block->m_linear.m_size = size;
+	}
+
+	return block;
+}
+
+//-------------------------------------------------------------------------------------------------
+void GpuMemoryAllocator::destroyBlock(GpuMemoryBlock& block)
+{
+	if (block.m_mapped)
+	{
+		m_device.unmapMemory(block.m_memory);
+		block.m_mapped = nullptr;
+	}
+	m_device.freeMemory(block.m_memory);
+	block.m_memory = VK_NULL_HANDLE;
+}
+
+//-------------------------------------------------------------------------------------------------
+vk::DeviceSize GpuMemoryAllocator::preferredBlockSize(uint32_t memoryType) const
+{
+	const auto&          memoryTypeInfo = m_memoryProperties.memoryTypes[memoryType];
+	const vk::DeviceSize heapSize = m_memoryProperties.memoryHeaps[memoryTypeInfo.heapIndex].size;
+
+	const vk::DeviceSize blockSize = (memoryTypeInfo.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+		? C_HOST_VISIBLE_BLOCK_SIZE
+		: C_DEVICE_LOCAL_BLOCK_SIZE;
+
+	//-- Buddy blocks have to be power of two
+	return std::bit_floor(std::min(blockSize, std::max<vk::DeviceSize>(heapSize / C_MAX_HEAP_FRACTION, 1)));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#define VULKAN_HPP_NO_EXCEPTIONS
+#include <vulkan/vulkan.hpp>
+
+#include <memory>
+#include <vector>
+
+struct GpuMemoryBlock;
+struct GpuAllocation;
+
+//-------------------------------------------------------------------------------------------------
+//-- Resource owner defragmentation can ask to move. Owner recreates the resource in a new
+//-- allocation when GPU is done with the old one and frees the old one the usual way
+class GpuAllocationOwner
+{
+public:
+	virtual ~GpuAllocationOwner() = default;
+	virtual void relocate(const GpuAllocation& allocation) = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+enum class GpuAllocationStrategy : uint8_t
+{
+	//-- General purpose, freed ranges are merged back
+	Buddy,
+	//-- Bump allocation for short lived data, block rewinds when all its allocations are freed
+	Linear
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Linear buffers and optimal images never share a block, so bufferImageGranularity
+//-- doesn't have to be tracked inside blocks
+enum class GpuResourceKind : uint8_t
+{
+	Buffer,
+	Image
+};
+
+//-------------------------------------------------------------------------------------------------
+struct GpuAllocation
+{
+	bool isValid() const { return m_block != nullptr; }
+
+	vk::DeviceMemory m_memory = VK_NULL_HANDLE;
+	vk::DeviceSize   m_offset = 0;
+	vk::DeviceSize   m_size = 0;
+	//-- Host visible blocks are mapped once, nullptr otherwise
+	void*            m_mapped = nullptr;
+	GpuMemoryBlock*  m_block = nullptr;
+	//-- Given on allocate, allocations without owner can't be moved and pin their block
+	GpuAllocationOwner* m_owner = nullptr;
+};
+
+//-------------------------------------------------------------------------------------------------
+struct GpuMemoryStats
+{
+	uint32_t       m_blocksCount = 0;
+	uint32_t       m_dedicatedBlocksCount = 0;
+	uint32_t       m_allocationsCount = 0;
+	vk::DeviceSize m_reservedBytes = 0;
+	vk::DeviceSize m_usedBytes = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Suballocates device memory from big blocks, one pool per memory type, resource kind and
+//-- strategy. Requests bigger than half of a block get dedicated memory
+class GpuMemoryAllocator
+{
+public:
+	GpuMemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties& memoryProperties);
+	~GpuMemoryAllocator();
+
+	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+	GpuAllocation allocate(const vk::MemoryRequirements& requirements
+	                       , vk::MemoryPropertyFlags     properties
+	                       , GpuResourceKind             resourceKind
+	                       , GpuAllocationStrategy       strategy = GpuAllocationStrategy::Buddy
+	                       , GpuAllocationOwner*         owner = nullptr);
+	void free(GpuAllocation& allocation);
+
+	//-- Defragmentation hooks. Empty blocks are released once GPU is done with the frees that
+	//-- emptied them, so the caller runs it after frame fence wait
+	uint32_t releaseEmptyBlocks();
+	//-- Sparse blocks whose allocations all have owners stop taking new allocations and their
+	//-- allocations are handed to owners. Blocks stay evacuating until owners freed everything
+	//-- and releaseEmptyBlocks returns them. Returns handed off allocations count
+	uint32_t defragment(float maxOccupancy);
+
+	GpuMemoryStats stats() const;
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct MemoryPool
+	{
+		uint32_t                                     m_memoryType = 0;
+		GpuResourceKind                              m_resourceKind = GpuResourceKind::Buffer;
+		GpuAllocationStrategy                        m_strategy = GpuAllocationStrategy::Buddy;
+		vk::DeviceSize                               m_blockSize = 0;
+		std::vector<std::unique_ptr<GpuMemoryBlock>> m_blocks;
+	};
+
+	MemoryPool& pool(uint32_t memoryType, GpuResourceKind resourceKind, GpuAllocationStrategy strategy);
+	std::unique_ptr<GpuMemoryBlock> createBlock(uint32_t memoryType, vk::DeviceSize size, GpuAllocationStrategy strategy);
+	void destroyBlock(GpuMemoryBlock& block);
+	vk::DeviceSize preferredBlockSize(uint32_t memoryType) const;
+
+private:
+	vk::Device                         m_device;
+	vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+	std::vector<MemoryPool>            m_pools;
+	//-- Allocations too big for pool blocks, one block each
+	std::vector<std::unique_ptr<GpuMemoryBlock>> m_dedicatedBlocks;
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#define VULKAN_HPP_NO_EXCEPTIONS
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <application/editor/imgui_integration.h>
+#include <application/renderer/gpu_memory_allocator.h>
+#include <application/renderer/image_data.h>
+#include <application/renderer/render_packet.h>
+#include <application/renderer/texture_data.h>
+#include <application/renderer/upload_context.h>
+
+struct GLFWwindow;
+
+constexpr int C_MAX_FRAMES_IN_FLIGHT = 2;
+
+//-------------------------------------------------------------------------------------------------
+struct VertexData
+{
+	glm::vec4 m_vertex;
+	glm::vec3 m_color;
+	glm::vec2 m_texCoord;
+	//-- Slot in bindless texture array, unused when textures are bound per batch
+	uint32_t  m_textureIndex = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Per sprite record of the instanced path, quad corners are generated in vertex shader
+struct SpriteInstanceData
+{
+	glm::vec2 m_position;
+	float     m_depth;
+	//-- Half float x/y scale
+	uint32_t  m_scale;
+	//-- Unorm16 min/max texture coordinates
+	uint64_t  m_uvRect;
+	//-- RGBA8 tint
+	uint32_t  m_color;
+	//-- Half float rotation in radians in low 16 bits, bindless texture slot in high 16 bits
+	uint32_t  m_rotationAndTexture;
+};
+static_assert(sizeof(SpriteInstanceData) == 32, "Keep sprite instance data compact");
+
+//-------------------------------------------------------------------------------------------------
+struct VulkanBufferMemory
+{
+	vk::Buffer    m_buffer;
+	GpuAllocation m_allocation;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Sprite pipelines in draw order, value is the pipeline field of sprite sort key
+enum class SpritePass : uint8_t
+{
+	//-- Depth tested and written without blending, drawn front to back
+	Opaque,
+	//-- Same as opaque, texels below half alpha are discarded
+	Cutout,
+	//-- Depth tested but not written, blended back to front over opaque sprites
+	Translucent,
+
+	Count
+};
+
+//-------------------------------------------------------------------------------------------------
+struct TexturedGeometry
+{
+	//-- Frame ring buffer region holding vertices or instances of the batch
+	vk::Buffer        m_vertexBuffer;
+	vk::DeviceSize    m_vertexOffset = 0;
+	vk::DescriptorSet m_textureDescriptorSet;
+	uint32_t          m_spritesCount;
+	SpritePass        m_pass = SpritePass::Translucent;
+};
+
+using TexturedGeometryBatch = std::vector<TexturedGeometry>;
+
+//-------------------------------------------------------------------------------------------------
+//-- Sprite batches recording of the last frame
+struct CommandRecordingStats
+{
+	//-- Wall time from recording start to the last batch recorded
+	float    m_recordingMs = 0.0f;
+	uint32_t m_batchesCount = 0;
+	//-- Secondary command buffers recorded in parallel, zero for inline recording
+	uint32_t m_tasksCount = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Fragment shader invocations of sprite draws, read back once frame fence is passed,
+//-- so numbers are C_MAX_FRAMES_IN_FLIGHT frames old
+struct OverdrawStats
+{
+	//-- Device has no pipeline statistics queries otherwise
+	bool     m_measured = false;
+	uint64_t m_fragmentInvocations = 0;
+	//-- Invocations per framebuffer pixel, 1.0 is every pixel shaded once
+	float    m_overdraw = 0.0f;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Device objects of one sampled texture. Vulkan handles are opaque ids for null device
+struct GpuTexture
+{
+	vk::Image         m_image = VK_NULL_HANDLE;
+	vk::ImageView     m_imageView = VK_NULL_HANDLE;
+	GpuAllocation     m_memory;
+	//-- Own set when textures are bound per batch
+	vk::DescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	//-- Slot in device texture array, used instead of own set in bindless mode
+	uint32_t          m_bindlessIndex = 0;
+	//-- Last upload batch touching the image
+	UploadTicket      m_uploadTicket = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Everything renderer, batch drawer and texture cache need from a device. Backend specific
+//-- setup happens on concrete device before init
+class GraphicDevice
+{
+public:
+	virtual ~GraphicDevice() = default;
+
+	//-- Window is null in headless mode
+	virtual void init(GLFWwindow* window) = 0;
+	virtual void resizedWindow() = 0;
+	virtual void beginFrame(float dt) = 0;
+	virtual void endFrame(const TexturedGeometryBatch& geometryBatch, vk::Buffer quadIndexBuffer) = 0;
+	virtual void waitGraphicIdle() = 0;
+	virtual uint8_t maxFrames() const = 0;
+	virtual uint8_t currFrame() const = 0;
+
+	virtual VulkanBufferMemory createBuffer(vk::DeviceSize            size
+	                                        , vk::BufferUsageFlags    usageFlags
+	                                        , vk::MemoryPropertyFlags memPropFlags
+	                                        , GpuAllocationStrategy   strategy = GpuAllocationStrategy::Buddy
+	                                        , GpuAllocationOwner*     owner = nullptr) = 0;
+	virtual VulkanBufferMemory createQuadIndexBuffer(uint32_t spriteCount) = 0;
+	virtual void clearBuffer(VulkanBufferMemory memory) = 0;
+
+	//-- Block compressed formats need device feature, RGBA8 is always there
+	virtual bool supportsTextureFormat(TextureFormat format) const = 0;
+	virtual bool bindlessTextures() const = 0;
+	//-- All levels are uploaded in texture format, which device has to support
+	virtual GpuTexture createTexture(const TextureData& texture) = 0;
+	//-- RGBA8 textures only, every level of region is written at x and y of level 0 scaled down
+	//-- to that level. Rest of the image is preserved
+	virtual void updateTexture(GpuTexture& texture, uint32_t x, uint32_t y, const TextureData& region) = 0;
+	//-- Waits for pending upload of the texture
+	virtual void destroyTexture(GpuTexture& texture) = 0;
+	virtual bool isUploadComplete(UploadTicket ticket) = 0;
+
+	virtual GpuMemoryStats memoryStats() const = 0;
+	virtual const CommandRecordingStats& recordingStats() const = 0;
+	virtual const OverdrawStats& overdrawStats() const = 0;
+	//-- Copy of the last submitted frame, empty when device can't read frames back
+	virtual std::optional<ImageData> readbackLastFrame() = 0;
+
+	//-- Both are set for the next endFrame
+	virtual void setImGuiDrawData(ImDrawData* imGuiDrawData) = 0;
+	virtual void setCamera(const RenderCamera& camera) = 0;
+	//-- Null when there is nothing to show UI on
+	virtual ImGuiIntegration* imGui() = 0;
+	//-- Graphic queue is shared by frame submission, uploads and ImGui viewports, which may
+	//-- be driven from different threads
+	virtual std::mutex& graphicQueueMutex() = 0;
+};
@@ -0,0 +1,136 @@
+#include "image_data.h"
+
+#include <application/core/utils/engine_assert.h>
+
+#include <format>
+#include <fstream>
+#include <array>
+#include <cstring>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+//-------------------------------------------------------------------------------------------------
+ImageData loadImageData(std::string_view path)
+{
+	std::optional<ImageData> image = tryLoadImageData(path);
+	engineAssert(image.has_value(), std::format("Failed to load texture: {}", path));
+
+	return std::move(*image);
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<ImageData> tryLoadImageData(std::string_view path)
+{
+	int width, height, channels;
+	//-- Thread local flag, global one would race between workers
+	stbi_set_flip_vertically_on_load_thread(true);
+	stbi_uc* pixels = stbi_load(path.data(), &width, &height, &channels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+	{
+		return std::nullopt;
+	}
+
+	ImageData image;
+	image.m_width = static_cast<uint32_t>(width);
+	image.m_height = static_cast<uint32_t>(height);
+
+	size_t imageSize = static_cast<size_t>(width) * height * 4; // RGBA
+	image.m_pixels.resize(imageSize);
+	memcpy(image.m_pixels.data(), pixels, imageSize);
+
+	stbi_image_free(pixels);
+
+	return image;
+}
+
+//-------------------------------------------------------------------------------------------------
+void writeImageTga(const ImageData& image, const std::filesystem::path& path)
+{
+	//-- Bottom-left origin, loader flips it back so rows keep memory order
+	std::array<uint8_t, 18> header = {};
+	header[2] = 2; //-- Uncompressed true color
+	header[12] = static_cast<uint8_t>(image.m_width & 0xFF);
+	header[13] = static_cast<uint8_t>(image.m_width >> 8);
+	header[14] = static_cast<uint8_t>(image.m_height & 0xFF);
+	header[15] = static_cast<uint8_t>(image.m_height >> 8);
+	header[16] = 32;   //-- Bits per pixel
+	header[17] = 0x08; //-- Alpha bits
+
+	std::vector<uint8_t> bgraPixels(image.m_pixels.size());
+	for (size_t i = 0; i < image.m_pixels.size(); i += 4)
+	{
+		bgraPixels[i + 0] = image.m_pixels[i + 2];
+		bgraPixels[i + 1] = image.m_pixels[i + 1];
+		bgraPixels[i + 2] = image.m_pixels[i + 0];
+		bgraPixels[i + 3] = image.m_pixels[i + 3];
+	}
+
+	std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+	engineAssert(out.is_open(), std::format("Failed to write image: {}", path.generic_string()));
+	out.write(reinterpret_cast<const char*>(header.data()), header.size());
+	out.write(reinterpret_cast<const char*>(bgraPixels.data()), bgraPixels.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+void blitImage(ImageData& dst, const ImageData& src, uint32_t x, uint32_t y)
+{
+	engineAssert(x + src.m_width <= dst.m_width && y + src.m_height <= dst.m_height, "Blit region is out of image");
+
+	const size_t srcRowSize = static_cast<size_t>(src.m_width) * 4;
+	for (uint32_t row = 0; row < src.m_height; ++row)
+	{
+		const size_t dstOffset = (static_cast<size_t>(y + row) * dst.m_width + x) * 4;
+		memcpy(dst.m_pixels.data() + dstOffset, src.m_pixels.data() + row * srcRowSize, srcRowSize);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+AlphaMode classifyImageAlpha(const ImageData& image)
+{
+	//-- Empty image is the transparent placeholder case
+	if (!image.isValid())
+	{
+		return AlphaMode::Translucent;
+	}
+
+	AlphaMode mode = AlphaMode::Opaque;
+	for (size_t i = 3; i < image.m_pixels.size(); i += 4)
+	{
+		const uint8_t alpha = image.m_pixels[i];
+		if (alpha == 0)
+		{
+			mode = AlphaMode::Cutout;
+		}
+		else if (alpha != 255)
+		{
+			return AlphaMode::Translucent;
+		}
+	}
+	return mode;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<AlphaMode> parseAlphaMode(std::string_view name)
+{
+	for (const AlphaMode mode : { AlphaMode::Opaque, AlphaMode::Cutout, AlphaMode::Translucent })
+	{
+		if (alphaModeName(mode) == name)
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string_view alphaModeName(AlphaMode mode)
+{
+	switch (mode)
+	{
+	case AlphaMode::Opaque: return "opaque";
+	case AlphaMode::Cutout: return "cutout";
+	case AlphaMode::Translucent: return "translucent";
+	}
+	return "translucent";
+}
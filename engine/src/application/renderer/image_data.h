@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include <optional>
+
+//-------------------------------------------------------------------------------------------------
+//-- RGBA8 pixels on CPU side, rows are stored in the same order as texture memory
+struct ImageData
+{
+	bool isValid() const { return !m_pixels.empty(); }
+
+	uint32_t             m_width = 0;
+	uint32_t             m_height = 0;
+	std::vector<uint8_t> m_pixels;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- How sprite using the image has to be drawn, decided once from its alpha channel
+enum class AlphaMode : uint8_t
+{
+	//-- Every texel has full alpha, drawn without blending with depth write
+	Opaque,
+	//-- Texels are either fully transparent or fully opaque, transparent ones are discarded
+	Cutout,
+	//-- Partial alpha somewhere, blended back to front
+	Translucent
+};
+
+//-------------------------------------------------------------------------------------------------
+ImageData loadImageData(std::string_view path);
+//-- Doesn't assert, safe to call from worker threads
+std::optional<ImageData> tryLoadImageData(std::string_view path);
+//-- Uncompressed 32 bit TGA, loadImageData reads it back into the same row order
+void writeImageTga(const ImageData& image, const std::filesystem::path& path);
+//-- Copies whole src into dst at x/y, src has to fit
+void blitImage(ImageData& dst, const ImageData& src, uint32_t x, uint32_t y);
+AlphaMode classifyImageAlpha(const ImageData& image);
+std::optional<AlphaMode> parseAlphaMode(std::string_view name);
+std::string_view alphaModeName(AlphaMode mode);
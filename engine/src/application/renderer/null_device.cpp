@@ -0,0 +1,172 @@
+#include "null_device.h"
+
+#include <chrono>
+#include <cstring>
+#include <print>
+
+//-------------------------------------------------------------------------------------------------
+//-- Non dispatchable handles are 64 bit on every platform, ids start from one so none is null
+template<typename Handle>
+Handle NullGraphicDevice::makeHandle()
+{
+	typename Handle::CType rawHandle = {};
+	static_assert(sizeof(rawHandle) == sizeof(m_nextHandle), "Handle doesn't fit 64 bit id");
+
+	const uint64_t handleId = m_nextHandle++;
+	std::memcpy(&rawHandle, &handleId, sizeof(handleId));
+	return Handle(rawHandle);
+}
+
+//-------------------------------------------------------------------------------------------------
+NullGraphicDevice::~NullGraphicDevice()
+{
+	std::println("Null device: {} frames, {} draws of {} sprites, {} uploads of {:.1f} MB"
+		, m_stats.m_framesCount
+		, m_stats.m_drawsCount
+		, m_stats.m_spritesCount
+		, m_stats.m_uploadsCount
+		, m_stats.m_uploadedBytes / (1024.0 * 1024.0));
+}
+
+//-------------------------------------------------------------------------------------------------
+void NullGraphicDevice::init(GLFWwindow*)
+{
+	std::println("Null device: no GPU work is done, bindless textures {}", m_bindlessTextures ? "enabled" : "disabled");
+}
+
+//-------------------------------------------------------------------------------------------------
+void NullGraphicDevice::endFrame(const TexturedGeometryBatch& geometryBatch, vk::Buffer)
+{
+	const auto submitStart = std::chrono::steady_clock::now();
+
+	uint64_t spritesCount = 0;
+	for (const TexturedGeometry& geometry : geometryBatch)
+	{
+		spritesCount += geometry.m_spritesCount;
+	}
+
+	++m_stats.m_framesCount;
+	m_stats.m_drawsCount += geometryBatch.size();
+	m_stats.m_spritesCount += spritesCount;
+	m_recordingStats = {
+		.m_recordingMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - submitStart).count()
+		, .m_batchesCount = static_cast<uint32_t>(geometryBatch.size())
+		, .m_tasksCount = 0
+	};
+
+	m_currFrame = (m_currFrame + 1) % C_MAX_FRAMES_IN_FLIGHT;
+}
+
+//-------------------------------------------------------------------------------------------------
+VulkanBufferMemory NullGraphicDevice::createBuffer(vk::DeviceSize            size
+                                                   , vk::BufferUsageFlags
+                                                   , vk::MemoryPropertyFlags memPropFlags
+                                                   , GpuAllocationStrategy
+                                                   , GpuAllocationOwner*)
+{
+	VulkanBufferMemory bufferMemory;
+	bufferMemory.m_buffer = makeHandle<vk::Buffer>();
+	bufferMemory.m_allocation.m_size = size;
+
+	if (memPropFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+	{
+		std::vector<uint8_t>& hostMemory = m_hostBuffers[static_cast<VkBuffer>(bufferMemory.m_buffer)];
+		hostMemory.resize(size);
+		bufferMemory.m_allocation.m_mapped = hostMemory.data();
+	}
+
+	++m_stats.m_buffersAlive;
+	m_stats.m_bufferBytes += size;
+	return bufferMemory;
+}
+
+//-------------------------------------------------------------------------------------------------
+VulkanBufferMemory NullGraphicDevice::createQuadIndexBuffer(uint32_t spriteCount)
+{
+	//-- Indices themselves are never read, only their upload is accounted
+	const vk::DeviceSize bufferSize = static_cast<vk::DeviceSize>(spriteCount) * 6 * sizeof(uint32_t);
+
+	++m_stats.m_uploadsCount;
+	m_stats.m_uploadedBytes += bufferSize;
+	return createBuffer(bufferSize
+		, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer
+		, vk::MemoryPropertyFlagBits::eDeviceLocal);
+}
+
+//-------------------------------------------------------------------------------------------------
+void NullGraphicDevice::clearBuffer(VulkanBufferMemory memory)
+{
+	if (!memory.m_buffer)
+	{
+		return;
+	}
+
+	m_hostBuffers.erase(static_cast<VkBuffer>(memory.m_buffer));
+	--m_stats.m_buffersAlive;
+	m_stats.m_bufferBytes -= memory.m_allocation.m_size;
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuTexture NullGraphicDevice::createTexture(const TextureData& texture)
+{
+	GpuTexture gpuTexture;
+	gpuTexture.m_image = makeHandle<vk::Image>();
+	gpuTexture.m_imageView = makeHandle<vk::ImageView>();
+	gpuTexture.m_memory.m_size = texture.m_data.size();
+
+	if (m_bindlessTextures)
+	{
+		if (m_freeBindlessSlots.empty())
+		{
+			gpuTexture.m_bindlessIndex = m_nextBindlessIndex++;
+		}
+		else
+		{
+			gpuTexture.m_bindlessIndex = m_freeBindlessSlots.back();
+			m_freeBindlessSlots.pop_back();
+		}
+	}
+	else
+	{
+		gpuTexture.m_descriptorSet = makeHandle<vk::DescriptorSet>();
+	}
+
+	++m_stats.m_texturesAlive;
+	m_stats.m_textureBytes += texture.m_data.size();
+	gpuTexture.m_uploadTicket = ++m_stats.m_uploadsCount;
+	m_stats.m_uploadedBytes += texture.m_data.size();
+	return gpuTexture;
+}
+
+//-------------------------------------------------------------------------------------------------
+void NullGraphicDevice::updateTexture(GpuTexture& texture, uint32_t, uint32_t, const TextureData& region)
+{
+	texture.m_uploadTicket = ++m_stats.m_uploadsCount;
+	m_stats.m_uploadedBytes += region.m_data.size();
+}
+
+//-------------------------------------------------------------------------------------------------
+void NullGraphicDevice::destroyTexture(GpuTexture& texture)
+{
+	if (m_bindlessTextures)
+	{
+		m_freeBindlessSlots.push_back(texture.m_bindlessIndex);
+	}
+
+	--m_stats.m_texturesAlive;
+	m_stats.m_textureBytes -= texture.m_memory.m_size;
+	texture = {};
+}
+
+//-------------------------------------------------------------------------------------------------
+GpuMemoryStats NullGraphicDevice::memoryStats() const
+{
+	const vk::DeviceSize usedBytes = m_stats.m_bufferBytes + m_stats.m_textureBytes;
+	return {
+		.m_blocksCount = 0
+		, .m_dedicatedBlocksCount = 0
+		, .m_allocationsCount = m_stats.m_buffersAlive + m_stats.m_texturesAlive
+		, .m_reservedBytes = usedBytes
+		, .m_usedBytes = usedBytes
+	};
+}
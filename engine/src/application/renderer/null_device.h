@@ -0,0 +1,93 @@
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <application/renderer/graphic_device.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- What renderer asked null device for. Alive counts go down as resources are freed,
+//-- frame and upload numbers only grow
+struct NullDeviceStats
+{
+	uint64_t m_framesCount = 0;
+	uint64_t m_drawsCount = 0;
+	uint64_t m_spritesCount = 0;
+	uint32_t m_buffersAlive = 0;
+	uint64_t m_bufferBytes = 0;
+	uint32_t m_texturesAlive = 0;
+	uint64_t m_textureBytes = 0;
+	uint64_t m_uploadsCount = 0;
+	uint64_t m_uploadedBytes = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Accepts buffers, textures and draws and does no GPU work, so CPU cost of extraction,
+//-- batching and submission is measured without driver noise. Host visible buffers are backed
+//-- by host memory since renderer writes frame data into them. Handles are unique ids only
+class NullGraphicDevice : public GraphicDevice
+{
+public:
+	//-- Bindless mode is taken as requested, so batches are split the same way as on GPU
+	explicit NullGraphicDevice(bool bindlessTextures) : m_bindlessTextures(bindlessTextures) {}
+	~NullGraphicDevice() override;
+
+	void init(GLFWwindow* window) override;
+	void resizedWindow() override {}
+	void beginFrame(float /*dt*/) override {}
+	void endFrame(const TexturedGeometryBatch& geometryBatch, vk::Buffer quadIndexBuffer) override;
+	//-- Everything completes right away
+	void waitGraphicIdle() override {}
+	uint8_t maxFrames() const override { return C_MAX_FRAMES_IN_FLIGHT; }
+	uint8_t currFrame() const override { return m_currFrame; }
+
+	VulkanBufferMemory createBuffer(vk::DeviceSize            size
+	                                , vk::BufferUsageFlags    usageFlags
+	                                , vk::MemoryPropertyFlags memPropFlags
+	                                , GpuAllocationStrategy   strategy = GpuAllocationStrategy::Buddy
+	                                , GpuAllocationOwner*     owner = nullptr) override;
+	VulkanBufferMemory createQuadIndexBuffer(uint32_t spriteCount) override;
+	void clearBuffer(VulkanBufferMemory memory) override;
+
+	//-- Formats of a desktop GPU
+	bool supportsTextureFormat(TextureFormat format) const override { return format != TextureFormat::ASTC4x4; }
+	bool bindlessTextures() const override { return m_bindlessTextures; }
+	GpuTexture createTexture(const TextureData& texture) override;
+	void updateTexture(GpuTexture& texture, uint32_t x, uint32_t y, const TextureData& region) override;
+	void destroyTexture(GpuTexture& texture) override;
+	bool isUploadComplete(UploadTicket) override { return true; }
+
+	GpuMemoryStats memoryStats() const override;
+	const CommandRecordingStats& recordingStats() const override { return m_recordingStats; }
+	const OverdrawStats& overdrawStats() const override { return m_overdrawStats; }
+	std::optional<ImageData> readbackLastFrame() override { return std::nullopt; }
+
+	void setImGuiDrawData(ImDrawData*) override {}
+	void setCamera(const RenderCamera&) override {}
+	ImGuiIntegration* imGui() override { return nullptr; }
+	std::mutex& graphicQueueMutex() override { return m_graphicQueueMutex; }
+
+	const NullDeviceStats& stats() const { return m_stats; }
+
+private:
+	template<typename Handle>
+	Handle makeHandle();
+
+private:
+	NullDeviceStats       m_stats;
+	CommandRecordingStats m_recordingStats;
+	//-- Nothing is rasterized, stays unmeasured
+	OverdrawStats         m_overdrawStats;
+	//-- Backing memory of host visible buffers
+	absl::flat_hash_map<VkBuffer, std::vector<uint8_t>> m_hostBuffers;
+	std::mutex            m_graphicQueueMutex;
+	uint64_t              m_nextHandle = 1;
+	uint32_t              m_nextBindlessIndex = 0;
+	std::vector<uint32_t> m_freeBindlessSlots;
+	uint8_t               m_currFrame = 0;
+	bool                  m_bindlessTextures = false;
+};
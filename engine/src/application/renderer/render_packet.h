@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <application/editor/imgui_integration.h>
+#include <application/managers/renderer_manager.h>
+
+//-------------------------------------------------------------------------------------------------
+struct RenderCamera
+{
+	glm::mat4  m_view = glm::mat4(1.0f);
+	glm::mat4  m_proj = glm::mat4(1.0f);
+	//-- Read from window by main thread, swapchain is sized by it when surface doesn't tell
+	glm::uvec2 m_framebufferSize = { 0, 0 };
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Everything renderer needs for one frame, built by main thread and never changed after.
+//-- Rendered right away or handed over to render thread
+struct RenderPacket
+{
+	uint64_t       m_frameIndex = 0;
+	float          m_dt = 0.0f;
+	SpriteDrawList m_sprites;
+	//-- Retained mode only, see RendererManager
+	std::vector<uint32_t> m_spriteSlots;
+	std::vector<uint32_t> m_removedSpriteSlots;
+	RenderCamera   m_camera;
+	//-- Live ImGui data when packet is rendered on main thread, points into snapshot otherwise
+	ImDrawData*                        m_imGuiDrawData = nullptr;
+	std::unique_ptr<ImGuiDrawSnapshot> m_imGuiSnapshot;
+};
@@ -3,128 +3,680 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/glm.hpp>
 
 #include <application/core/event_interface.h>
 #include <application/managers/window_manager.h>
 #include <application/engine_context.h>
 #include <application/managers/virtual_fs.h>
+#include <application/managers/asset_registry.h>
 #include <application/core/utils/engine_assert.h>
+#include <application/renderer/sprite_sort_key.h>
+#include <application/renderer/device.h>
+#include <application/renderer/null_device.h>
+#include <application/core/utils/thread_pool.h>
+
+#include <GLFW/glfw3.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Region of standalone texture
+constexpr glm::vec4 C_FULL_UV_RECT = { 0.0f, 0.0f, 1.0f, 1.0f };
+//-- Single material for now, key already has room for it
+constexpr uint32_t  C_DEFAULT_MATERIAL_ID = 0;
+
+//-------------------------------------------------------------------------------------------------
+//-- GLFW window is read on main thread only, packet carries the result.
+//-- Windowless frames have fixed size from config instead
+RenderCamera makeRenderCamera(GLFWwindow* window, const RendererConfig& config)
+{
+	int width = static_cast<int>(config.m_headlessWidth);
+	int height = static_cast<int>(config.m_headlessHeight);
+	if (!config.windowless())
+	{
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+
+	RenderCamera camera;
+	camera.m_framebufferSize = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	camera.m_view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f)
+		, glm::vec3(0.0f, 0.0f, 0.0f)
+		, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.m_proj = glm::perspective(glm::radians(45.0f)
+		, static_cast<float>(std::max(width, 1)) / static_cast<float>(std::max(height, 1))
+		, 0.1f
+		, 10.0f);
+	camera.m_proj[1][1] *= -1;
+	return camera;
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- One record per sprite for instanced path, four vertices otherwise
+std::span<const std::byte> spriteGeometryBytes(const SpriteFrameGeometry& spriteFrame, SpriteRenderPath renderPath)
+{
+	return renderPath == SpriteRenderPath::Instanced
+		? std::as_bytes(std::span(spriteFrame.m_instances))
+		: std::as_bytes(std::span(spriteFrame.m_vertices));
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Backend specific setup goes before init, renderer sees the interface only afterwards
+std::shared_ptr<GraphicDevice> makeGraphicDevice(std::shared_ptr<EngineContext> context, const RendererConfig& config)
+{
+	if (config.m_graphicBackend == GraphicBackend::Null)
+	{
+		return std::make_shared<NullGraphicDevice>(config.m_bindlessTextures);
+	}
+
+	auto device = std::make_shared<VkGraphicDevice>(context);
+	device->setSpriteRenderPath(config.m_spriteRenderPath);
+	device->requestBindlessTextures(config.m_bindlessTextures);
+	device->requestShaderCompilation(config.m_compileShaders);
+	device->requestRecordingThreads(config.m_recordingThreads);
+	device->requestHeadless(config.m_headless);
+	return device;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::array<VertexData, 4> makeSpriteVertices(const SpriteInfo& sprite, const glm::vec4& uvRect, uint32_t textureIndex)
+{
+	std::array<VertexData, 4> transformedData = {};
+
+	//-- Here we transfrom from local to world coordinates
+	for (int i = 0; i < 4; ++i)
+	{
+		transformedData[i].m_color = glm::vec3(sprite.m_color);
+		transformedData[i].m_texCoord = glm::mix(glm::vec2(uvRect.x, uvRect.y)
+			, glm::vec2(uvRect.z, uvRect.w)
+			, C_QUAD_BASIC_DATA[i].m_texCoord);
+		const glm::vec2 corner = sprite.m_transform * glm::vec3(glm::vec2(C_QUAD_BASIC_DATA[i].m_vertex), 1.0f);
+		transformedData[i].m_vertex = glm::vec4(corner, sprite.m_depth, 1.0f);
+		transformedData[i].m_textureIndex = textureIndex;
+	}
+	return transformedData;
+}
+
+//-------------------------------------------------------------------------------------------------
+SpriteInstanceData makeSpriteInstance(const SpriteInfo& sprite, const glm::vec4& uvRect, uint32_t textureIndex)
+{
+	return {
+		.m_position = sprite.m_transform[2]
+		, .m_depth = sprite.m_depth
+		, .m_scale = glm::packHalf2x16(sprite.m_scale)
+		, .m_uvRect = glm::packUnorm4x16(uvRect)
+		, .m_color = glm::packUnorm4x8(sprite.m_color)
+		, .m_rotationAndTexture = (glm::packHalf2x16(glm::vec2(sprite.m_rotation, 0.0f)) & 0xFFFFu) | (textureIndex << 16)
+	};
+}
+
+//-------------------------------------------------------------------------------------------------
+glm::vec4 atlasUvRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t pageSize)
+{
+	const float size = static_cast<float>(pageSize);
+	return { x / size, y / size, (x + width) / size, (y + height) / size };
+}
+
+//-------------------------------------------------------------------------------------------------
+TextureCache::TextureCache(std::shared_ptr<GraphicDevice>   graphicDevice
+                           , std::shared_ptr<EngineContext> context
+                           , bool                           runtimeAtlas)
+	: m_graphicDevice(graphicDevice)
+	, m_engineContext(context)
+	, m_runtimeAtlas(runtimeAtlas)
+{
+	m_placeholderTextureId = addTexture(std::make_unique<VulkanTexture>(1, 1, 1, m_graphicDevice));
+	m_assetRegistry = &m_engineContext->m_managerHolder.getManager<AssetRegistry>();
+
+	//-- Cooked atlas always wins, runtime atlas only takes images added after cooking
+	auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	if (m_cookedAtlas.load(vfs))
+	{
+		m_cookedPageTextureIds.resize(m_cookedAtlas.m_pages.size(), C_INVALID_TEXTURE_ID);
+		for (uint32_t i = 0; i < m_cookedAtlas.m_entries.size(); ++i)
+		{
+			m_cookedEntryIndices.insert({ m_cookedAtlas.m_entries[i].m_imagePath, i });
+		}
+		std::println("Cooked atlas: {} images in {} pages", m_cookedAtlas.m_entries.size(), m_cookedAtlas.m_pages.size());
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+VulkanTexture* TextureCache::loadTexture(TextureHandle textureHandle)
+{
+	return texture(textureRegion(textureHandle).m_textureId);
+}
+
+//-------------------------------------------------------------------------------------------------
+TextureRegion TextureCache::textureRegion(TextureHandle textureHandle)
+{
+	const TextureRegion placeholder = { m_placeholderTextureId, C_FULL_UV_RECT };
+	if (textureHandle == C_INVALID_TEXTURE_HANDLE)
+	{
+		return placeholder;
+	}
+
+	if (textureHandle < m_regions.size() && m_regions[textureHandle].m_textureId != C_INVALID_TEXTURE_ID)
+	{
+		return m_regions[textureHandle];
+	}
+	if (textureHandle >= m_regions.size())
+	{
+		m_regions.resize(textureHandle + 1, TextureRegion{ C_INVALID_TEXTURE_ID });
+	}
+
+	const std::string_view texturePath = m_assetRegistry->texturePath(textureHandle);
+
+	//-- Cooked page is streamed as a whole, entry region is cached once the page is resident
+	if (auto it = m_cookedEntryIndices.find(texturePath); it != m_cookedEntryIndices.end())
+	{
+		const AtlasEntry& entry = m_cookedAtlas.m_entries[it->second];
+		uint32_t&         pageTextureId = m_cookedPageTextureIds[entry.m_page];
+		if (pageTextureId == C_INVALID_TEXTURE_ID)
+		{
+			requestImage(m_cookedAtlas.m_pages[entry.m_page], C_INVALID_TEXTURE_HANDLE, entry.m_page);
+			pageTextureId = C_PENDING_TEXTURE_ID;
+		}
+		if (pageTextureId == C_PENDING_TEXTURE_ID)
+		{
+			return placeholder;
+		}
+
+		const TextureRegion region = {
+			pageTextureId
+			, atlasUvRect(entry.m_x, entry.m_y, entry.m_width, entry.m_height, m_cookedAtlas.m_pageSize)
+			, entry.m_alphaMode
+		};
+		m_regions[textureHandle] = region;
+		return region;
+	}
+
+	//-- Placeholder is cached as well, so the image is requested only once
+	requestImage(texturePath, textureHandle, C_NO_COOKED_PAGE);
+	m_regions[textureHandle] = placeholder;
+
+	return placeholder;
+}
+
+//-------------------------------------------------------------------------------------------------
+TextureStreamingChanges TextureCache::update()
+{
+	TextureStreamingChanges changes;
+	for (auto& request : m_pendingRequests)
+	{
+		const TextureLoadState state = request->m_state.load(std::memory_order_acquire);
+		if (state == TextureLoadState::Decoded)
+		{
+			uploadDecoded(*request);
+		}
+		else if (state == TextureLoadState::Uploading && m_graphicDevice->isUploadComplete(request->m_uploadTicket))
+		{
+			makeResident(*request);
+			changes.m_regionsChanged = true;
+		}
+		else if (state == TextureLoadState::Failed)
+		{
+			//-- Sprites keep placeholder, failed image isn't requested again
+			std::println("Texture streaming: failed to load '{}'", request->m_path);
+			changes.m_regionsChanged = true;
+		}
+	}
+
+	std::erase_if(m_pendingRequests, [](const auto& request)
+		{
+			const TextureLoadState state = request->m_state.load(std::memory_order_relaxed);
+			return state == TextureLoadState::Resident || state == TextureLoadState::Failed;
+		});
+
+	//-- Pending loads report growing latency
+	changes.m_loadsChanged = changes.m_regionsChanged || !m_pendingRequests.empty();
+	return changes;
+}
+
+//-------------------------------------------------------------------------------------------------
+void TextureCache::requestImage(std::string_view texturePath, TextureHandle textureHandle, uint32_t cookedPage)
+{
+	auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
+	auto& threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+
+	auto request = std::make_shared<TextureStreamRequest>();
+	request->m_path = texturePath;
+	request->m_textureHandle = textureHandle;
+	request->m_cookedPage = cookedPage;
+	request->m_requestTime = std::chrono::steady_clock::now();
+	m_streamRequests.push_back(request);
+	m_pendingRequests.push_back(request);
+
+	//-- Formats are resolved here, worker must not touch the device
+	std::array<bool, static_cast<size_t>(TextureFormat::Count)> supportedFormats = {};
+	for (size_t format = 0; format < supportedFormats.size(); ++format)
+	{
+		supportedFormats[format] = m_graphicDevice->supportsTextureFormat(static_cast<TextureFormat>(format));
+	}
+
+	//-- Existence check is part of decoding, missing file just fails the request
+	threadPool.submit([request
+			, supportedFormats
+			, runtimeAtlas = m_runtimeAtlas
+			, cookedPageMips = m_cookedAtlas.m_mipLevels
+			, nativePath = vfs.virtualToNativePath(texturePath).string()
+			, cookedPath = vfs.virtualToNativePath(cookedTexturePath(texturePath))]()
+		{
+			request->m_state.store(TextureLoadState::Decoding, std::memory_order_relaxed);
+
+			std::optional<TextureData> texture = loadTextureContainer(cookedPath);
+			if (texture && !supportedFormats[static_cast<size_t>(texture->m_format)])
+			{
+				texture.reset();
+			}
+
+			if (!texture)
+			{
+				if (std::optional<ImageData> image = tryLoadImageData(nativePath))
+				{
+					//-- Image going into runtime atlas is extruded to its page cell here, so page
+					//-- levels are filtered off the main thread as well
+					const bool fitsAtlas = image->m_width <= TextureAtlasConfig::C_MAX_ATLAS_IMAGE_SIZE
+						&& image->m_height <= TextureAtlasConfig::C_MAX_ATLAS_IMAGE_SIZE;
+					if (request->m_cookedPage != C_NO_COOKED_PAGE)
+					{
+						texture = makeTextureData(std::move(*image), cookedPageMips);
+					}
+					else if (runtimeAtlas && fitsAtlas)
+					{
+						texture = makeTextureData(makeAtlasCell(*image), TextureAtlasConfig::C_MIP_LEVELS);
+						request->m_atlasCell = true;
+						request->m_cellImageWidth = image->m_width;
+						request->m_cellImageHeight = image->m_height;
+					}
+					else
+					{
+						texture = makeTextureData(std::move(*image), C_FULL_MIP_CHAIN);
+					}
+				}
+			}
+
+			if (texture)
+			{
+				request->m_texture = std::move(*texture);
+			}
+			//-- Release pairs with acquire in update, pixels are visible once state is seen
+			request->m_state.store(texture ? TextureLoadState::Decoded : TextureLoadState::Failed, std::memory_order_release);
+		});
+}
+
+//-------------------------------------------------------------------------------------------------
+void TextureCache::uploadDecoded(TextureStreamRequest& request)
+{
+	TextureData     texture = std::move(request.m_texture);
+	const AlphaMode alphaMode = texture.m_alphaMode;
+	request.m_width = request.m_atlasCell ? request.m_cellImageWidth : texture.width();
+	request.m_height = request.m_atlasCell ? request.m_cellImageHeight : texture.height();
+
+	//-- Cooked containers stay standalone, only cells prepared by decoding go to pages
+	if (request.m_atlasCell)
+	{
+		request.m_region = addToRuntimeAtlas(texture, request.m_width, request.m_height);
+	}
+	else
+	{
+		request.m_region = { addTexture(std::make_unique<VulkanTexture>(std::move(texture), m_graphicDevice)), C_FULL_UV_RECT };
+	}
+	//-- Cooked page mode is unused, its entries carry own modes
+	request.m_region.m_alphaMode = alphaMode;
+
+	request.m_uploadTicket = m_textures[request.m_region.m_textureId]->uploadTicket();
+	request.m_state.store(TextureLoadState::Uploading, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+void TextureCache::makeResident(TextureStreamRequest& request)
+{
+	if (request.m_cookedPage != C_NO_COOKED_PAGE)
+	{
+		m_cookedPageTextureIds[request.m_cookedPage] = request.m_region.m_textureId;
+	}
+	else
+	{
+		m_regions[request.m_textureHandle] = request.m_region;
+	}
+
+	const auto latency = std::chrono::steady_clock::now() - request.m_requestTime;
+	request.m_latencyMs = std::chrono::duration<float, std::milli>(latency).count();
+	request.m_state.store(TextureLoadState::Resident, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+void TextureCache::publishLoads(std::vector<TextureLoadInfo>& textureLoads) const
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	textureLoads.clear();
+	textureLoads.reserve(m_streamRequests.size());
+	for (const auto& request : m_streamRequests)
+	{
+		const TextureLoadState state = request->m_state.load(std::memory_order_relaxed);
+		const bool             finished = state == TextureLoadState::Resident || state == TextureLoadState::Failed;
+		const float            latencyMs = finished
+			? request->m_latencyMs
+			: std::chrono::duration<float, std::milli>(now - request->m_requestTime).count();
+
+		textureLoads.push_back({
+			.m_path = request->m_path
+			, .m_state = state
+			, .m_width = request->m_width
+			, .m_height = request->m_height
+			, .m_latencyMs = latencyMs
+		});
+	}
+}
 
 //-------------------------------------------------------------------------------------------------
-VulkanTexture* TextureCache::loadTexture(std::string_view texturePath)
+TextureRegion TextureCache::addToRuntimeAtlas(const TextureData& cell, uint32_t width, uint32_t height)
 {
-    if (m_texturesMap.count(texturePath))
-    {
-        return m_texturesMap[texturePath].get();
-    }
+	constexpr uint32_t C_PAGE_SIZE = TextureAtlasConfig::C_PAGE_SIZE;
+	constexpr uint32_t C_PADDING = TextureAtlasConfig::C_PADDING;
+
+	//-- First page with free space, new page is opened only when all are full
+	std::optional<AtlasRect> rect;
+	RuntimeAtlasPage*        atlasPage = nullptr;
+	for (auto& page : m_runtimeAtlasPages)
+	{
+		rect = page.m_packer.insert(width, height);
+		if (rect)
+		{
+			atlasPage = &page;
+			break;
+		}
+	}
+
+	if (!atlasPage)
+	{
+		const uint32_t pageTextureId = addTexture(std::make_unique<VulkanTexture>(C_PAGE_SIZE
+			, C_PAGE_SIZE
+			, TextureAtlasConfig::C_MIP_LEVELS
+			, m_graphicDevice));
+		m_runtimeAtlasPages.push_back({
+			pageTextureId
+			, SkylinePacker(C_PAGE_SIZE, C_PAGE_SIZE, C_PADDING, TextureAtlasConfig::C_CELL_ALIGNMENT)
+		});
+		atlasPage = &m_runtimeAtlasPages.back();
+		rect = atlasPage->m_packer.insert(width, height);
+		engineAssert(rect.has_value(), "Image doesn't fit into empty atlas page");
 
-    auto& vfs = m_engineContext->m_managerHolder.getManager<VirtualFS>();
-    engineAssert(vfs.isFileExist(texturePath), "Texture don't exist");
-    auto full_path = vfs.virtualToNativePath(texturePath);
+		std::println("Runtime atlas: page {} created", m_runtimeAtlasPages.size() - 1);
+	}
+
+	//-- Cell covers the padding packer reserved around the image
+	m_textures[atlasPage->m_textureId]->updateRegion(rect->m_x - C_PADDING, rect->m_y - C_PADDING, cell);
+
+	return {
+		atlasPage->m_textureId
+		, atlasUvRect(rect->m_x, rect->m_y, rect->m_width, rect->m_height, C_PAGE_SIZE)
+	};
+}
 
-    auto res = m_texturesMap.insert({
-        texturePath.data()
-        , std::make_unique<VulkanTexture>(full_path.string(), m_graphicDevice)
-     });
+//-------------------------------------------------------------------------------------------------
+uint32_t TextureCache::addTexture(std::unique_ptr<VulkanTexture> texture)
+{
+	engineAssert(m_textures.size() < SpriteSortKey::C_MAX_TEXTURES, "Texture id doesn't fit into sort key");
 
-    return res.first->second.get();
+	m_textures.push_back(std::move(texture));
+	return static_cast<uint32_t>(m_textures.size() - 1);
 }
 
 //-------------------------------------------------------------------------------------------------
-BatchDrawer::BatchDrawer(std::shared_ptr<VkGraphicDevice> graphicDevice) : m_graphicDevice(graphicDevice)
+BatchDrawer::BatchDrawer(std::shared_ptr<GraphicDevice> graphicDevice, SpriteRenderPath renderPath)
+	: m_graphicDevice(graphicDevice)
+	, m_renderPath(renderPath)
 {
+	m_vertexRingBuffer = std::make_unique<FrameRingBuffer>(m_graphicDevice
+		, vk::BufferUsageFlagBits::eVertexBuffer
+		, C_INITIAL_SPRITE_RING_SIZE);
+
+	m_quadIndexBuffer = m_graphicDevice->createQuadIndexBuffer(C_INITIAL_QUAD_INDEX_CAPACITY);
+	m_quadIndexCapacity = C_INITIAL_QUAD_INDEX_CAPACITY;
+
 	m_vertexBuffersToFrames.resize(m_graphicDevice->maxFrames());
-	m_indexBuffersToFrames.resize(m_graphicDevice->maxFrames());
 }
 
 //-------------------------------------------------------------------------------------------------
 BatchDrawer::~BatchDrawer()
 {
-	for (uint32_t i = 0; i < m_graphicDevice->maxFrames(); ++i)
+	for (RetainedBuffer& retainedBuffer : m_retainedBuffers)
+	{
+		if (retainedBuffer.m_memory.m_buffer)
+		{
+			m_graphicDevice->clearBuffer(retainedBuffer.m_memory);
+		}
+	}
+	m_graphicDevice->clearBuffer(m_quadIndexBuffer);
+}
+
+//-------------------------------------------------------------------------------------------------
+void BatchDrawer::draw(const SpriteFrameGeometry& spriteFrame)
+{
+	const auto                       currFrameIndex = m_graphicDevice->currFrame();
+	const std::span<const std::byte> geometry = spriteGeometryBytes(spriteFrame, m_renderPath);
+
+	//-- Whole frame goes into one mapped region with a single copy
+	const vk::DeviceSize frameSize = geometry.size();
+	m_vertexRingBuffer->beginFrame(currFrameIndex, frameSize);
+	FrameAllocation frameAllocation = m_vertexRingBuffer->allocate(frameSize, alignof(SpriteInstanceData));
+	if (frameSize > 0)
+	{
+		memcpy(frameAllocation.m_data, geometry.data(), frameSize);
+	}
+
+	submitBatches(spriteFrame, frameAllocation.m_buffer, frameAllocation.m_offset);
+}
+
+//-------------------------------------------------------------------------------------------------
+void BatchDrawer::drawRetained(const SpriteFrameGeometry& spriteFrame, const std::vector<uint32_t>& patchedSprites, bool rebuilt)
+{
+	if (m_retainedBuffers.empty())
 	{
-		clearBuffers(static_cast<uint8_t>(i));
+		m_retainedBuffers.resize(m_graphicDevice->maxFrames());
 	}
+
+	const std::span<const std::byte> geometry = spriteGeometryBytes(spriteFrame, m_renderPath);
+	const vk::DeviceSize             stride = spriteStride();
+	const size_t                     spritesCount = geometry.size() / stride;
+
+	//-- Buffers of other frames may still be read by GPU, they catch up when their frame comes.
+	//-- Once patches outnumber sprites the whole copy is cheaper
+	for (RetainedBuffer& retainedBuffer : m_retainedBuffers)
+	{
+		if (!rebuilt && !retainedBuffer.m_stale && retainedBuffer.m_pendingSprites.size() + patchedSprites.size() <= spritesCount)
+		{
+			retainedBuffer.m_pendingSprites.insert(retainedBuffer.m_pendingSprites.end(), patchedSprites.begin(), patchedSprites.end());
+			continue;
+		}
+		retainedBuffer.m_stale = true;
+		retainedBuffer.m_pendingSprites.clear();
+	}
+
+	//-- Frame fence is already waited so GPU doesn't read this buffer anymore
+	RetainedBuffer& retainedBuffer = m_retainedBuffers[m_graphicDevice->currFrame()];
+	if (geometry.size() > retainedBuffer.m_capacity || retainedBuffer.m_relocating)
+	{
+		vk::DeviceSize newCapacity = std::max(retainedBuffer.m_capacity, C_INITIAL_SPRITE_RING_SIZE);
+		while (newCapacity < geometry.size())
+		{
+			newCapacity *= 2;
+		}
+
+		if (retainedBuffer.m_memory.m_buffer)
+		{
+			m_graphicDevice->clearBuffer(retainedBuffer.m_memory);
+		}
+		retainedBuffer.m_memory = m_graphicDevice->createBuffer(newCapacity
+			, vk::BufferUsageFlagBits::eVertexBuffer
+			, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			, GpuAllocationStrategy::Buddy
+			, this);
+		retainedBuffer.m_capacity = newCapacity;
+		retainedBuffer.m_stale = true;
+		retainedBuffer.m_relocating = false;
+	}
+
+	std::byte* mapped = static_cast<std::byte*>(retainedBuffer.m_memory.m_allocation.m_mapped);
+	if (retainedBuffer.m_stale && !geometry.empty())
+	{
+		memcpy(mapped, geometry.data(), geometry.size());
+	}
+	else if (!retainedBuffer.m_stale)
+	{
+		for (const uint32_t drawPosition : retainedBuffer.m_pendingSprites)
+		{
+			memcpy(mapped + drawPosition * stride, geometry.data() + drawPosition * stride, stride);
+		}
+	}
+	retainedBuffer.m_pendingSprites.clear();
+	retainedBuffer.m_stale = false;
+
+	submitBatches(spriteFrame, retainedBuffer.m_memory.m_buffer, 0);
 }
 
 //-------------------------------------------------------------------------------------------------
-void BatchDrawer::draw(const std::vector<TexuredSpriteBatch>& spriteBatches)
+void BatchDrawer::relocate(const GpuAllocation& allocation)
 {
-	const auto currFrameIndex = m_graphicDevice->currFrame();
+	for (RetainedBuffer& retainedBuffer : m_retainedBuffers)
+	{
+		const GpuAllocation& current = retainedBuffer.m_memory.m_allocation;
+		if (current.m_memory == allocation.m_memory && current.m_offset == allocation.m_offset)
+		{
+			retainedBuffer.m_relocating = true;
+		}
+	}
+}
 
-	clearBuffers(currFrameIndex);
+//-------------------------------------------------------------------------------------------------
+void BatchDrawer::submitBatches(const SpriteFrameGeometry& spriteFrame, vk::Buffer buffer, vk::DeviceSize offset)
+{
+	const auto           currFrameIndex = m_graphicDevice->currFrame();
+	const vk::DeviceSize stride = spriteStride();
 
 	//-- Getting batches for current frame
 	auto& currentTexturedGeometryBatch = m_vertexBuffersToFrames[currFrameIndex];
-	auto& currentIndexBatch = m_indexBuffersToFrames[currFrameIndex];
-
-	currentTexturedGeometryBatch.reserve(spriteBatches.size());
-	currentIndexBatch.reserve(spriteBatches.size());
+	currentTexturedGeometryBatch.clear();
+	currentTexturedGeometryBatch.reserve(spriteFrame.m_batches.size());
 
-	//-- Transform geometry data into vulkan inner buffers format and preparing indecies for that
-	for (auto& batch : spriteBatches)
+	uint32_t maxBatchSprites = 0;
+	for (auto& batch : spriteFrame.m_batches)
 	{
 		TexturedGeometry texturedGeometry = {
-			.m_memory = m_graphicDevice->createCombinedVertexBuffer(batch.m_geometryBatch)
-			, .m_textureDescriptorSet = batch.m_texture->getDescriptorSet()
+			.m_vertexBuffer = buffer
+			, .m_vertexOffset = offset + batch.m_firstSprite * stride
+			, .m_textureDescriptorSet = batch.m_texture ? batch.m_texture->getDescriptorSet() : VK_NULL_HANDLE
 			, .m_spritesCount = batch.m_spritesCount
+			, .m_pass = batch.m_pass
 		};
 
 		currentTexturedGeometryBatch.emplace_back(std::move(texturedGeometry));
-		currentIndexBatch.push_back(m_graphicDevice->createIndexBuffer(batch.m_spritesCount));
+		maxBatchSprites = std::max(maxBatchSprites, batch.m_spritesCount);
+	}
+
+	//-- Instanced path doesn't read indices at all
+	if (m_renderPath != SpriteRenderPath::Instanced)
+	{
+		ensureQuadIndexCapacity(maxBatchSprites);
 	}
 
 	//-- Drawind self processed here
-	m_graphicDevice->endFrame(currentTexturedGeometryBatch, currentIndexBatch);
+	m_graphicDevice->endFrame(currentTexturedGeometryBatch, m_quadIndexBuffer.m_buffer);
 }
 
 //-------------------------------------------------------------------------------------------------
-void BatchDrawer::clearBuffers(uint8_t frameIndex)
+void BatchDrawer::ensureQuadIndexCapacity(uint32_t spritesCount)
 {
-	auto& currentTexturedGeometryBatch = m_vertexBuffersToFrames[frameIndex];
-	auto& currentIndexBatch = m_indexBuffersToFrames[frameIndex];
-
-	for (auto& batch : currentTexturedGeometryBatch)
+	if (spritesCount <= m_quadIndexCapacity)
 	{
-		if (batch.m_memory.m_buffer != VK_NULL_HANDLE)
-		{
-			m_graphicDevice->clearBuffer(batch.m_memory);
-		}
+		return;
 	}
-	for (auto& indexBatch : currentIndexBatch)
+
+	uint32_t newCapacity = m_quadIndexCapacity;
+	while (newCapacity < spritesCount)
 	{
-		if (indexBatch.m_buffer != VK_NULL_HANDLE)
-		{
-			m_graphicDevice->clearBuffer(indexBatch);
-		}
+		newCapacity *= 2;
 	}
 
-	currentTexturedGeometryBatch.clear();
-	currentIndexBatch.clear();
+	//-- Rare case, frames in flight still read old indices so wait them before replacing
+	m_graphicDevice->waitGraphicIdle();
+	m_graphicDevice->clearBuffer(m_quadIndexBuffer);
+
+	m_quadIndexBuffer = m_graphicDevice->createQuadIndexBuffer(newCapacity);
+	m_quadIndexCapacity = newCapacity;
+}
+
+//-------------------------------------------------------------------------------------------------
+vk::DeviceSize BatchDrawer::spriteStride() const
+{
+	return m_renderPath == SpriteRenderPath::Instanced
+		? sizeof(SpriteInstanceData)
+		: sizeof(std::array<VertexData, 4>);
 }
 
 //-------------------------------------------------------------------------------------------------
-RendererSystem::RendererSystem(std::shared_ptr<EngineContext> context)
+RendererSystem::RendererSystem(std::shared_ptr<EngineContext> context, RendererConfig config)
 	: m_engineContext(context)
+	, m_config(config)
 {
-	m_device = std::make_shared<VkGraphicDevice>(context);
-	m_device->init(m_engineContext->m_managerHolder.getManager<WindowManager>().window());
-	m_texureCache = std::make_unique<TextureCache>(m_device, context);
-	m_batchDrawer = std::make_unique<BatchDrawer>(m_device);
+	GLFWwindow* window = m_engineContext->m_managerHolder.getManager<WindowManager>().window();
+
+	m_device = makeGraphicDevice(context, m_config);
+	//-- Swapchain may be sized by window, so camera goes first
+	m_device->setCamera(makeRenderCamera(window, m_config));
+	m_device->init(window);
+	m_texureCache = std::make_unique<TextureCache>(m_device, context, m_config.m_runtimeAtlas);
+	m_batchDrawer = std::make_unique<BatchDrawer>(m_device, m_config.m_spriteRenderPath);
+	//-- Scenes are created after renderer and pick the mode up
+	m_engineContext->m_managerHolder.getManager<RendererManager>().m_retainedSprites = m_config.m_retainedSprites;
+
+	if (m_config.m_renderThread)
+	{
+		m_packets = std::make_unique<BoundedQueue<RenderPacket>>(m_config.m_renderLatencyFrames);
+		m_renderThread = std::jthread([this]() { renderLoop(); });
+		std::println("Render thread started, main thread runs up to {} frames ahead", m_packets->capacity());
+	}
 }
 
 //-------------------------------------------------------------------------------------------------
 RendererSystem::~RendererSystem()
 {
+	//-- Packets already queued are rendered before the thread exits
+	if (m_renderThread.joinable())
+	{
+		m_packets->close();
+		m_renderThread.join();
+	}
+
 	m_device->waitGraphicIdle();
+	if (!m_config.m_readbackPath.empty())
+	{
+		writeReadback();
+	}
 	m_batchDrawer.reset();
+	m_retiredPackets.clear();
 }
 
 //-------------------------------------------------------------------------------------------------
 void RendererSystem::update(float dt)
 {
-	beginFrame(dt);
-	endFrame();
+	RenderPacket packet = makePacket(dt);
+
+	if (m_renderThread.joinable())
+	{
+		submitToRenderThread(std::move(packet));
+		return;
+	}
+
+	renderPacket(packet);
+	applyFrameOutputs(m_frameOutputs);
+	if (ImGuiIntegration* imGui = m_device->imGui())
+	{
+		imGui->renderPlatformWindows();
+	}
+	retirePacket(std::move(packet));
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -146,86 +698,446 @@ void RendererSystem::onEvent(Event& event)
 }
 
 //-------------------------------------------------------------------------------------------------
-void RendererSystem::beginFrame(float dt)
+RenderPacket RendererSystem::makePacket(float dt)
+{
+	auto& rendererManager = m_engineContext->m_managerHolder.getManager<RendererManager>();
+	auto& windowManager = m_engineContext->m_managerHolder.getManager<WindowManager>();
+
+	RenderPacket packet;
+	{
+		std::lock_guard lock(m_retiredMutex);
+		if (!m_retiredPackets.empty())
+		{
+			packet = std::move(m_retiredPackets.back());
+			m_retiredPackets.pop_back();
+		}
+	}
+	packet.m_imGuiSnapshot.reset();
+	packet.m_sprites.clear();
+	packet.m_spriteSlots.clear();
+	packet.m_removedSpriteSlots.clear();
+
+	packet.m_frameIndex = m_frameIndex++;
+	packet.m_dt = dt;
+	//-- Cleared storage of retired packet is handed back for the next frame sprites
+	packet.m_sprites.swap(rendererManager.m_sprites);
+	packet.m_spriteSlots.swap(rendererManager.m_spriteSlots);
+	packet.m_removedSpriteSlots.swap(rendererManager.m_removedSpriteSlots);
+	packet.m_camera = makeRenderCamera(windowManager.window(), m_config);
+	//-- UI callbacks run here and may change the scene, so ImGui frame is always built on main thread
+	if (ImGuiIntegration* imGui = m_device->imGui())
+	{
+		packet.m_imGuiDrawData = imGui->buildFrame(rendererManager.m_imGuiUpdatesUi);
+	}
+	rendererManager.m_imGuiUpdatesUi.clear();
+
+	return packet;
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::submitToRenderThread(RenderPacket packet)
+{
+	//-- Next NewFrame reuses ImGui draw lists, render thread gets its own copy
+	if (ImGuiIntegration* imGui = m_device->imGui())
+	{
+		{
+			//-- Queued packets, the one being recorded and frames in flight on GPU
+			const uint32_t framesBehind = m_config.m_renderLatencyFrames + 1 + m_device->maxFrames();
+			std::lock_guard queueLock(m_device->graphicQueueMutex());
+			imGui->updateTextures(framesBehind);
+		}
+		packet.m_imGuiSnapshot = std::make_unique<ImGuiDrawSnapshot>(packet.m_imGuiDrawData);
+		packet.m_imGuiDrawData = packet.m_imGuiSnapshot->drawData();
+		{
+			std::lock_guard queueLock(m_device->graphicQueueMutex());
+			imGui->renderPlatformWindows();
+		}
+	}
+
+	{
+		std::lock_guard lock(m_outputsMutex);
+		applyFrameOutputs(m_publishedOutputs);
+	}
+
+	//-- Blocks while render thread is the latency bound behind
+	m_packets->push(std::move(packet));
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::applyFrameOutputs(FrameOutputs& outputs)
 {
-	m_device->beginFrame(dt);
+	auto& rendererManager = m_engineContext->m_managerHolder.getManager<RendererManager>();
+
+	rendererManager.m_stats = outputs.m_stats;
+	if (outputs.m_textureLoadsChanged)
+	{
+		rendererManager.m_textureLoads = std::move(outputs.m_textureLoads);
+		outputs.m_textureLoadsChanged = false;
+	}
 }
 
 //-------------------------------------------------------------------------------------------------
-void RendererSystem::endFrame()
+void RendererSystem::renderLoop()
 {
-	const auto currFrameIndex = m_device->currFrame();
+	while (std::optional<RenderPacket> packet = m_packets->pop())
+	{
+		renderPacket(*packet);
 
-	batchSprites();
-	//-- Batch drawer will call device drawing
-	auto& drawListImGuiUI = m_engineContext->m_managerHolder.getManager<RendererManager>().m_imGuiUpdatesUi;
-	m_device->setImGuiDrawCallbacks(drawListImGuiUI);
-	m_batchDrawer->draw(m_batchedByTextureSprites);
-	m_engineContext->m_managerHolder.getManager<RendererManager>().m_imGuiUpdatesUi.clear();
+		{
+			std::lock_guard lock(m_outputsMutex);
+			m_publishedOutputs.m_stats = m_frameOutputs.m_stats;
+			if (m_frameOutputs.m_textureLoadsChanged)
+			{
+				m_publishedOutputs.m_textureLoads = std::move(m_frameOutputs.m_textureLoads);
+				m_publishedOutputs.m_textureLoadsChanged = true;
+				m_frameOutputs.m_textureLoadsChanged = false;
+			}
+		}
+
+		retirePacket(std::move(*packet));
+	}
+}
 
-	//-- Clear collections, for now rendering has no any caches
-	m_batchedByTextureSprites.clear();
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::renderPacket(const RenderPacket& packet)
+{
+	m_device->setCamera(packet.m_camera);
+	m_device->beginFrame(packet.m_dt);
+
+	const TextureStreamingChanges streamingChanges = m_texureCache->update();
+	if (streamingChanges.m_loadsChanged)
+	{
+		m_texureCache->publishLoads(m_frameOutputs.m_textureLoads);
+		m_frameOutputs.m_textureLoadsChanged = true;
+	}
+	if (m_config.m_retainedSprites)
+	{
+		batchRetainedSprites(packet, streamingChanges.m_regionsChanged);
+	}
+	else
+	{
+		batchSprites(packet.m_sprites, packet.m_camera);
+	}
+	updateDeviceStats();
+	//-- Batch drawer will call device drawing
+	m_device->setImGuiDrawData(packet.m_imGuiDrawData);
+	if (m_config.m_retainedSprites)
+	{
+		m_batchDrawer->drawRetained(m_spriteFrame, m_retainedSprites.m_patchedSprites, m_retainedSprites.m_rebuilt);
+	}
+	else
+	{
+		m_batchDrawer->draw(m_spriteFrame);
+	}
+	m_device->setImGuiDrawData(nullptr);
+}
 
-	m_engineContext->m_managerHolder.getManager<RendererManager>().m_sprites.clear();
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::retirePacket(RenderPacket packet)
+{
+	std::lock_guard lock(m_retiredMutex);
+	m_retiredPackets.push_back(std::move(packet));
 }
 
 //-------------------------------------------------------------------------------------------------
-void RendererSystem::batchSprites()
+void RendererSystem::writeReadback()
 {
-	auto& sprites = m_engineContext->m_managerHolder.getManager<RendererManager>().m_sprites;
-	if (sprites.empty())
+	const std::optional<ImageData> frame = m_device->readbackLastFrame();
+	if (!frame)
 	{
+		std::println("No headless frame to read back into '{}'", m_config.m_readbackPath);
 		return;
 	}
+	//-- Native path, it's an output of benchmark or CI run rather than project data
+	writeImageTga(*frame, m_config.m_readbackPath);
+	std::println("Last frame {}x{} written to '{}'", frame->m_width, frame->m_height, m_config.m_readbackPath);
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::updateDeviceStats()
+{
+	auto&                stats = m_frameOutputs.m_stats;
+	const GpuMemoryStats memoryStats = m_device->memoryStats();
+
+	stats.m_gpuMemoryBlocks = memoryStats.m_blocksCount + memoryStats.m_dedicatedBlocksCount;
+	stats.m_gpuAllocations = memoryStats.m_allocationsCount;
+	stats.m_gpuMemoryUsed = memoryStats.m_usedBytes;
+	stats.m_gpuMemoryReserved = memoryStats.m_reservedBytes;
+
+	const CommandRecordingStats& recordingStats = m_device->recordingStats();
+	stats.m_recordingMs = recordingStats.m_recordingMs;
+	stats.m_recordedBatches = recordingStats.m_batchesCount;
+	stats.m_recordingTasks = recordingStats.m_tasksCount;
+
+	const OverdrawStats& overdrawStats = m_device->overdrawStats();
+	stats.m_overdrawMeasured = overdrawStats.m_measured;
+	stats.m_fragmentInvocations = overdrawStats.m_fragmentInvocations;
+	stats.m_overdraw = overdrawStats.m_overdraw;
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::batchSprites(const SpriteDrawList& sprites, const RenderCamera& camera)
+{
+	auto& threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+
+	const auto batchingStart = std::chrono::steady_clock::now();
+	m_frameOutputs.m_stats = {};
+	m_frameOutputs.m_stats.m_spritesCount = sprites.size();
+
+	//-- Invisible sprites are neither transformed nor uploaded, their textures aren't requested
+	if (m_config.m_frustumCulling)
+	{
+		m_spriteCuller.cull(sprites, camera.m_proj * camera.m_view, m_visibleSprites, threadPool);
+	}
+	else
+	{
+		m_visibleSprites.resize(sprites.size());
+		std::iota(m_visibleSprites.begin(), m_visibleSprites.end(), 0u);
+	}
+
+	buildBatches(sprites);
+	m_frameOutputs.m_stats.m_batchingMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - batchingStart).count();
+}
 
-	//-- Group by textures
-	std::sort(sprites.begin()
-		, sprites.end()
-		, [](const auto& lhs, const auto& rhs)
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::batchRetainedSprites(const RenderPacket& packet, bool regionsChanged)
+{
+	auto&            threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+	RetainedSprites& retained = m_retainedSprites;
+	const auto       batchingStart = std::chrono::steady_clock::now();
+
+	//-- Resident textures may change regions and passes of any sprite. Sprite removed in the
+	//-- same frame it was added never reached renderer, its slot may be unknown yet
+	bool orderChanged = regionsChanged;
+	for (const uint32_t slot : packet.m_removedSpriteSlots)
+	{
+		if (slot < retained.m_alive.size() && retained.m_alive[slot])
 		{
-			return lhs.m_position.z < rhs.m_position.z;
-		});
+			retained.m_alive[slot] = 0;
+			orderChanged = true;
+		}
+	}
+
+	const uint32_t slotsCount = packet.m_spriteSlots.empty() ? 0 : std::ranges::max(packet.m_spriteSlots) + 1;
+	if (slotsCount > retained.m_sprites.size())
+	{
+		retained.m_sprites.append(slotsCount - retained.m_sprites.size());
+		retained.m_alive.resize(slotsCount, 0);
+		retained.m_drawPositions.resize(slotsCount);
+	}
 
-	auto batches = sprites | std::views::chunk_by([](const auto& lhs, const auto& rhs)
+	//-- Changed sprite keeps its place while its sort key stays the same. Texture isn't
+	//-- requested here, unresolved one changes the order and is resolved while rebuilding it
+	retained.m_patchedSprites.clear();
+	for (uint32_t i = 0; i < packet.m_sprites.size(); ++i)
+	{
+		const uint32_t slot = packet.m_spriteSlots[i];
+		retained.m_sprites.set(slot, packet.m_sprites.sprite(i));
+		if (!retained.m_alive[slot])
 		{
-			return lhs.m_texturePath == rhs.m_texturePath;
-		});
+			retained.m_alive[slot] = 1;
+			orderChanged = true;
+		}
+		if (orderChanged)
+		{
+			continue;
+		}
+
+		const uint32_t       drawPosition = retained.m_drawPositions[slot];
+		const TextureRegion* region = m_texureCache->resolvedRegion(retained.m_sprites.m_textures[slot]);
+		if (!region || spriteSortKey(retained.m_sprites, slot, *region) != m_sortItems[drawPosition].m_key)
+		{
+			orderChanged = true;
+			continue;
+		}
+		m_spriteRegions[slot] = *region;
+		retained.m_patchedSprites.push_back(drawPosition);
+	}
+
+	retained.m_rebuilt = orderChanged;
+	if (orderChanged)
+	{
+		m_visibleSprites.clear();
+		for (uint32_t slot = 0; slot < retained.m_sprites.size(); ++slot)
+		{
+			if (retained.m_alive[slot])
+			{
+				m_visibleSprites.push_back(slot);
+			}
+		}
 
-	//-- Create batches
-	for (const auto& batch : batches)
+		m_frameOutputs.m_stats = {};
+		m_frameOutputs.m_stats.m_spritesCount = static_cast<uint32_t>(m_visibleSprites.size());
+		buildBatches(retained.m_sprites);
+		for (uint32_t i = 0; i < m_visibleSprites.size(); ++i)
+		{
+			retained.m_drawPositions[m_sortItems[i].m_index] = i;
+		}
+	}
+	else
 	{
-		//-- Texture path from the first element of group
-		const std::string& texturePath = batch.front().m_texturePath;
-		VulkanTexture* texture = m_texureCache->loadTexture(texturePath);
+		threadPool.parallelFor(static_cast<uint32_t>(retained.m_patchedSprites.size()), C_MIN_SPRITES_PER_TASK, [&](uint32_t, uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++i)
+				{
+					const uint32_t drawPosition = retained.m_patchedSprites[i];
+					writeSpriteGeometry(retained.m_sprites, m_sortItems[drawPosition].m_index, drawPosition);
+				}
+			});
+	}
+	m_frameOutputs.m_stats.m_batchingMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - batchingStart).count();
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::buildBatches(const SpriteDrawList& sprites)
+{
+	auto& threadPool = m_engineContext->m_managerHolder.getManager<ThreadPool>();
+
+	const uint32_t visibleCount = static_cast<uint32_t>(m_visibleSprites.size());
+	m_frameOutputs.m_stats.m_visibleSpritesCount = visibleCount;
 
-		//-- Gather all vertices
-		std::vector<std::array<VertexData, 4>> batchedVertices;
-		batchedVertices.reserve(std::distance(batch.begin(), batch.end()));
+	const bool instanced = m_config.m_spriteRenderPath == SpriteRenderPath::Instanced;
+	const bool bindless = m_device->bindlessTextures();
+	m_spriteFrame.clear();
+	m_spriteFrame.m_instances.resize(instanced ? visibleCount : 0);
+	m_spriteFrame.m_vertices.resize(instanced ? 0 : visibleCount);
+	if (visibleCount == 0)
+	{
+		return;
+	}
 
-		//-- Prepare sprite in batch
-		for (const auto& sprite : batch)
+	//-- Only small key + index pairs are sorted, sprites are gathered by index.
+	//-- Atlas regions are resolved once here and reused while gathering
+	auto sortItem = [&](uint32_t spriteIndex, SpriteRangeTally& tally)
 		{
-			//-- TODO: Move this to component method
-			glm::mat4 transform = { 1.0f };
-			transform = glm::translate(transform, sprite.m_position);
-			std::array<VertexData, 4> transformedData = {};
+			const uint64_t   key = spriteSortKey(sprites, spriteIndex, m_spriteRegions[spriteIndex]);
+			const SpritePass pass = static_cast<SpritePass>(SpriteSortKey::pipeline(key));
+
+			tally.m_opaqueCount += pass == SpritePass::Opaque ? 1 : 0;
+			tally.m_cutoutCount += pass == SpritePass::Cutout ? 1 : 0;
+			return RadixSortItem{ key, spriteIndex };
+		};
 
-			//-- Here we transfrom from local to world coordinates
-			for (int i = 0; i < 4; ++i)
+	//-- Ranges only read texture cache. Sprites with textures it hasn't resolved yet are
+	//-- left to this thread, which may request them
+	m_sortItems.resize(visibleCount);
+	m_spriteRegions.resize(sprites.size());
+	m_rangeTallies.resize(threadPool.rangesCount(visibleCount, C_MIN_SPRITES_PER_TASK));
+	threadPool.parallelFor(visibleCount, C_MIN_SPRITES_PER_TASK, [&](uint32_t range, uint32_t first, uint32_t last)
+		{
+			SpriteRangeTally& tally = m_rangeTallies[range];
+			tally.m_opaqueCount = 0;
+			tally.m_cutoutCount = 0;
+			tally.m_unresolved.clear();
+			for (uint32_t visible = first; visible < last; ++visible)
 			{
-				transformedData[i].m_color = C_QUAD_BASIC_DATA[i].m_color;
-				transformedData[i].m_texCoord = C_QUAD_BASIC_DATA[i].m_texCoord;
-				transformedData[i].m_vertex = transform * C_QUAD_BASIC_DATA[i].m_vertex;
+				const uint32_t i = m_visibleSprites[visible];
+				if (const TextureRegion* region = m_texureCache->resolvedRegion(sprites.m_textures[i]))
+				{
+					m_spriteRegions[i] = *region;
+					m_sortItems[visible] = sortItem(i, tally);
+				}
+				else
+				{
+					tally.m_unresolved.push_back(visible);
+				}
 			}
-			batchedVertices.push_back(std::move(transformedData));
+		});
+
+	for (SpriteRangeTally& tally : m_rangeTallies)
+	{
+		for (const uint32_t visible : tally.m_unresolved)
+		{
+			const uint32_t i = m_visibleSprites[visible];
+			m_spriteRegions[i] = m_texureCache->textureRegion(sprites.m_textures[i]);
+			m_sortItems[visible] = sortItem(i, tally);
 		}
+		m_frameOutputs.m_stats.m_opaqueSpritesCount += tally.m_opaqueCount;
+		m_frameOutputs.m_stats.m_cutoutSpritesCount += tally.m_cutoutCount;
+	}
+	parallelRadixSort(m_sortItems, m_sortScratch, m_sortHistograms, threadPool, C_MIN_SPRITES_PER_TASK);
 
-		//-- Finally - we got the batch
+	//-- Create batches, new one starts whenever state part of the key changes.
+	//-- Only keys are read here, geometry is generated by ranges below
+	uint64_t currentBatchState = SpriteSortKey::batchState(m_sortItems.front().m_key, bindless);
+	uint32_t batchFirstSprite = 0;
+	auto     closeBatch = [&](uint32_t endSprite)
+	{
 		TexuredSpriteBatch spriteBatch = {
-			std::move(batchedVertices)
-			, texture
-			, static_cast<uint32_t>(batch.size())
+			bindless ? nullptr : m_texureCache->texture(SpriteSortKey::texture(currentBatchState))
+			, batchFirstSprite
+			, endSprite - batchFirstSprite
+			, static_cast<SpritePass>(SpriteSortKey::pipeline(currentBatchState))
 		};
-		m_batchedByTextureSprites.emplace_back(std::move(spriteBatch));
+		m_spriteFrame.m_batches.push_back(spriteBatch);
+		batchFirstSprite = endSprite;
+	};
+
+	for (uint32_t i = 0; i < visibleCount; ++i)
+	{
+		if (const uint64_t batchState = SpriteSortKey::batchState(m_sortItems[i].m_key, bindless); batchState != currentBatchState)
+		{
+			closeBatch(i);
+			currentBatchState = batchState;
+		}
+	}
+	closeBatch(visibleCount);
+
+	//-- Every sprite has its slot in draw order, ranges write their slots only
+	threadPool.parallelFor(visibleCount, C_MIN_SPRITES_PER_TASK, [&](uint32_t, uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; ++i)
+			{
+				writeSpriteGeometry(sprites, m_sortItems[i].m_index, i);
+			}
+		});
+
+	m_frameOutputs.m_stats.m_drawCalls = static_cast<uint32_t>(m_spriteFrame.m_batches.size());
+	m_frameOutputs.m_stats.m_batchingRanges = static_cast<uint32_t>(m_rangeTallies.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t RendererSystem::spriteSortKey(const SpriteDrawList& sprites, uint32_t spriteIndex, const TextureRegion& region) const
+{
+	const SpritePass pass = spritePass(sprites.m_colors[spriteIndex].a, region);
+	//-- Depth tested passes go front to back, so hidden texels are rejected before shading
+	const float spriteDepth = sprites.m_depths[spriteIndex];
+	const float depth = pass == SpritePass::Translucent ? spriteDepth : -spriteDepth;
+	return SpriteSortKey::make(depth, static_cast<uint32_t>(pass), region.m_textureId, C_DEFAULT_MATERIAL_ID, pass != SpritePass::Translucent);
+}
+
+//-------------------------------------------------------------------------------------------------
+void RendererSystem::writeSpriteGeometry(const SpriteDrawList& sprites, uint32_t spriteIndex, uint32_t drawPosition)
+{
+	const SpriteInfo     sprite = sprites.sprite(spriteIndex);
+	const TextureRegion& region = m_spriteRegions[spriteIndex];
+	const uint32_t       textureIndex = m_device->bindlessTextures()
+		? m_texureCache->texture(region.m_textureId)->getBindlessIndex()
+		: 0;
+	if (m_config.m_spriteRenderPath == SpriteRenderPath::Instanced)
+	{
+		m_spriteFrame.m_instances[drawPosition] = makeSpriteInstance(sprite, region.m_uvRect, textureIndex);
+	}
+	else
+	{
+		m_spriteFrame.m_vertices[drawPosition] = makeSpriteVertices(sprite, region.m_uvRect, textureIndex);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+SpritePass RendererSystem::spritePass(float tintAlpha, const TextureRegion& region) const
+{
+	//-- Tint alpha makes any texture translucent
+	if (!m_config.m_opaquePass || tintAlpha < 1.0f)
+	{
+		return SpritePass::Translucent;
+	}
+
+	switch (region.m_alphaMode)
+	{
+	case AlphaMode::Opaque: return SpritePass::Opaque;
+	case AlphaMode::Cutout: return SpritePass::Cutout;
+	case AlphaMode::Translucent: return SpritePass::Translucent;
 	}
+	return SpritePass::Translucent;
 }
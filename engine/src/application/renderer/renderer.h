@@ -2,6 +2,8 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <memory>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
 #include <algorithm>
@@ -9,11 +11,23 @@
 #include <print>
 #include <format>
 #include <vector>
+#include <span>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <vulkan/vulkan.hpp>
 
 #include <application/renderer/texture.h>
 #include <application/managers/renderer_manager.h>
-#include <application/renderer/device.h>
+#include <application/renderer/graphic_device.h>
+#include <application/renderer/frame_ring_buffer.h>
+#include <application/renderer/renderer_config.h>
+#include <application/core/utils/radix_sort.h>
+#include <application/core/utils/bounded_queue.h>
+#include <application/renderer/render_packet.h>
+#include <application/renderer/sprite_culling.h>
+#include <application/renderer/atlas_packer.h>
+#include <application/renderer/texture_atlas.h>
 
 struct Event;
 struct EngineContext;
@@ -30,70 +44,297 @@ constexpr std::array<VertexData, 4> C_QUAD_BASIC_DATA =
 //-------------------------------------------------------------------------------------------------
 struct TexuredSpriteBatch
 {
-	std::vector<std::array<VertexData, 4>> m_geometryBatch;
-	VulkanTexture*                         m_texture;
-	uint32_t                               m_spritesCount;
+	//-- nullptr in bindless mode, sprites carry texture slot themselves
+	VulkanTexture* m_texture;
+	uint32_t       m_firstSprite;
+	uint32_t       m_spritesCount;
+	SpritePass     m_pass;
 };
 
 //-------------------------------------------------------------------------------------------------
+//-- Geometry of all frame sprites in draw order, batches are ranges of it.
+//-- Only collection of the active render path is filled
+struct SpriteFrameGeometry
+{
+	//-- Sprite collections are resized to exact count by the next frame, so they are left as is
+	//-- and frames of steady size don't fill them twice
+	void clear()
+	{
+		m_batches.clear();
+	}
+
+	std::vector<std::array<VertexData, 4>> m_vertices;
+	std::vector<SpriteInstanceData>        m_instances;
+	std::vector<TexuredSpriteBatch>        m_batches;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Part of texture sprite samples from, standalone textures cover whole [0, 1] range
+struct TextureRegion
+{
+	uint32_t  m_textureId = 0;
+	glm::vec4 m_uvRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+	//-- Of the image itself, not of atlas page it lives in
+	AlphaMode m_alphaMode = AlphaMode::Translucent;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- What texture streaming changed during the frame
+struct TextureStreamingChanges
+{
+	//-- Some texture became resident or failed, sprites using it need their regions again
+	bool m_regionsChanged = false;
+	//-- Loads have to be published again, always while some are pending as their latency grows
+	bool m_loadsChanged = false;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Small images are served from atlas pages: cooked ones from lookup table if it exists,
+//-- otherwise packed into runtime pages as they are requested. Big images stay standalone.
+//-- Images are decoded on worker threads, until upload of an image retires its sprites
+//-- sample 1x1 transparent placeholder. Cooked container of an image is preferred when device
+//-- supports its format, standalone images decoded at runtime get full mip chain and pages get
+//-- TextureAtlasConfig::C_MIP_LEVELS, see there what atlas filtering costs
 class TextureCache
 {
 public:
-	TextureCache(std::shared_ptr<VkGraphicDevice> graphicDevice, std::shared_ptr<EngineContext> context) : m_graphicDevice(graphicDevice)
-	                                                                     , m_engineContext(context) {}
+	TextureCache(std::shared_ptr<GraphicDevice>   graphicDevice
+	             , std::shared_ptr<EngineContext> context
+	             , bool                           runtimeAtlas);
 
-	VulkanTexture* loadTexture(std::string_view texturePath);
+	VulkanTexture* loadTexture(TextureHandle textureHandle);
+	//-- Never blocks, unknown image is queued for decoding and placeholder region is returned
+	//-- until the image is resident. Resident region stays the same for the cache lifetime.
+	//-- Path is resolved through asset registry only the first time handle is seen
+	TextureRegion textureRegion(TextureHandle textureHandle);
+	//-- Doesn't change the cache, so several threads may look regions up at once. Null for handle
+	//-- which wasn't resolved yet, textureRegion has to be called for it
+	const TextureRegion* resolvedRegion(TextureHandle textureHandle) const
+	{
+		const bool resolved = textureHandle < m_regions.size() && m_regions[textureHandle].m_textureId != C_INVALID_TEXTURE_ID;
+		return resolved ? &m_regions[textureHandle] : nullptr;
+	}
+	VulkanTexture* texture(uint32_t textureId) const { return m_textures[textureId].get(); }
+	//-- Uploads decoded images and switches resident ones to their regions, once per frame
+	TextureStreamingChanges update();
+	void publishLoads(std::vector<TextureLoadInfo>& textureLoads) const;
 
 private:
-	using TextureMap = absl::flat_hash_map<std::string, std::unique_ptr<VulkanTexture>>;
+	//-------------------------------------------------------------------------------------------------
+	//-- Shared with decoding task, so cache may go away while the task is still queued
+	struct TextureStreamRequest
+	{
+		std::string                           m_path;
+		//-- Invalid for cooked atlas pages, their entries are resolved per handle
+		TextureHandle                         m_textureHandle = C_INVALID_TEXTURE_HANDLE;
+		//-- Cooked atlas page index or C_NO_COOKED_PAGE for standalone image
+		uint32_t                              m_cookedPage = 0;
+		std::atomic<TextureLoadState>         m_state = TextureLoadState::Queued;
+		//-- Written by worker before state becomes Decoded
+		TextureData                           m_texture;
+		//-- Texture is cell of runtime atlas page around image of the given size
+		bool                                  m_atlasCell = false;
+		uint32_t                              m_cellImageWidth = 0;
+		uint32_t                              m_cellImageHeight = 0;
+		uint32_t                              m_width = 0;
+		uint32_t                              m_height = 0;
+		TextureRegion                         m_region;
+		UploadTicket                          m_uploadTicket = 0;
+		std::chrono::steady_clock::time_point m_requestTime;
+		float                                 m_latencyMs = 0.0f;
+	};
+
+	void requestImage(std::string_view texturePath, TextureHandle textureHandle, uint32_t cookedPage);
+	void uploadDecoded(TextureStreamRequest& request);
+	void makeResident(TextureStreamRequest& request);
+	//-- Cell is made by makeAtlasCell with page levels, width and height are of the image in it
+	TextureRegion addToRuntimeAtlas(const TextureData& cell, uint32_t width, uint32_t height);
+	uint32_t addTexture(std::unique_ptr<VulkanTexture> texture);
+
+	//-------------------------------------------------------------------------------------------------
+	struct RuntimeAtlasPage
+	{
+		uint32_t      m_textureId;
+		SkylinePacker m_packer;
+	};
+
+	constexpr static uint32_t C_INVALID_TEXTURE_ID = std::numeric_limits<uint32_t>::max();
+	//-- Cooked page is being streamed
+	constexpr static uint32_t C_PENDING_TEXTURE_ID = C_INVALID_TEXTURE_ID - 1;
+	constexpr static uint32_t C_NO_COOKED_PAGE = std::numeric_limits<uint32_t>::max();
 
-	TextureMap       m_texturesMap;
-	std::shared_ptr<VkGraphicDevice> m_graphicDevice;
+	//-- Indexed by texture handle, C_INVALID_TEXTURE_ID marks handle which wasn't resolved yet
+	std::vector<TextureRegion>                  m_regions;
+	std::vector<std::unique_ptr<VulkanTexture>> m_textures;
+	std::shared_ptr<GraphicDevice>   m_graphicDevice;
 	std::shared_ptr<EngineContext>   m_engineContext;
+	//-- Manager outlives renderer, looked up once
+	AssetRegistry*                   m_assetRegistry = nullptr;
+
+	AtlasLookupTable                           m_cookedAtlas;
+	absl::flat_hash_map<std::string, uint32_t> m_cookedEntryIndices;
+	std::vector<uint32_t>                      m_cookedPageTextureIds;
+	std::vector<RuntimeAtlasPage>              m_runtimeAtlasPages;
+	bool                                       m_runtimeAtlas = true;
+
+	uint32_t                                           m_placeholderTextureId = 0;
+	//-- All requests for editor, pending ones are polled every frame
+	std::vector<std::shared_ptr<TextureStreamRequest>> m_streamRequests;
+	std::vector<std::shared_ptr<TextureStreamRequest>> m_pendingRequests;
 };
 
-class BatchDrawer
+class BatchDrawer : public GpuAllocationOwner
 {
 public:
-	BatchDrawer(std::shared_ptr<VkGraphicDevice> graphicDevice);
-	~BatchDrawer();
+	BatchDrawer(std::shared_ptr<GraphicDevice> graphicDevice, SpriteRenderPath renderPath);
+	~BatchDrawer() override;
 
-	void draw(const std::vector<TexuredSpriteBatch>& spriteBatches);
+	void draw(const SpriteFrameGeometry& spriteFrame);
+	//-- Retained mode, geometry stays in buffer of every frame in flight. Buffer gets sprites
+	//-- patched since it was written last time, or the whole geometry after it was rebuilt
+	void drawRetained(const SpriteFrameGeometry& spriteFrame, const std::vector<uint32_t>& patchedSprites, bool rebuilt);
+	//-- Retained buffer moves when its frame comes next
+	void relocate(const GpuAllocation& allocation) override;
 
 private:
 	//-------------------------------------------------------------------------------------------------
-	void clearBuffers(uint8_t frameIndex);
+	//-- Host visible and mapped for its whole lifetime like frame ring buffer
+	struct RetainedBuffer
+	{
+		VulkanBufferMemory    m_memory;
+		vk::DeviceSize        m_capacity = 0;
+		//-- Draw positions patched while the buffer was in flight
+		std::vector<uint32_t> m_pendingSprites;
+		bool                  m_stale = true;
+		bool                  m_relocating = false;
+	};
 
-	std::shared_ptr<VkGraphicDevice> m_graphicDevice;
+	//-------------------------------------------------------------------------------------------------
+	void submitBatches(const SpriteFrameGeometry& spriteFrame, vk::Buffer buffer, vk::DeviceSize offset);
+	void ensureQuadIndexCapacity(uint32_t spritesCount);
+	vk::DeviceSize spriteStride() const;
+
+	//-- Initial size of sprites region per frame, grows on demand
+	constexpr static vk::DeviceSize C_INITIAL_SPRITE_RING_SIZE = 1024 * sizeof(std::array<VertexData, 4>);
+	//-- Sprites count covered by shared index buffer on start
+	constexpr static uint32_t C_INITIAL_QUAD_INDEX_CAPACITY = 16 * 1024;
+
+	std::shared_ptr<GraphicDevice>   m_graphicDevice;
+	std::unique_ptr<FrameRingBuffer> m_vertexRingBuffer;
+	//-- Retained mode only, one per frame in flight
+	std::vector<RetainedBuffer>      m_retainedBuffers;
+	SpriteRenderPath                 m_renderPath;
+	//-- Same quad index pattern for every batch, batch vertices are bound with offset
+	VulkanBufferMemory m_quadIndexBuffer;
+	uint32_t           m_quadIndexCapacity = 0;
 	//-- Transformed to device notation data
 	std::vector<TexturedGeometryBatch> m_vertexBuffersToFrames;
-	std::vector<BatchIndecies>         m_indexBuffersToFrames;
 };
 
 //-------------------------------------------------------------------------------------------------
 class RendererSystem
 {
 public:
-	RendererSystem(std::shared_ptr<EngineContext> context);
+	RendererSystem(std::shared_ptr<EngineContext> context, RendererConfig config);
 	~RendererSystem();
 
 	void update(float dt);
 	void onEvent(Event& event);
-	void beginFrame(float dt);
-	void endFrame();
 	void resizedWindow() { m_device->resizedWindow(); }
 
 private:
-	void batchSprites();
+	//-------------------------------------------------------------------------------------------------
+	//-- What one range of visible sprites found while building sort keys
+	struct SpriteRangeTally
+	{
+		uint32_t              m_opaqueCount = 0;
+		uint32_t              m_cutoutCount = 0;
+		//-- Positions in visible sprites whose textures cache hasn't resolved yet
+		std::vector<uint32_t> m_unresolved;
+	};
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Retained mode sprites indexed by slot. Changed sprite is patched in its place of
+	//-- frame geometry while its sort key stays the same, draw order is rebuilt otherwise
+	struct RetainedSprites
+	{
+		SpriteDrawList        m_sprites;
+		std::vector<uint8_t>  m_alive;
+		//-- Position of sprite in frame geometry, valid for alive ones while order isn't rebuilt
+		std::vector<uint32_t> m_drawPositions;
+		//-- Sprites were added or removed, or changed their sort keys, so draw order and
+		//-- whole frame geometry were built again this frame
+		bool                  m_rebuilt = false;
+		//-- Draw positions regenerated in place this frame
+		std::vector<uint32_t> m_patchedSprites;
+	};
+
+	//-- Per frame sprite work is split into ranges of at least that many sprites
+	constexpr static uint32_t C_MIN_SPRITES_PER_TASK = 4096;
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Results of rendered frame shown by editor
+	struct FrameOutputs
+	{
+		RendererStats                m_stats;
+		std::vector<TextureLoadInfo> m_textureLoads;
+		//-- Loads hold a string per image, so they are moved only when changed
+		bool                         m_textureLoadsChanged = false;
+	};
+
+	//-- Main thread side
+	RenderPacket makePacket(float dt);
+	void submitToRenderThread(RenderPacket packet);
+	void applyFrameOutputs(FrameOutputs& outputs);
+	//-- Render side, main thread or render thread
+	void renderLoop();
+	void renderPacket(const RenderPacket& packet);
+	void retirePacket(RenderPacket packet);
+	//-- Headless only, after all frames are finished
+	void writeReadback();
+	void batchSprites(const SpriteDrawList& sprites, const RenderCamera& camera);
+	void batchRetainedSprites(const RenderPacket& packet, bool regionsChanged);
+	//-- Sorts m_visibleSprites and fills frame geometry and batches with them
+	void buildBatches(const SpriteDrawList& sprites);
+	uint64_t spriteSortKey(const SpriteDrawList& sprites, uint32_t spriteIndex, const TextureRegion& region) const;
+	void writeSpriteGeometry(const SpriteDrawList& sprites, uint32_t spriteIndex, uint32_t drawPosition);
+	SpritePass spritePass(float tintAlpha, const TextureRegion& region) const;
+	void updateDeviceStats();
 
 private:
 	std::shared_ptr<EngineContext> m_engineContext;
+	RendererConfig                 m_config;
 
-	std::shared_ptr<VkGraphicDevice> m_device;
+	std::shared_ptr<GraphicDevice> m_device;
 
 	std::unique_ptr<TextureCache> m_texureCache;
 	std::unique_ptr<BatchDrawer>  m_batchDrawer;
 
+	SpriteCuller          m_spriteCuller;
+	//-- Indices of sprites passed culling, all sprites when it's off
+	std::vector<uint32_t> m_visibleSprites;
+	//-- Sort keys of sprites, scratch is kept to avoid reallocations
+	std::vector<RadixSortItem>    m_sortItems;
+	std::vector<RadixSortItem>    m_sortScratch;
+	std::vector<RadixHistogram>   m_sortHistograms;
+	//-- Per range results of key building, their storage is kept between frames
+	std::vector<SpriteRangeTally> m_rangeTallies;
+	//-- Texture region per sprite in user order
+	std::vector<TextureRegion> m_spriteRegions;
+	RetainedSprites            m_retainedSprites;
 	//-- Transfromed to batches user's data
-	std::vector<TexuredSpriteBatch> m_batchedByTextureSprites;
+	SpriteFrameGeometry m_spriteFrame;
+	FrameOutputs        m_frameOutputs;
+	uint64_t            m_frameIndex = 0;
+
+	//-- Rendered packets come back to main thread, their ImGui snapshots are freed there
+	//-- and sprite storage is reused for the next packets
+	std::mutex                m_retiredMutex;
+	std::vector<RenderPacket> m_retiredPackets;
+
+	//-- Render thread mode only, queue capacity is the latency bound in frames
+	std::unique_ptr<BoundedQueue<RenderPacket>> m_packets;
+	std::mutex                                  m_outputsMutex;
+	FrameOutputs                                m_publishedOutputs;
+	std::jthread                                m_renderThread;
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//-------------------------------------------------------------------------------------------------
+enum class SpriteRenderPath : uint8_t
+{
+	//-- Every sprite is expanded to 4 transformed vertices on CPU
+	Vertex,
+	//-- One compact record per sprite, quad is generated in vertex shader
+	Instanced
+};
+
+//-------------------------------------------------------------------------------------------------
+enum class GraphicBackend : uint8_t
+{
+	Vulkan,
+	//-- Accepts all work and does nothing, for profiling CPU side of the frame
+	Null
+};
+
+//-------------------------------------------------------------------------------------------------
+struct RendererConfig
+{
+	//-- Frames go nowhere visible, so no window is created
+	bool windowless() const { return m_headless || m_graphicBackend == GraphicBackend::Null; }
+
+	GraphicBackend   m_graphicBackend = GraphicBackend::Vulkan;
+	SpriteRenderPath m_spriteRenderPath = SpriteRenderPath::Instanced;
+	//-- One texture array indexed per sprite, used only if device supports descriptor indexing
+	bool             m_bindlessTextures = true;
+	//-- Pack small images into atlas pages as they are requested, for editor without cooked atlas.
+	//-- Pages have a short mip chain, see TextureAtlasConfig for its limits
+	bool             m_runtimeAtlas = true;
+	//-- Compile shaders from sources instead of cooked SPIR-V, development builds only
+	bool             m_compileShaders = false;
+	//-- Skip sprites outside camera frustum before batching
+	bool             m_frustumCulling = true;
+	//-- Renderer keeps sprites between frames and scene sends only changed ones. Draw order is
+	//-- sorted again only when it changes, sprites aren't culled on CPU then
+	bool             m_retainedSprites = false;
+	//-- Opaque and cutout sprites skip blending and write depth, everything is blended otherwise
+	bool             m_opaquePass = true;
+	//-- Threads recording sprite batches into secondary command buffers, zero records inline
+	uint32_t         m_recordingThreads = 0;
+	//-- Frames are rendered on own thread from packets built by main thread
+	bool             m_renderThread = false;
+	//-- How many packets main thread may build ahead of the rendered one
+	uint32_t         m_renderLatencyFrames = 1;
+	//-- Render into offscreen images of fixed size without window, swapchain and UI.
+	//-- Null backend uses the same fixed size
+	bool             m_headless = false;
+	uint32_t         m_headlessWidth = 1200;
+	uint32_t         m_headlessHeight = 800;
+	//-- Headless only, last rendered frame is written there as TGA on shutdown
+	std::string      m_readbackPath;
+};
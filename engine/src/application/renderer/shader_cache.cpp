@@ -0,0 +1,148 @@
+#include "shader_cache.h"
+
+#ifdef ENGINE_SHADER_COMPILER
+
+#include <application/core/utils/engine_assert.h>
+#include <application/renderer/shader_compiler.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <sstream>
+
+//-------------------------------------------------------------------------------------------------
+constexpr uint64_t C_FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr uint64_t C_FNV_PRIME = 0x100000001b3ull;
+constexpr uint32_t C_SPIRV_MAGIC = 0x07230203;
+
+//-------------------------------------------------------------------------------------------------
+void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * C_FNV_PRIME;
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+void hashString(uint64_t& hash, std::string_view text)
+{
+	//-- Length goes first, so "ab" + "c" and "a" + "bc" differ
+	const uint64_t size = text.size();
+	hashBytes(hash, &size, sizeof(size));
+	hashBytes(hash, text.data(), text.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Quoted names of '#include "file"' lines, system includes aren't used by project shaders
+std::vector<std::string> shaderIncludes(const std::string& source)
+{
+	std::vector<std::string> includes;
+	std::istringstream       in(source);
+	std::string              line;
+	while (std::getline(in, line))
+	{
+		const size_t directive = line.find_first_not_of(" \t");
+		if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+		{
+			continue;
+		}
+		const size_t nameStart = line.find('"', directive);
+		const size_t nameEnd = nameStart == std::string::npos ? nameStart : line.find('"', nameStart + 1);
+		if (nameEnd != std::string::npos)
+		{
+			includes.push_back(line.substr(nameStart + 1, nameEnd - nameStart - 1));
+		}
+	}
+	return includes;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::vector<uint32_t> ShaderCache::spirv(const fs_path&                    path
+                                         , ShaderStage                     stage
+                                         , const std::vector<std::string>& macros)
+{
+	engineAssert(m_vfs.isFileExist(path), std::format("Shader '{}' doesn't exist", normalizePath(path)));
+
+	const fs_path blobPath = fs_path(ShaderCacheConfig::C_CACHE_DIR) / std::format("{:016x}.spv", sourceHash(path, stage, macros));
+
+	//-- Blob is trusted only if it looks like SPIR-V, broken one is compiled again
+	if (m_vfs.isFileExist(blobPath))
+	{
+		const File blob = m_vfs.loadFile(blobPath);
+		if (blob.m_buffer.size() >= sizeof(uint32_t) * 5 && blob.m_buffer.size() % sizeof(uint32_t) == 0)
+		{
+			std::vector<uint32_t> code(blob.m_buffer.size() / sizeof(uint32_t));
+			memcpy(code.data(), blob.m_buffer.data(), blob.m_buffer.size());
+			if (code[0] == C_SPIRV_MAGIC)
+			{
+				++m_hitsCount;
+				return code;
+			}
+		}
+	}
+
+	std::vector<uint32_t> code = compile(path, stage, macros);
+	++m_compiledCount;
+
+	std::filesystem::create_directories(m_vfs.virtualToNativePath(ShaderCacheConfig::C_CACHE_DIR));
+	File blob = m_vfs.createFile(blobPath);
+	blob.m_buffer.resize(code.size() * sizeof(uint32_t));
+	memcpy(blob.m_buffer.data(), code.data(), blob.m_buffer.size());
+	m_vfs.writeFile(blob);
+
+	return code;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t ShaderCache::sourceHash(const fs_path& path, ShaderStage stage, const std::vector<std::string>& macros) const
+{
+	uint64_t hash = C_FNV_OFFSET_BASIS;
+
+	const std::array<uint64_t, 2> compilerKey = {
+		ShaderCacheConfig::C_CACHE_VERSION
+		, static_cast<uint64_t>(stage)
+	};
+	hashBytes(hash, compilerKey.data(), sizeof(compilerKey));
+	hashString(hash, shaderCompilerIdentity());
+
+	for (const auto& macro : macros)
+	{
+		hashString(hash, macro);
+	}
+	hashIncludes(path, hash, 0);
+	return hash;
+}
+
+//-------------------------------------------------------------------------------------------------
+void ShaderCache::hashIncludes(const fs_path& path, uint64_t& hash, uint32_t depth) const
+{
+	//-- Missing include is hashed by name, compilation reports it
+	hashString(hash, normalizePath(path));
+	if (depth > C_MAX_INCLUDE_DEPTH || !m_vfs.isFileExist(path))
+	{
+		return;
+	}
+
+	const std::string source = m_vfs.loadFile(path).toString();
+	hashString(hash, source);
+	for (const auto& include : shaderIncludes(source))
+	{
+		hashIncludes(path.parent_path() / include, hash, depth + 1);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+std::vector<uint32_t> ShaderCache::compile(const fs_path& path, ShaderStage stage, const std::vector<std::string>& macros) const
+{
+	const auto stages = splitShaderStages(path, m_vfs.loadFile(path).toString());
+	const auto stageSource = std::ranges::find(stages, stage, &ShaderStageSource::m_stage);
+	engineAssert(stageSource != stages.end()
+		, std::format("Shader '{}' has no {} stage", normalizePath(path), shaderStageName(stage)));
+
+	return compileShaderStage(m_vfs, path, *stageSource, macros);
+}
+
+#endif
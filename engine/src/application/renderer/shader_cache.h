@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/shader_manifest.h>
+
+//-------------------------------------------------------------------------------------------------
+struct ShaderCacheConfig
+{
+	constexpr static inline auto C_CACHE_DIR = "cache/shaders";
+	constexpr static inline auto C_PIPELINE_CACHE_PATH = "cache/pipeline.cache";
+	//-- Bumped when compile options or blob layout change, old blobs are just never hit
+	constexpr static inline uint32_t C_CACHE_VERSION = 1;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- SPIR-V blobs stored under project by hash of everything that affects compilation: source,
+//-- sources of included files, macros, shader stage and compiler version. Warm start reads
+//-- blobs and never runs the compiler. Development path, defined only with ENGINE_SHADER_COMPILER
+class ShaderCache
+{
+public:
+	explicit ShaderCache(const VirtualFS& vfs) : m_vfs(vfs) {}
+
+	//-- Path is virtual, includes are resolved relative to including file
+	std::vector<uint32_t> spirv(const fs_path&                    path
+	                            , ShaderStage                     stage
+	                            , const std::vector<std::string>& macros = {});
+
+	uint32_t hitsCount() const { return m_hitsCount; }
+	uint32_t compiledCount() const { return m_compiledCount; }
+
+private:
+	uint64_t sourceHash(const fs_path& path, ShaderStage stage, const std::vector<std::string>& macros) const;
+	void hashIncludes(const fs_path& path, uint64_t& hash, uint32_t depth) const;
+	std::vector<uint32_t> compile(const fs_path& path, ShaderStage stage, const std::vector<std::string>& macros) const;
+
+private:
+	//-- Guards against include cycles while hashing
+	constexpr static inline uint32_t C_MAX_INCLUDE_DEPTH = 16;
+
+	const VirtualFS& m_vfs;
+	uint32_t         m_hitsCount = 0;
+	uint32_t         m_compiledCount = 0;
+};
@@ -0,0 +1,108 @@
+#include "shader_compiler.h"
+
+#ifdef ENGINE_SHADER_COMPILER
+
+#include <application/core/utils/engine_assert.h>
+
+#include <format>
+#include <memory>
+
+#include <shaderc/shaderc.hpp>
+
+//-------------------------------------------------------------------------------------------------
+shaderc_shader_kind shadercKind(ShaderStage stage)
+{
+	return stage == ShaderStage::Vertex ? shaderc_vertex_shader : shaderc_fragment_shader;
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Resolves includes through VirtualFS relative to including file
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+	explicit ShaderIncluder(const VirtualFS& vfs) : m_vfs(vfs) {}
+
+	//-------------------------------------------------------------------------------------------------
+	shaderc_include_result* GetInclude(const char*          requestedSource
+	                                   , shaderc_include_type /*type*/
+	                                   , const char*        requestingSource
+	                                   , size_t             /*includeDepth*/) override
+	{
+		auto* include = new IncludeData();
+		const fs_path path = fs_path(requestingSource).parent_path() / requestedSource;
+		if (m_vfs.isFileExist(path))
+		{
+			include->m_name = normalizePath(path);
+			include->m_content = m_vfs.loadFile(path).toString();
+		}
+		else
+		{
+			//-- Empty name tells compiler the include failed, content is the error message
+			include->m_content = std::format("Shader include '{}' not found", normalizePath(path));
+		}
+
+		include->m_result.source_name = include->m_name.data();
+		include->m_result.source_name_length = include->m_name.size();
+		include->m_result.content = include->m_content.data();
+		include->m_result.content_length = include->m_content.size();
+		include->m_result.user_data = include;
+		return &include->m_result;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	void ReleaseInclude(shaderc_include_result* data) override
+	{
+		delete static_cast<IncludeData*>(data->user_data);
+	}
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct IncludeData
+	{
+		shaderc_include_result m_result = {};
+		std::string            m_name;
+		std::string            m_content;
+	};
+
+	const VirtualFS& m_vfs;
+};
+
+//-------------------------------------------------------------------------------------------------
+std::vector<uint32_t> compileShaderStage(const VirtualFS&                  vfs
+                                         , const fs_path&                  path
+                                         , const ShaderStageSource&        stageSource
+                                         , const std::vector<std::string>& macros)
+{
+	shaderc::Compiler       compiler;
+	shaderc::CompileOptions options;
+
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	options.SetIncluder(std::make_unique<ShaderIncluder>(vfs));
+	for (const auto& macro : macros)
+	{
+		options.AddMacroDefinition(macro);
+	}
+
+	const std::string name = normalizePath(path);
+	auto              result = compiler.CompileGlslToSpv(stageSource.m_source, shadercKind(stageSource.m_stage), name.c_str(), options);
+
+	engineAssert(result.GetCompilationStatus() == shaderc_compilation_status_success
+		, std::format("Shader: '{}' ({}) compilation failed: {}", name, shaderStageName(stageSource.m_stage), result.GetErrorMessage()));
+
+	// Spirv binary code
+	return { result.cbegin(), result.cend() };
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Defined by build from vendored compiler sources, shaderc has no API for its own version
+#ifndef ENGINE_SHADER_COMPILER_ID
+#error "ENGINE_SHADER_COMPILER_ID has to be defined together with ENGINE_SHADER_COMPILER"
+#endif
+
+//-------------------------------------------------------------------------------------------------
+std::string_view shaderCompilerIdentity()
+{
+	return ENGINE_SHADER_COMPILER_ID;
+}
+
+#endif
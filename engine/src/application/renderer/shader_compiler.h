@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/shader_manifest.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- GLSL to SPIR-V through shaderc. Linked only into builds with ENGINE_SHADER_COMPILER:
+//-- shader cooker tool and engine built with runtime shader compilation for development.
+//-- Includes are resolved through VirtualFS relative to including file
+std::vector<uint32_t> compileShaderStage(const VirtualFS&                  vfs
+                                         , const fs_path&                  path
+                                         , const ShaderStageSource&        stageSource
+                                         , const std::vector<std::string>& macros);
+//-- Versions of shaderc, glslang and SPIRV-Tools the build links, with revisions they are
+//-- pinned to. Changes whenever compiler may produce different code for the same source
+std::string_view shaderCompilerIdentity();
@@ -0,0 +1,212 @@
+#include "shader_manifest.h"
+
+#include <application/core/utils/engine_assert.h>
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <iomanip>
+#include <sstream>
+
+//-------------------------------------------------------------------------------------------------
+struct ShaderStageInfo
+{
+	ShaderStage      m_stage;
+	std::string_view m_name;
+	std::string_view m_extension;
+};
+
+constexpr std::array<ShaderStageInfo, static_cast<size_t>(ShaderStage::Count)> C_SHADER_STAGES =
+{
+	ShaderStageInfo{ ShaderStage::Vertex, "vert", ".vert" }
+	, ShaderStageInfo{ ShaderStage::Fragment, "frag", ".frag" }
+};
+
+//-------------------------------------------------------------------------------------------------
+std::string_view shaderStageName(ShaderStage stage)
+{
+	return C_SHADER_STAGES[static_cast<size_t>(stage)].m_name;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<ShaderStage> parseShaderStage(std::string_view name)
+{
+	for (const auto& info : C_SHADER_STAGES)
+	{
+		if (info.m_name == name)
+		{
+			return info.m_stage;
+		}
+	}
+	return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string joinShaderMacros(std::vector<std::string> macros)
+{
+	std::ranges::sort(macros);
+
+	std::string joined;
+	for (const auto& macro : macros)
+	{
+		if (!joined.empty())
+		{
+			joined += ' ';
+		}
+		joined += macro;
+	}
+	return joined;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::vector<ShaderStageSource> splitShaderStages(const fs_path& path, const std::string& source)
+{
+	const std::string extension = path.extension().string();
+	for (const auto& info : C_SHADER_STAGES)
+	{
+		if (info.m_extension == extension)
+		{
+			return { { info.m_stage, source } };
+		}
+	}
+
+	//-- Lines before the first section are shared by all stages
+	std::vector<std::string> lines;
+	std::istringstream       in(source);
+	for (std::string line; std::getline(in, line);)
+	{
+		lines.push_back(std::move(line));
+	}
+
+	std::vector<std::optional<ShaderStage>> lineStages(lines.size());
+	std::vector<ShaderStage>                stages;
+	std::optional<ShaderStage>              currentStage;
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		std::istringstream lineStream(lines[i]);
+		std::string        directive;
+		lineStream >> directive;
+		if (directive == ShaderCookConfig::C_STAGE_DIRECTIVE)
+		{
+			std::string stageName;
+			lineStream >> stageName;
+			currentStage = parseShaderStage(stageName);
+			engineAssert(currentStage.has_value()
+				, std::format("Shader '{}' has unknown stage '{}' at line {}", normalizePath(path), stageName, i + 1));
+			if (std::ranges::find(stages, *currentStage) == stages.end())
+			{
+				stages.push_back(*currentStage);
+			}
+			//-- Directive itself isn't GLSL
+			lines[i].clear();
+		}
+		lineStages[i] = currentStage;
+	}
+
+	std::vector<ShaderStageSource> result;
+	for (ShaderStage stage : stages)
+	{
+		ShaderStageSource& stageSource = result.emplace_back();
+		stageSource.m_stage = stage;
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			if (!lineStages[i] || *lineStages[i] == stage)
+			{
+				stageSource.m_source += lines[i];
+			}
+			stageSource.m_source += '\n';
+		}
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::vector<std::vector<std::string>> shaderVariants(const std::string& source)
+{
+	std::vector<std::vector<std::string>> variants;
+	std::istringstream                    in(source);
+	for (std::string line; std::getline(in, line);)
+	{
+		std::istringstream lineStream(line);
+		std::string        directive;
+		lineStream >> directive;
+		if (directive != ShaderCookConfig::C_VARIANT_DIRECTIVE)
+		{
+			continue;
+		}
+
+		std::vector<std::string>& macros = variants.emplace_back();
+		for (std::string macro; lineStream >> macro;)
+		{
+			macros.push_back(std::move(macro));
+		}
+	}
+	return variants;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool ShaderManifest::load(const VirtualFS& vfs)
+{
+	if (!vfs.isFileExist(ShaderCookConfig::C_MANIFEST_PATH))
+	{
+		return false;
+	}
+
+	std::istringstream in(vfs.loadFile(ShaderCookConfig::C_MANIFEST_PATH).toString());
+	std::string        line;
+	while (std::getline(in, line))
+	{
+		std::istringstream lineStream(line);
+		std::string        tag;
+		lineStream >> tag;
+		if (tag != "shader")
+		{
+			continue;
+		}
+
+		ShaderManifestEntry entry;
+		std::string         stageName;
+		lineStream >> std::quoted(entry.m_sourcePath)
+			>> stageName
+			>> std::quoted(entry.m_macros)
+			>> std::quoted(entry.m_spirvPath);
+
+		const std::optional<ShaderStage> stage = parseShaderStage(stageName);
+		engineAssert(stage.has_value(), std::format("Shader manifest entry '{}' has unknown stage '{}'", entry.m_sourcePath, stageName));
+		entry.m_stage = *stage;
+		m_entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void ShaderManifest::save(const VirtualFS& vfs) const
+{
+	std::ostringstream out;
+	for (const auto& entry : m_entries)
+	{
+		out << "shader " << std::quoted(entry.m_sourcePath)
+			<< ' ' << shaderStageName(entry.m_stage)
+			<< ' ' << std::quoted(entry.m_macros)
+			<< ' ' << std::quoted(entry.m_spirvPath) << '\n';
+	}
+
+	const std::string text = out.str();
+	File file = vfs.createFile(ShaderCookConfig::C_MANIFEST_PATH);
+	file.m_buffer.assign(text.begin(), text.end());
+	vfs.writeFile(file);
+}
+
+//-------------------------------------------------------------------------------------------------
+const ShaderManifestEntry* ShaderManifest::find(std::string_view sourcePath, ShaderStage stage, const std::vector<std::string>& macros) const
+{
+	const std::string joinedMacros = joinShaderMacros(macros);
+	for (const auto& entry : m_entries)
+	{
+		if (entry.m_sourcePath == sourcePath && entry.m_stage == stage && entry.m_macros == joinedMacros)
+		{
+			return &entry;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <application/managers/virtual_fs.h>
+
+//-------------------------------------------------------------------------------------------------
+enum class ShaderStage : uint8_t
+{
+	Vertex,
+	Fragment,
+
+	Count
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Cooked SPIR-V lives next to project shaders, manifest maps sources to blobs
+struct ShaderCookConfig
+{
+	constexpr static inline auto C_SHADERS_DIR = "shaders";
+	constexpr static inline auto C_COOKED_DIR = "shaders_spv";
+	constexpr static inline auto C_MANIFEST_PATH = "shaders_spv/shaders.manifest";
+	//-- Line in shader source declaring macros set it is cooked with besides the plain one:
+	//--   //!variant BINDLESS_TEXTURES
+	constexpr static inline std::string_view C_VARIANT_DIRECTIVE = "//!variant";
+	//-- Section header of multi stage file: "#shader vert" or "#shader frag"
+	constexpr static inline std::string_view C_STAGE_DIRECTIVE = "#shader";
+};
+
+//-------------------------------------------------------------------------------------------------
+struct ShaderStageSource
+{
+	ShaderStage m_stage = ShaderStage::Vertex;
+	std::string m_source;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- One cooked variant of one stage, macros are sorted and joined by spaces
+struct ShaderManifestEntry
+{
+	std::string m_sourcePath;
+	ShaderStage m_stage = ShaderStage::Vertex;
+	std::string m_macros;
+	std::string m_spirvPath;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Text format, one variant per line:
+//--   shader "shaders/hello.frag" frag "BINDLESS_TEXTURES" "shaders_spv/hello.frag.1.spv"
+struct ShaderManifest
+{
+	bool load(const VirtualFS& vfs);
+	void save(const VirtualFS& vfs) const;
+	const ShaderManifestEntry* find(std::string_view sourcePath, ShaderStage stage, const std::vector<std::string>& macros) const;
+
+	std::vector<ShaderManifestEntry> m_entries;
+};
+
+//-------------------------------------------------------------------------------------------------
+std::string_view shaderStageName(ShaderStage stage);
+std::optional<ShaderStage> parseShaderStage(std::string_view name);
+std::string joinShaderMacros(std::vector<std::string> macros);
+//-- Stages of a source: whole file for .vert/.frag, "#shader" sections for multi stage files.
+//-- Lines of removed sections are kept empty, so compiler errors point to file lines
+std::vector<ShaderStageSource> splitShaderStages(const fs_path& path, const std::string& source);
+//-- Macro sets of C_VARIANT_DIRECTIVE lines, plain variant without macros isn't included
+std::vector<std::vector<std::string>> shaderVariants(const std::string& source);
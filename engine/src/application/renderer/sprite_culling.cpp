@@ -0,0 +1,183 @@
+#include "sprite_culling.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPRITE_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef SPRITE_CULLING_SSE
+//-------------------------------------------------------------------------------------------------
+struct SimdPlane
+{
+	__m128 m_x;
+	__m128 m_y;
+	__m128 m_z;
+	__m128 m_w;
+	__m128 m_absX;
+	__m128 m_absY;
+};
+#endif
+
+//-------------------------------------------------------------------------------------------------
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProj)
+{
+	//-- Matrix is column major, planes are combinations of its rows
+	const glm::vec4 row0 = { viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0] };
+	const glm::vec4 row1 = { viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1] };
+	const glm::vec4 row2 = { viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2] };
+	const glm::vec4 row3 = { viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3] };
+
+	//-- Left, right, bottom, top, near (z >= 0) and far
+	FrustumPlanes planes = {
+		row3 + row0
+		, row3 - row0
+		, row3 + row1
+		, row3 - row1
+		, row2
+		, row3 - row2
+	};
+
+	//-- Normalized, so plane distances are in world units
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return planes;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteCuller::cull(const SpriteDrawList&    sprites
+                        , const glm::mat4&       viewProj
+                        , std::vector<uint32_t>& visibleSprites
+                        , ThreadPool&            threadPool)
+{
+	if (sprites.empty())
+	{
+		visibleSprites.clear();
+		return;
+	}
+
+	const uint32_t spritesCount = sprites.size();
+	const uint32_t groupsCount = (spritesCount + C_LANES - 1) / C_LANES;
+	m_centerX.resize(groupsCount * C_LANES, 0.0f);
+	m_centerY.resize(groupsCount * C_LANES, 0.0f);
+	m_centerZ.resize(groupsCount * C_LANES, 0.0f);
+	m_extentX.resize(groupsCount * C_LANES, 0.0f);
+	m_extentY.resize(groupsCount * C_LANES, 0.0f);
+
+	//-- Every range writes indices from its own first sprite on, so ranges need no locking
+	//-- and are moved together afterwards. Cleared storage isn't filled again when it's big enough
+	visibleSprites.resize(spritesCount);
+	m_visibleRanges.resize(threadPool.rangesCount(groupsCount, C_MIN_GROUPS_PER_TASK));
+
+	const FrustumPlanes planes = extractFrustumPlanes(viewProj);
+	threadPool.parallelFor(groupsCount, C_MIN_GROUPS_PER_TASK, [&](uint32_t range, uint32_t firstGroup, uint32_t lastGroup)
+		{
+			const uint32_t first = firstGroup * C_LANES;
+			const uint32_t last = std::min(lastGroup * C_LANES, spritesCount);
+			packBounds(sprites, first, last);
+			m_visibleRanges[range] = { first, testBounds(planes, first, last, visibleSprites.data() + first) };
+		});
+
+	uint32_t visibleCount = 0;
+	for (const VisibleRange& range : m_visibleRanges)
+	{
+		if (range.m_first != visibleCount)
+		{
+			std::copy_n(visibleSprites.begin() + range.m_first, range.m_count, visibleSprites.begin() + visibleCount);
+		}
+		visibleCount += range.m_count;
+	}
+	visibleSprites.resize(visibleCount);
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t SpriteCuller::testBounds(const FrustumPlanes& planes, uint32_t first, uint32_t last, uint32_t* visibleSprites) const
+{
+	uint32_t visibleCount = 0;
+
+#ifdef SPRITE_CULLING_SSE
+	//-- Plane coefficients broadcast once, |x| and |y| project box extents onto plane normal
+	std::array<SimdPlane, 6> simdPlanes;
+	for (size_t i = 0; i < planes.size(); ++i)
+	{
+		simdPlanes[i] = {
+			.m_x = _mm_set1_ps(planes[i].x)
+			, .m_y = _mm_set1_ps(planes[i].y)
+			, .m_z = _mm_set1_ps(planes[i].z)
+			, .m_w = _mm_set1_ps(planes[i].w)
+			, .m_absX = _mm_set1_ps(std::abs(planes[i].x))
+			, .m_absY = _mm_set1_ps(std::abs(planes[i].y))
+		};
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	//-- Range starts on a lane group, padding lanes past its end are never reported
+	for (uint32_t base = first; base < last; base += C_LANES)
+	{
+		const __m128 centerX = _mm_loadu_ps(m_centerX.data() + base);
+		const __m128 centerY = _mm_loadu_ps(m_centerY.data() + base);
+		const __m128 centerZ = _mm_loadu_ps(m_centerZ.data() + base);
+		const __m128 extentX = _mm_loadu_ps(m_extentX.data() + base);
+		const __m128 extentY = _mm_loadu_ps(m_extentY.data() + base);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const SimdPlane& plane : simdPlanes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(plane.m_x, centerX), _mm_mul_ps(plane.m_y, centerY));
+			distance = _mm_add_ps(distance, _mm_add_ps(_mm_mul_ps(plane.m_z, centerZ), plane.m_w));
+			const __m128 radius = _mm_add_ps(_mm_mul_ps(plane.m_absX, extentX), _mm_mul_ps(plane.m_absY, extentY));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		//-- Lanes are walked from low to high, so submission order is kept
+		for (uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside)); mask != 0; mask &= mask - 1)
+		{
+			const uint32_t spriteIndex = base + static_cast<uint32_t>(std::countr_zero(mask));
+			if (spriteIndex < last)
+			{
+				visibleSprites[visibleCount++] = spriteIndex;
+			}
+		}
+	}
+#else
+	for (uint32_t spriteIndex = first; spriteIndex < last; ++spriteIndex)
+	{
+		bool inside = true;
+		for (const glm::vec4& plane : planes)
+		{
+			const float distance = plane.x * m_centerX[spriteIndex] + plane.y * m_centerY[spriteIndex] + plane.z * m_centerZ[spriteIndex] + plane.w;
+			const float radius = std::abs(plane.x) * m_extentX[spriteIndex] + std::abs(plane.y) * m_extentY[spriteIndex];
+			inside = inside && distance + radius >= 0.0f;
+		}
+		if (inside)
+		{
+			visibleSprites[visibleCount++] = spriteIndex;
+		}
+	}
+#endif
+
+	return visibleCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+void SpriteCuller::packBounds(const SpriteDrawList& sprites, uint32_t first, uint32_t last)
+{
+	for (uint32_t i = first; i < last; ++i)
+	{
+		//-- Unit quad is centered on transform origin, its box half extents are half sums
+		//-- of transformed quad axes projected on world axes
+		const glm::mat3x2& transform = sprites.m_transforms[i];
+		const glm::vec2    extent = (glm::abs(transform[0]) + glm::abs(transform[1])) * 0.5f;
+
+		m_centerX[i] = transform[2].x;
+		m_centerY[i] = transform[2].y;
+		m_centerZ[i] = sprites.m_depths[i];
+		m_extentX[i] = extent.x;
+		m_extentY[i] = extent.y;
+	}
+}
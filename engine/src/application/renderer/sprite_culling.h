@@ -0,0 +1,60 @@
+#pragma once
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <application/managers/renderer_manager.h>
+#include <application/core/utils/thread_pool.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Planes point inside, point p is in front of plane when dot(plane.xyz, p) + plane.w >= 0
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+//-------------------------------------------------------------------------------------------------
+//-- Vulkan clip space with depth in [0, 1]
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProj);
+
+//-------------------------------------------------------------------------------------------------
+//-- Sprites are tested as world space boxes around their quads. Centers and extents are
+//-- packed into separate arrays first, so planes are tested against four sprites at once.
+//-- Sprites are split into ranges of lane groups, each packed and tested by one thread
+class SpriteCuller
+{
+public:
+	//-- Indices of sprites intersecting the frustum, in submission order
+	void cull(const SpriteDrawList&    sprites
+	          , const glm::mat4&       viewProj
+	          , std::vector<uint32_t>& visibleSprites
+	          , ThreadPool&            threadPool);
+
+private:
+	void packBounds(const SpriteDrawList& sprites, uint32_t first, uint32_t last);
+	//-- Writes visible sprites of [first, last) and returns their count
+	uint32_t testBounds(const FrustumPlanes& planes, uint32_t first, uint32_t last, uint32_t* visibleSprites) const;
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct VisibleRange
+	{
+		uint32_t m_first = 0;
+		uint32_t m_count = 0;
+	};
+
+	//-- Padded to multiple of C_LANES, padding boxes are never reported
+	constexpr static uint32_t C_LANES = 4;
+	//-- Smaller ranges cost more to hand over than to test
+	constexpr static uint32_t C_MIN_GROUPS_PER_TASK = 1024;
+
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	//-- Visible sprites written by every range of the last cull
+	std::vector<VisibleRange> m_visibleRanges;
+};
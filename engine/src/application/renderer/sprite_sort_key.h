@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+//-------------------------------------------------------------------------------------------------
+//-- 64 bit sprite draw order key, most significant field first:
+//--   [63..60] pipeline  - sprite pass, opaque ones are drawn before translucent
+//--   [59..44] layer     - high half of sortable depth bits, smaller first
+//--   [43..28] texture   - TextureCache id
+//--   [27..12] fine depth - low half of sortable depth bits
+//--   [11..0]  material  - per material parameters
+//-- Depth is passed as z for back to front order and as -z for front to back.
+//-- Blended sprites are grouped by texture inside a layer, a bucket of sign, exponent and
+//-- 7 mantissa bits, so sprites interleaved in z batch together and only ones closer than
+//-- 1/128 of their depth may blend in texture order. Depth tested passes have no layer,
+//-- depth test resolves their overlap, so they batch by texture over all depths and high
+//-- depth bits only order them front to back inside a texture
+struct SpriteSortKey
+{
+	constexpr static inline uint32_t C_PIPELINE_SHIFT = 60;
+	constexpr static inline uint32_t C_LAYER_SHIFT = 44;
+	constexpr static inline uint32_t C_TEXTURE_SHIFT = 28;
+	constexpr static inline uint32_t C_FINE_DEPTH_SHIFT = 12;
+	constexpr static inline uint32_t C_MATERIAL_SHIFT = 0;
+
+	constexpr static inline uint64_t C_PIPELINE_MASK = 0xF;
+	constexpr static inline uint64_t C_TEXTURE_MASK = 0xFFFF;
+	constexpr static inline uint32_t C_HALF_DEPTH_BITS = 16;
+	constexpr static inline uint32_t C_HALF_DEPTH_MASK = 0xFFFF;
+	constexpr static inline uint64_t C_MATERIAL_MASK = 0xFFF;
+
+	constexpr static inline uint32_t C_MAX_TEXTURES = C_TEXTURE_MASK + 1;
+
+	//-- Everything that breaks a batch, depth layers break it through texture order only
+	constexpr static inline uint64_t C_BATCH_STATE_MASK = (C_PIPELINE_MASK << C_PIPELINE_SHIFT)
+		| (C_TEXTURE_MASK << C_TEXTURE_SHIFT)
+		| (C_MATERIAL_MASK << C_MATERIAL_SHIFT);
+	//-- Bindless textures are indexed per sprite, so texture only groups sprites
+	constexpr static inline uint64_t C_BINDLESS_BATCH_STATE_MASK = (C_PIPELINE_MASK << C_PIPELINE_SHIFT)
+		| (C_MATERIAL_MASK << C_MATERIAL_SHIFT);
+
+	//-------------------------------------------------------------------------------------------------
+	//-- Float bits reordered so unsigned comparison matches float comparison
+	static uint32_t sortableDepth(float depth)
+	{
+		uint32_t bits = 0;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	static uint64_t make(float depth, uint32_t pipeline, uint32_t texture, uint32_t material, bool depthTested)
+	{
+		const uint32_t depthBits = sortableDepth(depth);
+		const uint64_t layer = depthTested ? 0 : depthBits >> C_HALF_DEPTH_BITS;
+		const uint64_t fineDepth = depthTested ? depthBits >> C_HALF_DEPTH_BITS : depthBits & C_HALF_DEPTH_MASK;
+		return (layer << C_LAYER_SHIFT)
+			| (fineDepth << C_FINE_DEPTH_SHIFT)
+			| ((pipeline & C_PIPELINE_MASK) << C_PIPELINE_SHIFT)
+			| ((texture & C_TEXTURE_MASK) << C_TEXTURE_SHIFT)
+			| ((material & C_MATERIAL_MASK) << C_MATERIAL_SHIFT);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	static uint64_t batchState(uint64_t key, bool bindlessTextures)
+	{
+		return key & (bindlessTextures ? C_BINDLESS_BATCH_STATE_MASK : C_BATCH_STATE_MASK);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	static uint32_t texture(uint64_t key)
+	{
+		return static_cast<uint32_t>((key >> C_TEXTURE_SHIFT) & C_TEXTURE_MASK);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+	static uint32_t pipeline(uint64_t key)
+	{
+		return static_cast<uint32_t>((key >> C_PIPELINE_SHIFT) & C_PIPELINE_MASK);
+	}
+};
@@ -1,152 +1,58 @@
 #include "texture.h"
 
-#include <application/renderer/device.h>
 #include <application/core/utils/engine_assert.h>
 
-#include <stb_image.h>
-
 //-------------------------------------------------------------------------------------------------
-VulkanTexture::VulkanTexture(std::string_view path, std::shared_ptr<VkGraphicDevice> device) : m_device(device)
+VulkanTexture::VulkanTexture(std::string_view path, std::shared_ptr<GraphicDevice> device)
+	: VulkanTexture(loadImageData(path), device)
 {
-	engineAssert(m_device != nullptr, "Device is not initialized yet");
-
-	loadFromFile(path);
-	createVulkanResources();
-	createDescriptorSet();
+	m_path = path;
 }
 
-VulkanTexture::~VulkanTexture()
+//-------------------------------------------------------------------------------------------------
+VulkanTexture::VulkanTexture(ImageData image, std::shared_ptr<GraphicDevice> device)
+	: VulkanTexture(makeTextureData(std::move(image), 1), device)
 {
-	cleanup();
 }
 
 //-------------------------------------------------------------------------------------------------
-void VulkanTexture::loadFromFile(std::string_view path)
+VulkanTexture::VulkanTexture(TextureData texture, std::shared_ptr<GraphicDevice> device) : m_device(device)
 {
-	int width, height, channels;
-	stbi_set_flip_vertically_on_load(true);
-	stbi_uc* pixels = stbi_load(path.data(), &width, &height, &channels, STBI_rgb_alpha);
-
-	engineAssert(pixels != nullptr, std::format("Failed to load texture: {}", path));
-
-	m_width = static_cast<uint32_t>(width);
-	m_height = static_cast<uint32_t>(height);
-
-	size_t imageSize = width * height * 4; // RGBA
-	m_pixelData.resize(imageSize);
-	memcpy(m_pixelData.data(), pixels, imageSize);
-
-	stbi_image_free(pixels);
+	engineAssert(m_device != nullptr, "Device is not initialized yet");
+	engineAssert(texture.isValid(), "Texture has no levels");
+	engineAssert(m_device->supportsTextureFormat(texture.m_format)
+		, std::format("Texture format '{}' isn't supported by device", textureFormatName(texture.m_format)));
+
+	m_width = texture.width();
+	m_height = texture.height();
+	m_mipLevels = static_cast<uint32_t>(texture.m_mips.size());
+	m_format = texture.m_format;
+	m_gpuTexture = m_device->createTexture(texture);
 }
 
-void VulkanTexture::createVulkanResources()
+//-------------------------------------------------------------------------------------------------
+VulkanTexture::VulkanTexture(uint32_t width, uint32_t height, uint32_t mipLevels, std::shared_ptr<GraphicDevice> device)
+	: VulkanTexture(makeTextureData(ImageData{ width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4, 0) }, mipLevels), device)
 {
-	VkDeviceSize imageSize = m_pixelData.size();
-
-	// Create staging buffer
-	vk::Buffer       stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
-	m_device->createBuffer(imageSize
-		, vk::BufferUsageFlagBits::eTransferSrc
-		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		, stagingBuffer
-		, stagingBufferMemory);
-
-	// Copy data to staging buffer
-	void* data;
-	[[maybe_unused]] auto res = m_device->getLogicalDevice().
-		mapMemory(stagingBufferMemory, 0, imageSize, {}, &data);
-
-	memcpy(data, m_pixelData.data(), imageSize);
-	m_device->getLogicalDevice().unmapMemory(stagingBufferMemory);
-
-	// Create VkImage
-	vk::Format vkFormat = vk::Format::eR8G8B8A8Unorm;
-
-	vk::ImageCreateInfo imageInfo = {};
-	imageInfo.setImageType(vk::ImageType::e2D)
-		.setExtent(vk::Extent3D(m_width, m_height, 1))
-		.setMipLevels(1)
-		.setArrayLayers(1)
-		.setFormat(vkFormat)
-		.setTiling(vk::ImageTiling::eOptimal)
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setUsage(vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled)
-		.setSamples(vk::SampleCountFlagBits::e1)
-		.setSharingMode(vk::SharingMode::eExclusive);
-
-	auto [imageRes, image] = m_device->getLogicalDevice().createImage(imageInfo);
-	m_image = image;
-
-	// Allocate memory for texture
-	vk::MemoryRequirements memRequirements = m_device->getLogicalDevice().getImageMemoryRequirements(m_image);
-
-	vk::MemoryAllocateInfo allocInfo = {};
-	allocInfo.setAllocationSize(memRequirements.size)
-		.setMemoryTypeIndex(m_device->findMemoryType(memRequirements.memoryTypeBits
-		, vk::MemoryPropertyFlagBits::eDeviceLocal));
-
-	auto [allocRes, imageMem] = m_device->getLogicalDevice().allocateMemory(allocInfo);
-	m_imageMemory = imageMem;
-	m_device->getLogicalDevice().bindImageMemory(m_image, m_imageMemory, 0);
-
-	// Changing layout to once we need
-	m_device->transitionImage(m_image, vkFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-	m_device->copyBufferToImage(stagingBuffer, m_image, m_width, m_height);
-	m_device->transitionImage(m_image
-		, vkFormat
-		, vk::ImageLayout::eTransferDstOptimal
-		, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	// Cleaning staging
-	m_device->getLogicalDevice().destroyBuffer(stagingBuffer);
-	m_device->getLogicalDevice().freeMemory(stagingBufferMemory);
-
-	// Creating image view
-	vk::ImageViewCreateInfo viewInfo = {};
-	viewInfo.setImage(m_image)
-		.setViewType(vk::ImageViewType::e2D)
-		.setFormat(vkFormat)
-		.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-
-	auto [imageViewRes, imageView] = m_device->getLogicalDevice().createImageView(viewInfo);
-	m_imageView = imageView;
-
-	// Cleaning pixel data
-	m_pixelData.clear();
-	m_pixelData.shrink_to_fit();
 }
 
 //-------------------------------------------------------------------------------------------------
-void VulkanTexture::createDescriptorSet()
+VulkanTexture::~VulkanTexture()
 {
-	m_descriptorSet = m_device->createTextureDescriptorSet(m_image, m_imageView);
+	if (m_device)
+	{
+		m_device->destroyTexture(m_gpuTexture);
+	}
 }
 
-void VulkanTexture::cleanup()
+//-------------------------------------------------------------------------------------------------
+void VulkanTexture::updateRegion(uint32_t x, uint32_t y, const TextureData& region)
 {
-	if (m_device && m_device->getLogicalDevice())
-	{
-		auto& device = m_device->getLogicalDevice();
+	const uint32_t lastLevelTexel = 1u << (m_mipLevels - 1);
+	engineAssert(m_format == TextureFormat::RGBA8 && region.m_format == TextureFormat::RGBA8, "Only RGBA8 texture can be updated");
+	engineAssert(region.m_mips.size() == m_mipLevels, "Texture region has to have all levels of the texture");
+	engineAssert(x % lastLevelTexel == 0 && y % lastLevelTexel == 0, "Texture region isn't aligned to its last level");
+	engineAssert(x + region.width() <= m_width && y + region.height() <= m_height, "Texture region is out of image");
 
-		m_device->freeDescriptorSetFromPool(m_descriptorSet);
-
-		if (m_imageView != VK_NULL_HANDLE)
-		{
-			device.destroyImageView(m_imageView);
-			m_imageView = VK_NULL_HANDLE;
-		}
-
-		if (m_image != VK_NULL_HANDLE)
-		{
-			device.destroyImage(m_image);
-			m_image = VK_NULL_HANDLE;
-		}
-
-		if (m_imageMemory != VK_NULL_HANDLE)
-		{
-			device.freeMemory(m_imageMemory);
-			m_imageMemory = VK_NULL_HANDLE;
-		}
-	}
+	m_device->updateTexture(m_gpuTexture, x, y, region);
 }
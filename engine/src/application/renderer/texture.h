@@ -1,4 +1,3 @@
-#define STB_IMAGE_IMPLEMENTATION
 #pragma once
 
 #define VULKAN_HPP_NO_EXCEPTIONS
@@ -7,44 +6,48 @@
 #include <string>
 #include <vector>
 
-class VkGraphicDevice;
+#include <application/renderer/image_data.h>
+#include <application/renderer/texture_data.h>
+#include <application/renderer/graphic_device.h>
 
 //-------------------------------------------------------------------------------------------------
 class VulkanTexture
 {
 public:
-	VulkanTexture(std::string_view path, std::shared_ptr<VkGraphicDevice> device);
+	VulkanTexture(std::string_view path, std::shared_ptr<GraphicDevice> device);
+	VulkanTexture(ImageData image, std::shared_ptr<GraphicDevice> device);
+	//-- Uploaded as is: all mips in texture format, which device has to support
+	VulkanTexture(TextureData texture, std::shared_ptr<GraphicDevice> device);
+	//-- Transparent RGBA8 texture to be filled by updateRegion, used for atlas pages
+	VulkanTexture(uint32_t width, uint32_t height, uint32_t mipLevels, std::shared_ptr<GraphicDevice> device);
 	~VulkanTexture();
 
 	uint32_t getWidth() const { return m_width; }
 	uint32_t getHeight() const { return m_height; }
+	uint32_t getMipLevels() const { return m_mipLevels; }
+	TextureFormat getFormat() const { return m_format; }
 	std::string_view getPath() const { return m_path; }
 	size_t getMemoryUsage() const { return size_t(); }
 
-	bool isValid() const { return m_image != VK_NULL_HANDLE; }
+	bool isValid() const { return m_gpuTexture.m_image != VK_NULL_HANDLE; }
+	//-- RGBA8 textures only, region has the same levels count as the texture. Its level N is
+	//-- written at x / 2^N, y / 2^N, so x and y have to be multiples of the last level texel
+	void updateRegion(uint32_t x, uint32_t y, const TextureData& region);
 
-	vk::Image getVkImage() const { return m_image; }
-	vk::ImageView getVkImageView() const { return m_imageView; }
-	vk::DescriptorSet getDescriptorSet() const { return m_descriptorSet; }
+	vk::Image getVkImage() const { return m_gpuTexture.m_image; }
+	vk::ImageView getVkImageView() const { return m_gpuTexture.m_imageView; }
+	vk::DescriptorSet getDescriptorSet() const { return m_gpuTexture.m_descriptorSet; }
+	uint32_t getBindlessIndex() const { return m_gpuTexture.m_bindlessIndex; }
+	UploadTicket uploadTicket() const { return m_gpuTexture.m_uploadTicket; }
 
 private:
-	void loadFromFile(std::string_view path);
-	void createVulkanResources();
-	void createDescriptorSet();
-	void cleanup();
-
-private:
-	std::shared_ptr<VkGraphicDevice> m_device;
+	std::shared_ptr<GraphicDevice> m_device;
 	std::string      m_path;
 	uint32_t         m_width = 0;
 	uint32_t         m_height = 0;
+	uint32_t         m_mipLevels = 1;
+	TextureFormat    m_format = TextureFormat::RGBA8;
 
-	// Vulkan resources
-	vk::Image         m_image = VK_NULL_HANDLE;
-	vk::DeviceMemory  m_imageMemory = VK_NULL_HANDLE;
-	vk::ImageView     m_imageView = VK_NULL_HANDLE;
-	vk::DescriptorSet m_descriptorSet = VK_NULL_HANDLE;
-
-	// Texture data
-	std::vector<uint8_t> m_pixelData;
+	//-- Device objects, created by device in constructor
+	GpuTexture m_gpuTexture;
 };
@@ -0,0 +1,210 @@
+#include "texture_atlas.h"
+
+#include <application/core/utils/engine_assert.h>
+#include <application/renderer/atlas_packer.h>
+#include <application/renderer/image_data.h>
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <print>
+#include <sstream>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------------------
+bool isAtlasImageExtension(const fs_path& path)
+{
+	const std::string extension = path.extension().string();
+	return extension == ".png" || extension == ".jpg" || extension == ".tga";
+}
+
+//-------------------------------------------------------------------------------------------------
+ImageData makeAtlasCell(const ImageData& image)
+{
+	constexpr uint32_t C_PADDING = TextureAtlasConfig::C_PADDING;
+	constexpr uint32_t C_ALIGNMENT = TextureAtlasConfig::C_CELL_ALIGNMENT;
+
+	ImageData cell;
+	cell.m_width = (image.m_width + C_PADDING * 2 + C_ALIGNMENT - 1) / C_ALIGNMENT * C_ALIGNMENT;
+	cell.m_height = (image.m_height + C_PADDING * 2 + C_ALIGNMENT - 1) / C_ALIGNMENT * C_ALIGNMENT;
+	cell.m_pixels.resize(static_cast<size_t>(cell.m_width) * cell.m_height * 4);
+
+	for (uint32_t y = 0; y < cell.m_height; ++y)
+	{
+		const uint32_t srcY = std::clamp(static_cast<int64_t>(y) - C_PADDING, int64_t(0), static_cast<int64_t>(image.m_height) - 1);
+		for (uint32_t x = 0; x < cell.m_width; ++x)
+		{
+			const uint32_t srcX = std::clamp(static_cast<int64_t>(x) - C_PADDING, int64_t(0), static_cast<int64_t>(image.m_width) - 1);
+			memcpy(cell.m_pixels.data() + (static_cast<size_t>(y) * cell.m_width + x) * 4
+				, image.m_pixels.data() + (static_cast<size_t>(srcY) * image.m_width + srcX) * 4
+				, 4);
+		}
+	}
+	return cell;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool AtlasLookupTable::load(const VirtualFS& vfs)
+{
+	if (!vfs.isFileExist(TextureAtlasConfig::C_LOOKUP_TABLE_PATH))
+	{
+		return false;
+	}
+
+	std::istringstream in(vfs.loadFile(TextureAtlasConfig::C_LOOKUP_TABLE_PATH).toString());
+	std::string        line;
+	while (std::getline(in, line))
+	{
+		std::istringstream lineStream(line);
+		std::string        tag;
+		lineStream >> tag;
+		if (tag == "page_size")
+		{
+			lineStream >> m_pageSize;
+		}
+		else if (tag == "mip_levels")
+		{
+			lineStream >> m_mipLevels;
+		}
+		else if (tag == "page")
+		{
+			lineStream >> std::quoted(m_pages.emplace_back());
+		}
+		else if (tag == "image")
+		{
+			AtlasEntry& entry = m_entries.emplace_back();
+			lineStream >> std::quoted(entry.m_imagePath)
+				>> entry.m_page
+				>> entry.m_x
+				>> entry.m_y
+				>> entry.m_width
+				>> entry.m_height;
+
+			std::string alphaMode;
+			if (lineStream >> alphaMode)
+			{
+				entry.m_alphaMode = parseAlphaMode(alphaMode).value_or(AlphaMode::Translucent);
+			}
+			engineAssert(entry.m_page < m_pages.size(), std::format("Atlas entry '{}' has no page", entry.m_imagePath));
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void AtlasLookupTable::save(const VirtualFS& vfs) const
+{
+	std::ostringstream out;
+	out << "page_size " << m_pageSize << '\n';
+	out << "mip_levels " << m_mipLevels << '\n';
+	for (const auto& page : m_pages)
+	{
+		out << "page " << std::quoted(page) << '\n';
+	}
+	for (const auto& entry : m_entries)
+	{
+		out << "image " << std::quoted(entry.m_imagePath)
+			<< ' ' << entry.m_page
+			<< ' ' << entry.m_x
+			<< ' ' << entry.m_y
+			<< ' ' << entry.m_width
+			<< ' ' << entry.m_height
+			<< ' ' << alphaModeName(entry.m_alphaMode) << '\n';
+	}
+
+	const std::string text = out.str();
+	File file = vfs.createFile(TextureAtlasConfig::C_LOOKUP_TABLE_PATH);
+	file.m_buffer.assign(text.begin(), text.end());
+	vfs.writeFile(file);
+}
+
+//-------------------------------------------------------------------------------------------------
+void cookTextureAtlas(const VirtualFS& vfs, const fs_path& imagesDir)
+{
+	constexpr uint32_t C_PAGE_SIZE = TextureAtlasConfig::C_PAGE_SIZE;
+	constexpr uint32_t C_MAX_IMAGE_SIZE = TextureAtlasConfig::C_MAX_ATLAS_IMAGE_SIZE;
+
+	struct CookImage
+	{
+		std::string m_path;
+		ImageData   m_image;
+	};
+
+	//-- Collect small images, pages themselves are never packed again
+	std::vector<CookImage> images;
+	const fs_path          nativeImagesDir = vfs.virtualToNativePath(imagesDir);
+	engineAssert(std::filesystem::is_directory(nativeImagesDir)
+		, std::format("Atlas images dir '{}' doesn't exist", nativeImagesDir.generic_string()));
+	for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(nativeImagesDir))
+	{
+		if (!dirEntry.is_regular_file() || !isAtlasImageExtension(dirEntry.path()))
+		{
+			continue;
+		}
+
+		ImageData image = loadImageData(dirEntry.path().string());
+		if (image.m_width > C_MAX_IMAGE_SIZE || image.m_height > C_MAX_IMAGE_SIZE)
+		{
+			continue;
+		}
+
+		const fs_path relativePath = std::filesystem::relative(dirEntry.path(), nativeImagesDir);
+		images.push_back({ normalizePath(imagesDir / relativePath), std::move(image) });
+	}
+
+	//-- Tall images first gives skyline flatter levels
+	std::ranges::sort(images, [](const CookImage& lhs, const CookImage& rhs)
+		{
+			if (lhs.m_image.m_height != rhs.m_image.m_height)
+			{
+				return lhs.m_image.m_height > rhs.m_image.m_height;
+			}
+			return lhs.m_path < rhs.m_path;
+		});
+
+	AtlasLookupTable           table;
+	table.m_mipLevels = TextureAtlasConfig::C_MIP_LEVELS;
+	std::vector<SkylinePacker> packers;
+	std::vector<ImageData>     pages;
+	for (const auto& [path, image] : images)
+	{
+		std::optional<AtlasRect> rect;
+		uint32_t                 page = 0;
+		for (; page < packers.size() && !rect; ++page)
+		{
+			rect = packers[page].insert(image.m_width, image.m_height);
+		}
+		if (rect)
+		{
+			--page;
+		}
+		else
+		{
+			packers.emplace_back(C_PAGE_SIZE, C_PAGE_SIZE, TextureAtlasConfig::C_PADDING, TextureAtlasConfig::C_CELL_ALIGNMENT);
+			ImageData& pageImage = pages.emplace_back();
+			pageImage.m_width = C_PAGE_SIZE;
+			pageImage.m_height = C_PAGE_SIZE;
+			pageImage.m_pixels.resize(static_cast<size_t>(C_PAGE_SIZE) * C_PAGE_SIZE * 4, 0);
+
+			page = static_cast<uint32_t>(packers.size() - 1);
+			rect = packers[page].insert(image.m_width, image.m_height);
+			engineAssert(rect.has_value(), std::format("Image '{}' doesn't fit into empty atlas page", path));
+		}
+
+		blitImage(pages[page], makeAtlasCell(image), rect->m_x - TextureAtlasConfig::C_PADDING, rect->m_y - TextureAtlasConfig::C_PADDING);
+		table.m_entries.push_back({ path, page, rect->m_x, rect->m_y, rect->m_width, rect->m_height, classifyImageAlpha(image) });
+	}
+
+	std::filesystem::create_directories(vfs.virtualToNativePath(TextureAtlasConfig::C_COOKED_DIR));
+	for (uint32_t page = 0; page < pages.size(); ++page)
+	{
+		const std::string pagePath = std::format("{}/page_{}.tga", TextureAtlasConfig::C_COOKED_DIR, page);
+		writeImageTga(pages[page], vfs.virtualToNativePath(pagePath));
+		table.m_pages.push_back(pagePath);
+
+		std::println("Atlas page {}: {:.1f}% occupied", pagePath, packers[page].occupancy() * 100.0f);
+	}
+	table.save(vfs);
+
+	std::println("Atlas cooked: {} images into {} pages", table.m_entries.size(), table.m_pages.size());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/image_data.h>
+
+//-------------------------------------------------------------------------------------------------
+//-- Atlas page is square, images bigger than C_MAX_ATLAS_IMAGE_SIZE stay standalone textures.
+//-- Pages keep C_MIP_LEVELS levels, so sprites minified up to 8x are filtered like standalone
+//-- ones. Every image cell starts at a multiple of the last level texel and is surrounded by
+//-- C_PADDING of its own edge texels, so no level blends neighbour images. Price is a third
+//-- more memory per page and padding around small images; sprites minified further than the
+//-- chain covers alias, images expected to be drawn that small should be cooked standalone
+struct TextureAtlasConfig
+{
+	constexpr static inline uint32_t C_PAGE_SIZE = 2048;
+	constexpr static inline uint32_t C_MAX_ATLAS_IMAGE_SIZE = 512;
+	constexpr static inline uint32_t C_MIP_LEVELS = 4;
+	constexpr static inline uint32_t C_CELL_ALIGNMENT = 1u << (C_MIP_LEVELS - 1);
+	//-- Last level still has one texel of extrusion around the image
+	constexpr static inline uint32_t C_PADDING = C_CELL_ALIGNMENT;
+
+	constexpr static inline auto C_COOKED_DIR = "atlas";
+	constexpr static inline auto C_LOOKUP_TABLE_PATH = "atlas/atlas.table";
+};
+
+//-------------------------------------------------------------------------------------------------
+struct AtlasEntry
+{
+	std::string m_imagePath;
+	uint32_t    m_page = 0;
+	uint32_t    m_x = 0;
+	uint32_t    m_y = 0;
+	uint32_t    m_width = 0;
+	uint32_t    m_height = 0;
+	//-- Of the image itself, page holds images of every mode
+	AlphaMode   m_alphaMode = AlphaMode::Translucent;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Result of cooking, text format:
+//--   page "atlas/page_0.tga"
+//--   image "images/gg2.png" <page> <x> <y> <width> <height> <opaque|cutout|translucent>
+//--   mip_levels <count>
+//-- Tables cooked without alpha mode load their images as translucent, tables without mip
+//-- levels were packed without extrusion and their pages are sampled as one level
+struct AtlasLookupTable
+{
+	bool load(const VirtualFS& vfs);
+	void save(const VirtualFS& vfs) const;
+
+	uint32_t                 m_pageSize = TextureAtlasConfig::C_PAGE_SIZE;
+	uint32_t                 m_mipLevels = 1;
+	std::vector<std::string> m_pages;
+	std::vector<AtlasEntry>  m_entries;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Source image formats picked up by cooking
+bool isAtlasImageExtension(const fs_path& path);
+//-- Image in the middle of its page cell with edge texels repeated up to cell border. Cell
+//-- goes to page at image rect returned by packer minus C_PADDING
+ImageData makeAtlasCell(const ImageData& image);
+//-- Offline mode: packs every small image from imagesDir into pages written next to lookup table
+void cookTextureAtlas(const VirtualFS& vfs, const fs_path& imagesDir);
@@ -0,0 +1,351 @@
+#include "texture_data.h"
+
+#include <application/core/utils/engine_assert.h>
+#include <application/renderer/block_compression.h>
+#include <application/renderer/texture_atlas.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <print>
+
+//-------------------------------------------------------------------------------------------------
+//-- "STEX" in file byte order
+constexpr uint32_t C_CONTAINER_MAGIC = 0x58455453;
+//-- Version 2 stores alpha mode, older containers are cooked again
+constexpr uint32_t C_CONTAINER_VERSION = 2;
+constexpr uint32_t C_BLOCK_SIZE = 4;
+constexpr uint32_t C_BLOCK_BYTES = 16;
+
+//-------------------------------------------------------------------------------------------------
+struct TextureContainerHeader
+{
+	uint32_t m_magic = C_CONTAINER_MAGIC;
+	uint32_t m_version = C_CONTAINER_VERSION;
+	uint32_t m_format = 0;
+	uint32_t m_mipsCount = 0;
+	uint32_t m_alphaMode = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+struct TextureFormatInfo
+{
+	TextureFormat    m_format;
+	std::string_view m_name;
+};
+
+constexpr std::array<TextureFormatInfo, static_cast<size_t>(TextureFormat::Count)> C_TEXTURE_FORMATS =
+{
+	TextureFormatInfo{ TextureFormat::RGBA8, "rgba8" }
+	, TextureFormatInfo{ TextureFormat::BC3, "bc3" }
+	, TextureFormatInfo{ TextureFormat::BC7, "bc7" }
+	, TextureFormatInfo{ TextureFormat::ASTC4x4, "astc4x4" }
+};
+
+//-------------------------------------------------------------------------------------------------
+bool isBlockCompressed(TextureFormat format)
+{
+	return format != TextureFormat::RGBA8;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+	if (!isBlockCompressed(format))
+	{
+		return static_cast<uint64_t>(width) * height * 4;
+	}
+
+	//-- Partial edge blocks are stored whole
+	const uint64_t blocksX = (width + C_BLOCK_SIZE - 1) / C_BLOCK_SIZE;
+	const uint64_t blocksY = (height + C_BLOCK_SIZE - 1) / C_BLOCK_SIZE;
+	return blocksX * blocksY * C_BLOCK_BYTES;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<TextureFormat> parseTextureFormat(std::string_view name)
+{
+	for (const auto& info : C_TEXTURE_FORMATS)
+	{
+		if (info.m_name == name)
+		{
+			return info.m_format;
+		}
+	}
+	return std::nullopt;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string_view textureFormatName(TextureFormat format)
+{
+	return C_TEXTURE_FORMATS[static_cast<size_t>(format)].m_name;
+}
+
+//-------------------------------------------------------------------------------------------------
+fs_path cookedTexturePath(const fs_path& imagePath)
+{
+	fs_path path = fs_path(TextureCookConfig::C_COOKED_DIR) / imagePath;
+	path += TextureCookConfig::C_CONTAINER_EXTENSION;
+	return normalizePath(path);
+}
+
+//-------------------------------------------------------------------------------------------------
+//-- Half size level, odd edge texel is clamped. Colors are weighted by alpha, so transparent
+//-- texels don't darken sprite edges
+ImageData downsampleImage(const ImageData& image)
+{
+	ImageData result;
+	result.m_width = std::max(image.m_width / 2, 1u);
+	result.m_height = std::max(image.m_height / 2, 1u);
+	result.m_pixels.resize(static_cast<size_t>(result.m_width) * result.m_height * 4);
+
+	for (uint32_t y = 0; y < result.m_height; ++y)
+	{
+		for (uint32_t x = 0; x < result.m_width; ++x)
+		{
+			std::array<uint32_t, 4> sum = {};
+			for (uint32_t sample = 0; sample < 4; ++sample)
+			{
+				const uint32_t srcX = std::min(x * 2 + sample % 2, image.m_width - 1);
+				const uint32_t srcY = std::min(y * 2 + sample / 2, image.m_height - 1);
+				const uint8_t* texel = image.m_pixels.data() + (static_cast<size_t>(srcY) * image.m_width + srcX) * 4;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					sum[c] += texel[c] * texel[3];
+				}
+				sum[3] += texel[3];
+			}
+
+			uint8_t* texel = result.m_pixels.data() + (static_cast<size_t>(y) * result.m_width + x) * 4;
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				texel[c] = sum[3] == 0 ? 0 : static_cast<uint8_t>((sum[c] + sum[3] / 2) / sum[3]);
+			}
+			texel[3] = static_cast<uint8_t>((sum[3] + 2) / 4);
+		}
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+void appendTextureLevel(TextureData& texture, uint32_t width, uint32_t height, const uint8_t* data, uint64_t size)
+{
+	texture.m_mips.push_back({ width, height, texture.m_data.size(), size });
+	texture.m_data.insert(texture.m_data.end(), data, data + size);
+}
+
+//-------------------------------------------------------------------------------------------------
+TextureData makeTextureData(ImageData image, uint32_t maxMipLevels)
+{
+	TextureData texture;
+	texture.m_format = TextureFormat::RGBA8;
+	texture.m_alphaMode = classifyImageAlpha(image);
+	appendTextureLevel(texture, image.m_width, image.m_height, image.m_pixels.data(), image.m_pixels.size());
+
+	//-- Every level is filtered from the previous one
+	while (texture.m_mips.size() < maxMipLevels && (image.m_width > 1 || image.m_height > 1))
+	{
+		image = downsampleImage(image);
+		appendTextureLevel(texture, image.m_width, image.m_height, image.m_pixels.data(), image.m_pixels.size());
+	}
+	return texture;
+}
+
+//-------------------------------------------------------------------------------------------------
+TextureData compressTextureData(const TextureData& texture, TextureFormat format)
+{
+	engineAssert(texture.m_format == TextureFormat::RGBA8, "Only RGBA8 texture can be compressed");
+	engineAssert(format == TextureFormat::BC3 || format == TextureFormat::BC7
+		, std::format("No encoder for texture format '{}'", textureFormatName(format)));
+
+	const auto encodeBlock = format == TextureFormat::BC7 ? encodeBC7Block : encodeBC3Block;
+
+	TextureData result;
+	result.m_format = format;
+	result.m_alphaMode = texture.m_alphaMode;
+	for (const auto& mip : texture.m_mips)
+	{
+		const uint8_t* pixels = texture.m_data.data() + mip.m_offset;
+		const uint32_t blocksX = (mip.m_width + C_BLOCK_SIZE - 1) / C_BLOCK_SIZE;
+		const uint32_t blocksY = (mip.m_height + C_BLOCK_SIZE - 1) / C_BLOCK_SIZE;
+
+		std::vector<uint8_t> blocks(textureLevelSize(format, mip.m_width, mip.m_height));
+		for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+			{
+				//-- Texels out of the level repeat the edge, decoded tail isn't sampled anyway
+				std::array<uint8_t, C_BLOCK_SIZE * C_BLOCK_SIZE * 4> blockPixels = {};
+				for (uint32_t y = 0; y < C_BLOCK_SIZE; ++y)
+				{
+					for (uint32_t x = 0; x < C_BLOCK_SIZE; ++x)
+					{
+						const uint32_t srcX = std::min(blockX * C_BLOCK_SIZE + x, mip.m_width - 1);
+						const uint32_t srcY = std::min(blockY * C_BLOCK_SIZE + y, mip.m_height - 1);
+						memcpy(blockPixels.data() + (y * C_BLOCK_SIZE + x) * 4
+							, pixels + (static_cast<size_t>(srcY) * mip.m_width + srcX) * 4
+							, 4);
+					}
+				}
+				encodeBlock(blockPixels.data(), blocks.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * C_BLOCK_BYTES);
+			}
+		}
+		appendTextureLevel(result, mip.m_width, mip.m_height, blocks.data(), blocks.size());
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::optional<TextureData> loadTextureContainer(const fs_path& path)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in)
+	{
+		return std::nullopt;
+	}
+
+	TextureContainerHeader header;
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!in
+		|| header.m_magic != C_CONTAINER_MAGIC
+		|| header.m_version != C_CONTAINER_VERSION
+		|| header.m_format >= static_cast<uint32_t>(TextureFormat::Count)
+		|| header.m_mipsCount == 0
+		|| header.m_alphaMode > static_cast<uint32_t>(AlphaMode::Translucent))
+	{
+		return std::nullopt;
+	}
+
+	//-- Level 0 defines the chain, mips count is bounded by it before the table is allocated
+	TextureMip firstMip;
+	in.read(reinterpret_cast<char*>(&firstMip), sizeof(firstMip));
+	if (!in
+		|| firstMip.m_width == 0
+		|| firstMip.m_height == 0
+		|| header.m_mipsCount > static_cast<uint32_t>(std::bit_width(std::max(firstMip.m_width, firstMip.m_height))))
+	{
+		return std::nullopt;
+	}
+
+	TextureData texture;
+	texture.m_format = static_cast<TextureFormat>(header.m_format);
+	texture.m_alphaMode = static_cast<AlphaMode>(header.m_alphaMode);
+	texture.m_mips.resize(header.m_mipsCount);
+	texture.m_mips[0] = firstMip;
+	in.read(reinterpret_cast<char*>(texture.m_mips.data() + 1), (texture.m_mips.size() - 1) * sizeof(TextureMip));
+	if (!in)
+	{
+		return std::nullopt;
+	}
+
+	//-- Levels form a mip chain and follow each other, upload copies regions by this table
+	uint64_t dataSize = 0;
+	for (uint32_t level = 0; level < texture.m_mips.size(); ++level)
+	{
+		const TextureMip& mip = texture.m_mips[level];
+		if (mip.m_width != std::max(1u, firstMip.m_width >> level)
+			|| mip.m_height != std::max(1u, firstMip.m_height >> level)
+			|| mip.m_offset != dataSize
+			|| mip.m_size != textureLevelSize(texture.m_format, mip.m_width, mip.m_height))
+		{
+			return std::nullopt;
+		}
+		dataSize += mip.m_size;
+	}
+
+	//-- Damaged level 0 size can't ask for more memory than the file holds
+	const std::streampos dataStart = in.tellg();
+	in.seekg(0, std::ios::end);
+	if (static_cast<uint64_t>(in.tellg() - dataStart) < dataSize)
+	{
+		return std::nullopt;
+	}
+	in.seekg(dataStart);
+
+	texture.m_data.resize(dataSize);
+	in.read(reinterpret_cast<char*>(texture.m_data.data()), dataSize);
+	if (!in)
+	{
+		return std::nullopt;
+	}
+	return texture;
+}
+
+//-------------------------------------------------------------------------------------------------
+void saveTextureContainer(const TextureData& texture, const fs_path& path)
+{
+	TextureContainerHeader header;
+	header.m_format = static_cast<uint32_t>(texture.m_format);
+	header.m_mipsCount = static_cast<uint32_t>(texture.m_mips.size());
+	header.m_alphaMode = static_cast<uint32_t>(texture.m_alphaMode);
+
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+	engineAssert(out.is_open(), std::format("Failed to write texture: {}", path.generic_string()));
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(texture.m_mips.data()), texture.m_mips.size() * sizeof(TextureMip));
+	out.write(reinterpret_cast<const char*>(texture.m_data.data()), texture.m_data.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+void cookTexture(const VirtualFS& vfs, const fs_path& imagePath, TextureFormat format, uint32_t maxMipLevels)
+{
+	TextureData texture = makeTextureData(loadImageData(vfs.virtualToNativePath(imagePath).string()), maxMipLevels);
+	if (format != TextureFormat::RGBA8)
+	{
+		texture = compressTextureData(texture, format);
+	}
+
+	saveTextureContainer(texture, vfs.virtualToNativePath(cookedTexturePath(imagePath)));
+	std::println("Texture {}: {}x{}, {} mips, {}, {:.1f} KB"
+		, normalizePath(imagePath)
+		, texture.width()
+		, texture.height()
+		, texture.m_mips.size()
+		, alphaModeName(texture.m_alphaMode)
+		, texture.m_data.size() / 1024.0);
+}
+
+//-------------------------------------------------------------------------------------------------
+void cookTextures(const VirtualFS& vfs, const fs_path& imagesDir, TextureFormat format)
+{
+	engineAssert(format != TextureFormat::ASTC4x4, "ASTC textures have to be encoded by external tool");
+
+	//-- Images packed into cooked atlas are sampled from pages only
+	AtlasLookupTable atlas;
+	atlas.load(vfs);
+
+	uint32_t      cookedCount = 0;
+	const fs_path nativeImagesDir = vfs.virtualToNativePath(imagesDir);
+	engineAssert(std::filesystem::is_directory(nativeImagesDir)
+		, std::format("Texture images dir '{}' doesn't exist", nativeImagesDir.generic_string()));
+	for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(nativeImagesDir))
+	{
+		if (!dirEntry.is_regular_file() || !isAtlasImageExtension(dirEntry.path()))
+		{
+			continue;
+		}
+
+		const std::string imagePath = normalizePath(imagesDir / std::filesystem::relative(dirEntry.path(), nativeImagesDir));
+		const bool        inAtlas = std::ranges::any_of(atlas.m_entries, [&imagePath](const AtlasEntry& entry)
+			{
+				return entry.m_imagePath == imagePath;
+			});
+		if (!inAtlas)
+		{
+			cookTexture(vfs, imagePath, format, C_FULL_MIP_CHAIN);
+			++cookedCount;
+		}
+	}
+
+	for (const auto& page : atlas.m_pages)
+	{
+		cookTexture(vfs, page, format, atlas.m_mipLevels);
+		++cookedCount;
+	}
+
+	std::println("Textures cooked: {} into {} format", cookedCount, textureFormatName(format));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/image_data.h>
+
+//-------------------------------------------------------------------------------------------------
+enum class TextureFormat : uint8_t
+{
+	RGBA8,
+	//-- 4x4 blocks of 16 bytes, BC7 is decoded with better quality for the same size
+	BC3,
+	BC7,
+	//-- Accepted from containers only, there is no encoder for it
+	ASTC4x4,
+
+	Count
+};
+
+//-------------------------------------------------------------------------------------------------
+struct TextureMip
+{
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	//-- Range of TextureData::m_data
+	uint64_t m_offset = 0;
+	uint64_t m_size = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Texture as it goes to GPU: all mip levels packed one after another, level 0 first
+struct TextureData
+{
+	bool isValid() const { return !m_mips.empty(); }
+	uint32_t width() const { return m_mips.front().m_width; }
+	uint32_t height() const { return m_mips.front().m_height; }
+
+	TextureFormat           m_format = TextureFormat::RGBA8;
+	//-- Classified from level 0 before compression, block formats don't keep exact alpha
+	AlphaMode               m_alphaMode = AlphaMode::Translucent;
+	std::vector<TextureMip> m_mips;
+	std::vector<uint8_t>    m_data;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Cooked textures mirror source image paths: "images/a.png" -> "textures/images/a.png.stex"
+struct TextureCookConfig
+{
+	constexpr static inline auto C_COOKED_DIR = "textures";
+	constexpr static inline auto C_CONTAINER_EXTENSION = ".stex";
+};
+
+//-------------------------------------------------------------------------------------------------
+bool isBlockCompressed(TextureFormat format);
+uint64_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+std::optional<TextureFormat> parseTextureFormat(std::string_view name);
+std::string_view textureFormatName(TextureFormat format);
+fs_path cookedTexturePath(const fs_path& imagePath);
+
+//-------------------------------------------------------------------------------------------------
+//-- Levels down to 1x1
+constexpr uint32_t C_FULL_MIP_CHAIN = std::numeric_limits<uint32_t>::max();
+//-- RGBA8 texture, levels after the first one are built with 2x2 box filter
+TextureData makeTextureData(ImageData image, uint32_t maxMipLevels);
+//-- Every level of RGBA8 texture is encoded to BC3 or BC7
+TextureData compressTextureData(const TextureData& texture, TextureFormat format);
+
+//-------------------------------------------------------------------------------------------------
+//-- Binary container: header, mip table and levels data as GPU expects it
+std::optional<TextureData> loadTextureContainer(const fs_path& path);
+void saveTextureContainer(const TextureData& texture, const fs_path& path);
+
+//-------------------------------------------------------------------------------------------------
+//-- Offline mode: every image of imagesDir gets mips and is encoded into container under
+//-- C_COOKED_DIR. Cooked atlas pages are encoded with levels their lookup table was packed for
+void cookTextures(const VirtualFS& vfs, const fs_path& imagesDir, TextureFormat format);
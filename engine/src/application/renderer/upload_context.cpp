@@ -0,0 +1,549 @@
+#include "upload_context.h"
+
+#include <application/core/utils/engine_assert.h>
+
+#include <cstring>
+#include <format>
+
+//-------------------------------------------------------------------------------------------------
+constexpr vk::DeviceSize C_BYTES_PER_TEXEL = 4;
+//-- Anything that may consume uploaded buffer data in a frame
+constexpr vk::PipelineStageFlags C_BUFFER_READ_STAGES = vk::PipelineStageFlagBits::eVertexInput
+	| vk::PipelineStageFlagBits::eVertexShader
+	| vk::PipelineStageFlagBits::eFragmentShader;
+constexpr vk::AccessFlags C_BUFFER_READ_ACCESS = vk::AccessFlagBits::eIndexRead
+	| vk::AccessFlagBits::eVertexAttributeRead
+	| vk::AccessFlagBits::eUniformRead
+	| vk::AccessFlagBits::eShaderRead;
+
+//-------------------------------------------------------------------------------------------------
+vk::Format textureVkFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::RGBA8: return vk::Format::eR8G8B8A8Unorm;
+	case TextureFormat::BC3: return vk::Format::eBc3UnormBlock;
+	case TextureFormat::BC7: return vk::Format::eBc7UnormBlock;
+	case TextureFormat::ASTC4x4: return vk::Format::eAstc4x4UnormBlock;
+	default: break;
+	}
+	engineAssert(false, "Unknown texture format");
+	return vk::Format::eUndefined;
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::UploadContext(vk::Device device, GpuMemoryAllocator& allocator, const UploadQueues& queues)
+	: m_device(device)
+	, m_allocator(allocator)
+	, m_queues(queues)
+{
+	auto createCommandPool = [this](uint32_t queueFamily)
+	{
+		vk::CommandPoolCreateInfo poolInfo = {};
+		poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+			.setQueueFamilyIndex(queueFamily);
+
+		auto [res, commandPool] = m_device.createCommandPool(poolInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to create upload command pool");
+		return commandPool;
+	};
+
+	auto allocateCommandBuffers = [this](vk::CommandPool commandPool)
+	{
+		vk::CommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.setCommandPool(commandPool)
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandBufferCount(C_BATCHES_COUNT);
+
+		auto [res, commandBuffers] = m_device.allocateCommandBuffers(allocateInfo);
+		engineAssert(res == vk::Result::eSuccess, "Failed to allocate upload command buffers");
+		return commandBuffers;
+	};
+
+	m_graphicCommandPool = createCommandPool(m_queues.m_graphicFamily);
+	const auto graphicCommands = allocateCommandBuffers(m_graphicCommandPool);
+
+	std::vector<vk::CommandBuffer> transferCommands(C_BATCHES_COUNT);
+	if (hasTransferQueue())
+	{
+		m_transferCommandPool = createCommandPool(m_queues.m_transferFamily);
+		transferCommands = allocateCommandBuffers(m_transferCommandPool);
+	}
+
+	for (uint32_t i = 0; i < C_BATCHES_COUNT; ++i)
+	{
+		UploadBatch& batch = m_batches[i];
+		batch.m_graphicCommands = graphicCommands[i];
+		batch.m_transferCommands = transferCommands[i];
+		{
+			auto [res, semaphore] = m_device.createSemaphore(vk::SemaphoreCreateInfo());
+			engineAssert(res == vk::Result::eSuccess, "Failed to createSemaphore");
+			batch.m_transferFinished = semaphore;
+		}
+		{
+			auto [res, fence] = m_device.createFence(vk::FenceCreateInfo());
+			engineAssert(res == vk::Result::eSuccess, "Failed to createFence");
+			batch.m_fence = fence;
+		}
+	}
+
+	m_stagingRing = createStagingBuffer(C_STAGING_RING_SIZE);
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::~UploadContext()
+{
+	//-- Recorded but not submitted commands are dropped together with their pools
+	while (oldestSubmittedBatch() != nullptr)
+	{
+		retireBatches(true);
+	}
+
+	for (auto& batch : m_batches)
+	{
+		for (auto& staging : batch.m_oversizedStaging)
+		{
+			destroyStagingBuffer(staging);
+		}
+		m_device.destroySemaphore(batch.m_transferFinished);
+		m_device.destroyFence(batch.m_fence);
+	}
+	destroyStagingBuffer(m_stagingRing);
+
+	m_device.destroyCommandPool(m_graphicCommandPool);
+	if (m_transferCommandPool)
+	{
+		m_device.destroyCommandPool(m_transferCommandPool);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadTicket UploadContext::uploadBuffer(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size)
+{
+	//-- Staging first, full ring may submit the batch being recorded
+	const StagingRegion staging = allocateStaging(size);
+	std::memcpy(staging.m_data, data, size);
+
+	UploadBatch& batch = recordingBatch();
+
+	vk::BufferCopy bufferCopy = {};
+	bufferCopy.setSrcOffset(staging.m_offset)
+		.setDstOffset(dstOffset)
+		.setSize(size);
+
+	vk::BufferMemoryBarrier barrier = {};
+	barrier.setBuffer(dstBuffer)
+		.setOffset(dstOffset)
+		.setSize(size)
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(C_BUFFER_READ_ACCESS)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+
+	if (hasTransferQueue())
+	{
+		batch.m_transferCommands.copyBuffer(staging.m_buffer, dstBuffer, bufferCopy);
+
+		//-- Ownership transfer, release half carries only source access
+		barrier.setSrcQueueFamilyIndex(m_queues.m_transferFamily)
+			.setDstQueueFamilyIndex(m_queues.m_graphicFamily);
+
+		vk::BufferMemoryBarrier release = barrier;
+		release.setDstAccessMask({});
+		batch.m_transferCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer
+			, vk::PipelineStageFlagBits::eBottomOfPipe
+			, {}
+			, {}
+			, release
+			, {});
+
+		vk::BufferMemoryBarrier acquire = barrier;
+		acquire.setSrcAccessMask({});
+		batch.m_graphicCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe
+			, C_BUFFER_READ_STAGES
+			, {}
+			, {}
+			, acquire
+			, {});
+
+		batch.m_transferUsed = true;
+	}
+	else
+	{
+		batch.m_graphicCommands.copyBuffer(staging.m_buffer, dstBuffer, bufferCopy);
+		batch.m_graphicCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer
+			, C_BUFFER_READ_STAGES
+			, {}
+			, {}
+			, barrier
+			, {});
+	}
+
+	return batch.m_ticket;
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadTicket UploadContext::uploadImage(vk::Image         image
+                                        , vk::ImageLayout oldLayout
+                                        , const void*     pixels
+                                        , uint32_t        width
+                                        , uint32_t        height
+                                        , uint32_t        offsetX
+                                        , uint32_t        offsetY)
+{
+	const vk::DeviceSize size = static_cast<vk::DeviceSize>(width) * height * C_BYTES_PER_TEXEL;
+	const StagingRegion  staging = allocateStaging(size);
+	std::memcpy(staging.m_data, pixels, size);
+
+	vk::BufferImageCopy region = {};
+	region.setBufferOffset(staging.m_offset)
+		.setBufferRowLength(0)
+		.setBufferImageHeight(0)
+		.setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+		.setImageOffset({ static_cast<int32_t>(offsetX), static_cast<int32_t>(offsetY), 0 })
+		.setImageExtent({ width, height, 1 });
+
+	UploadBatch& batch = recordingBatch();
+	recordImageCopy(batch, image, oldLayout, staging.m_buffer, region, 1);
+
+	return batch.m_ticket;
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadTicket UploadContext::uploadTexture(vk::Image            image
+                                          , const TextureData& texture
+                                          , vk::ImageLayout    oldLayout
+                                          , uint32_t           offsetX
+                                          , uint32_t           offsetY)
+{
+	const StagingRegion staging = allocateStaging(texture.m_data.size());
+	std::memcpy(staging.m_data, texture.m_data.data(), texture.m_data.size());
+
+	//-- Mips are packed tightly, block compressed rows are whole blocks as copy expects
+	std::vector<vk::BufferImageCopy> regions;
+	regions.reserve(texture.m_mips.size());
+	for (uint32_t level = 0; level < texture.m_mips.size(); ++level)
+	{
+		const TextureMip& mip = texture.m_mips[level];
+		regions.push_back(vk::BufferImageCopy()
+			.setBufferOffset(staging.m_offset + mip.m_offset)
+			.setBufferRowLength(0)
+			.setBufferImageHeight(0)
+			.setImageSubresource({ vk::ImageAspectFlagBits::eColor, level, 0, 1 })
+			.setImageOffset({ static_cast<int32_t>(offsetX >> level), static_cast<int32_t>(offsetY >> level), 0 })
+			.setImageExtent({ mip.m_width, mip.m_height, 1 }));
+	}
+
+	UploadBatch& batch = recordingBatch();
+	recordImageCopy(batch, image, oldLayout, staging.m_buffer, regions, static_cast<uint32_t>(regions.size()));
+
+	return batch.m_ticket;
+}
+
+//-------------------------------------------------------------------------------------------------
+void UploadContext::recordImageCopy(UploadBatch&                                       batch
+                                    , vk::Image                                        image
+                                    , vk::ImageLayout                                  oldLayout
+                                    , vk::Buffer                                       stagingBuffer
+                                    , vk::ArrayProxy<const vk::BufferImageCopy> const& regions
+                                    , uint32_t                                         mipLevels)
+{
+	//-- Fresh image has no owner yet, so it can be filled on transfer queue
+	const bool        onTransferQueue = hasTransferQueue() && oldLayout == vk::ImageLayout::eUndefined;
+	vk::CommandBuffer commands = onTransferQueue ? batch.m_transferCommands : batch.m_graphicCommands;
+	const vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1);
+
+	vk::ImageMemoryBarrier toTransferDst = {};
+	toTransferDst.setOldLayout(oldLayout)
+		.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setImage(image)
+		.setSubresourceRange(colorRange)
+		.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+
+	vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
+	if (oldLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
+	{
+		//-- Partial update of sampled image, previous frames reads have to finish first
+		toTransferDst.setSrcAccessMask(vk::AccessFlagBits::eShaderRead);
+		srcStage = vk::PipelineStageFlagBits::eFragmentShader;
+	}
+	commands.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, toTransferDst);
+
+	commands.copyBufferToImage(stagingBuffer, image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+	vk::ImageMemoryBarrier toShaderRead = {};
+	toShaderRead.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setImage(image)
+		.setSubresourceRange(colorRange)
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+	if (onTransferQueue)
+	{
+		//-- Layout transition happens once, both halves of ownership transfer describe it
+		toShaderRead.setSrcQueueFamilyIndex(m_queues.m_transferFamily)
+			.setDstQueueFamilyIndex(m_queues.m_graphicFamily);
+
+		vk::ImageMemoryBarrier release = toShaderRead;
+		release.setDstAccessMask({});
+		batch.m_transferCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer
+			, vk::PipelineStageFlagBits::eBottomOfPipe
+			, {}
+			, {}
+			, {}
+			, release);
+
+		vk::ImageMemoryBarrier acquire = toShaderRead;
+		acquire.setSrcAccessMask({});
+		batch.m_graphicCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe
+			, vk::PipelineStageFlagBits::eFragmentShader
+			, {}
+			, {}
+			, {}
+			, acquire);
+
+		batch.m_transferUsed = true;
+	}
+	else
+	{
+		batch.m_graphicCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer
+			, vk::PipelineStageFlagBits::eFragmentShader
+			, {}
+			, {}
+			, {}
+			, toShaderRead);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------------
+void UploadContext::submit()
+{
+	UploadBatch& batch = m_batches[m_currentBatch];
+	if (!batch.m_recording)
+	{
+		return;
+	}
+
+	batch.m_graphicCommands.end();
+	if (hasTransferQueue())
+	{
+		batch.m_transferCommands.end();
+	}
+
+	if (batch.m_transferUsed)
+	{
+		vk::SubmitInfo transferSubmit = {};
+		transferSubmit.setCommandBuffers(batch.m_transferCommands)
+			.setSignalSemaphores(batch.m_transferFinished);
+
+		auto res = m_queues.m_transferQueue.submit(transferSubmit);
+		engineAssert(res == vk::Result::eSuccess, "Failed to submit transfer commands");
+	}
+
+	//-- Acquire barriers run only after transfer queue released the resources
+	vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+	vk::SubmitInfo         graphicSubmit = {};
+	graphicSubmit.setCommandBuffers(batch.m_graphicCommands);
+	if (batch.m_transferUsed)
+	{
+		graphicSubmit.setWaitSemaphores(batch.m_transferFinished)
+			.setWaitDstStageMask(waitStage);
+	}
+
+	std::unique_lock queueLock(*m_queues.m_graphicQueueMutex);
+	auto res = m_queues.m_graphicQueue.submit(graphicSubmit, batch.m_fence);
+	engineAssert(res == vk::Result::eSuccess, "Failed to submit upload commands");
+	queueLock.unlock();
+
+	batch.m_recording = false;
+	batch.m_submitted = true;
+	m_currentBatch = (m_currentBatch + 1) % C_BATCHES_COUNT;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool UploadContext::isComplete(UploadTicket ticket)
+{
+	retireBatches(false);
+	return ticket <= m_completedTicket;
+}
+
+//-------------------------------------------------------------------------------------------------
+void UploadContext::wait(UploadTicket ticket)
+{
+	if (ticket <= m_completedTicket)
+	{
+		return;
+	}
+
+	const UploadBatch& current = m_batches[m_currentBatch];
+	if (current.m_recording && current.m_ticket == ticket)
+	{
+		submit();
+	}
+
+	while (ticket > m_completedTicket)
+	{
+		retireBatches(true);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::UploadBatch& UploadContext::recordingBatch()
+{
+	UploadBatch& batch = m_batches[m_currentBatch];
+	if (batch.m_recording)
+	{
+		return batch;
+	}
+
+	//-- Slot is reused, its previous submission has to retire first
+	while (batch.m_submitted)
+	{
+		retireBatches(true);
+	}
+
+	auto res = m_device.resetFences(batch.m_fence);
+	engineAssert(res == vk::Result::eSuccess, "Failed to reset upload fence");
+
+	batch.m_ticket = ++m_lastTicket;
+	batch.m_ringEnd = m_ringHead;
+	batch.m_transferUsed = false;
+	batch.m_recording = true;
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	batch.m_graphicCommands.begin(beginInfo);
+	if (hasTransferQueue())
+	{
+		batch.m_transferCommands.begin(beginInfo);
+	}
+
+	return batch;
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::StagingRegion UploadContext::allocateStaging(vk::DeviceSize size)
+{
+	if (size > C_STAGING_RING_SIZE)
+	{
+		//-- Rare huge upload gets own buffer living until its batch retires
+		const StagingBuffer staging = createStagingBuffer(size);
+		recordingBatch().m_oversizedStaging.push_back(staging);
+		return { staging.m_buffer, 0, staging.m_allocation.m_mapped };
+	}
+
+	for (;;)
+	{
+		uint64_t position = (m_ringHead + C_STAGING_ALIGNMENT - 1) / C_STAGING_ALIGNMENT * C_STAGING_ALIGNMENT;
+		//-- Region can't wrap around ring end, skip the tail
+		if (position % C_STAGING_RING_SIZE + size > C_STAGING_RING_SIZE)
+		{
+			position = (position / C_STAGING_RING_SIZE + 1) * C_STAGING_RING_SIZE;
+		}
+
+		if (position + size - m_ringTail <= C_STAGING_RING_SIZE)
+		{
+			m_ringHead = position + size;
+			recordingBatch().m_ringEnd = m_ringHead;
+
+			const vk::DeviceSize offset = position % C_STAGING_RING_SIZE;
+			return { m_stagingRing.m_buffer, offset, static_cast<uint8_t*>(m_stagingRing.m_allocation.m_mapped) + offset };
+		}
+
+		//-- Ring is full, when only recorded batch holds it, it has to be submitted first
+		if (oldestSubmittedBatch() == nullptr)
+		{
+			submit();
+		}
+		retireBatches(true);
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::StagingBuffer UploadContext::createStagingBuffer(vk::DeviceSize size)
+{
+	StagingBuffer staging;
+
+	//-- Staging is read by both queues, concurrent sharing spares ownership transfers for it
+	const std::array<uint32_t, 2> queueFamilies = { m_queues.m_graphicFamily, m_queues.m_transferFamily };
+
+	vk::BufferCreateInfo bufferInfo = {};
+	bufferInfo.setSize(size)
+		.setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+		.setSharingMode(vk::SharingMode::eExclusive);
+	if (hasTransferQueue())
+	{
+		bufferInfo.setSharingMode(vk::SharingMode::eConcurrent)
+			.setQueueFamilyIndices(queueFamilies);
+	}
+	{
+		auto [res, buffer] = m_device.createBuffer(bufferInfo);
+		engineAssert(res == vk::Result::eSuccess, std::format("Failed to create {} bytes staging buffer", size));
+		staging.m_buffer = buffer;
+	}
+
+	vk::MemoryRequirements memReq = m_device.getBufferMemoryRequirements(staging.m_buffer);
+	staging.m_allocation = m_allocator.allocate(memReq
+		, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		, GpuResourceKind::Buffer
+		, GpuAllocationStrategy::Linear);
+	m_device.bindBufferMemory(staging.m_buffer, staging.m_allocation.m_memory, staging.m_allocation.m_offset);
+
+	return staging;
+}
+
+//-------------------------------------------------------------------------------------------------
+void UploadContext::destroyStagingBuffer(StagingBuffer& stagingBuffer)
+{
+	m_device.destroyBuffer(stagingBuffer.m_buffer);
+	m_allocator.free(stagingBuffer.m_allocation);
+	stagingBuffer = {};
+}
+
+//-------------------------------------------------------------------------------------------------
+void UploadContext::retireBatches(bool waitOldest)
+{
+	while (UploadBatch* batch = oldestSubmittedBatch())
+	{
+		if (waitOldest)
+		{
+			auto res = m_device.waitForFences(batch->m_fence, vk::True, UINT64_MAX);
+			engineAssert(res == vk::Result::eSuccess, "Failed to wait upload fence");
+			waitOldest = false;
+		}
+		else if (m_device.getFenceStatus(batch->m_fence) != vk::Result::eSuccess)
+		{
+			break;
+		}
+
+		m_ringTail = batch->m_ringEnd;
+		for (auto& staging : batch->m_oversizedStaging)
+		{
+			destroyStagingBuffer(staging);
+		}
+		batch->m_oversizedStaging.clear();
+
+		m_completedTicket = batch->m_ticket;
+		batch->m_submitted = false;
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+UploadContext::UploadBatch* UploadContext::oldestSubmittedBatch()
+{
+	UploadBatch* oldest = nullptr;
+	for (auto& batch : m_batches)
+	{
+		if (batch.m_submitted && (oldest == nullptr || batch.m_ticket < oldest->m_ticket))
+		{
+			oldest = &batch;
+		}
+	}
+	return oldest;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#define VULKAN_HPP_NO_EXCEPTIONS
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#include <application/renderer/gpu_memory_allocator.h>
+#include <application/renderer/texture_data.h>
+
+//-- Id of the upload batch, grows monotonically. Resource may be destroyed or its
+//-- staging data reused only after its ticket is complete
+using UploadTicket = uint64_t;
+
+//-------------------------------------------------------------------------------------------------
+vk::Format textureVkFormat(TextureFormat format);
+
+//-------------------------------------------------------------------------------------------------
+struct UploadQueues
+{
+	vk::Queue m_graphicQueue;
+	uint32_t  m_graphicFamily = 0;
+	//-- Guards graphic queue shared with frame submission
+	std::mutex* m_graphicQueueMutex = nullptr;
+	//-- Null when device has no dedicated transfer family
+	vk::Queue m_transferQueue;
+	uint32_t  m_transferFamily = 0;
+};
+
+//-------------------------------------------------------------------------------------------------
+//-- Collects copies and layout transitions into one batch which is submitted once per frame
+//-- right before frame command buffer, so nothing waits for the queue to become idle.
+//-- Source data is copied into persistently mapped staging ring, ring space of a batch is
+//-- reclaimed when batch fence is signaled.
+//-- With dedicated transfer queue fresh resources are filled there and handed over to graphic
+//-- queue by ownership transfer barriers. Updates of images already sampled by frames stay
+//-- on graphic queue, the image is owned by it.
+class UploadContext
+{
+public:
+	UploadContext(vk::Device device, GpuMemoryAllocator& allocator, const UploadQueues& queues);
+	~UploadContext();
+
+	//-- Destination has to be created with TransferDst usage and not be read by frames in flight
+	UploadTicket uploadBuffer(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+	//-- RGBA8 pixels into image region, image has to be in oldLayout (Undefined for fresh one),
+	//-- it is in ShaderReadOnlyOptimal for commands submitted after the batch
+	UploadTicket uploadImage(vk::Image         image
+	                         , vk::ImageLayout oldLayout
+	                         , const void*     pixels
+	                         , uint32_t        width
+	                         , uint32_t        height
+	                         , uint32_t        offsetX = 0
+	                         , uint32_t        offsetY = 0);
+	//-- All mip levels of image created with texture format and mips count, image has to be in
+	//-- oldLayout. Level N is written at offset scaled down to that level
+	UploadTicket uploadTexture(vk::Image            image
+	                           , const TextureData& texture
+	                           , vk::ImageLayout    oldLayout = vk::ImageLayout::eUndefined
+	                           , uint32_t           offsetX = 0
+	                           , uint32_t           offsetY = 0);
+
+	//-- Submits recorded batch if there is one
+	void submit();
+	bool isComplete(UploadTicket ticket);
+	//-- Submits ticket batch if it is still recorded and blocks until it is complete
+	void wait(UploadTicket ticket);
+
+	bool hasTransferQueue() const { return m_queues.m_transferQueue != VK_NULL_HANDLE; }
+
+private:
+	//-------------------------------------------------------------------------------------------------
+	struct StagingBuffer
+	{
+		vk::Buffer    m_buffer;
+		GpuAllocation m_allocation;
+	};
+
+	//-------------------------------------------------------------------------------------------------
+	struct StagingRegion
+	{
+		vk::Buffer     m_buffer;
+		vk::DeviceSize m_offset = 0;
+		void*          m_data = nullptr;
+	};
+
+	//-------------------------------------------------------------------------------------------------
+	struct UploadBatch
+	{
+		vk::CommandBuffer m_transferCommands;
+		vk::CommandBuffer m_graphicCommands;
+		vk::Semaphore     m_transferFinished;
+		vk::Fence         m_fence;
+		UploadTicket      m_ticket = 0;
+		//-- Staging ring position after the last batch allocation
+		uint64_t          m_ringEnd = 0;
+		//-- Uploads bigger than the whole ring
+		std::vector<StagingBuffer> m_oversizedStaging;
+		bool              m_recording = false;
+		bool              m_submitted = false;
+		bool              m_transferUsed = false;
+	};
+
+	UploadBatch& recordingBatch();
+	//-- Copies with transitions into ShaderReadOnlyOptimal, fresh images go on transfer queue
+	void recordImageCopy(UploadBatch&                                       batch
+	                     , vk::Image                                        image
+	                     , vk::ImageLayout                                  oldLayout
+	                     , vk::Buffer                                       stagingBuffer
+	                     , vk::ArrayProxy<const vk::BufferImageCopy> const& regions
+	                     , uint32_t                                         mipLevels);
+	StagingRegion allocateStaging(vk::DeviceSize size);
+	StagingBuffer createStagingBuffer(vk::DeviceSize size);
+	void destroyStagingBuffer(StagingBuffer& stagingBuffer);
+	//-- Retires submitted batches in order, optionally blocking on the oldest one
+	void retireBatches(bool waitOldest);
+	UploadBatch* oldestSubmittedBatch();
+
+private:
+	constexpr static inline uint32_t       C_BATCHES_COUNT = 3;
+	constexpr static inline vk::DeviceSize C_STAGING_RING_SIZE = 32ull * 1024 * 1024;
+	//-- Covers texel size and usual optimalBufferCopyOffsetAlignment
+	constexpr static inline vk::DeviceSize C_STAGING_ALIGNMENT = 16;
+
+	vk::Device          m_device;
+	GpuMemoryAllocator& m_allocator;
+	UploadQueues        m_queues;
+
+	vk::CommandPool m_graphicCommandPool;
+	vk::CommandPool m_transferCommandPool;
+
+	std::array<UploadBatch, C_BATCHES_COUNT> m_batches;
+	uint32_t                                 m_currentBatch = 0;
+	UploadTicket                             m_lastTicket = 0;
+	UploadTicket                             m_completedTicket = 0;
+
+	//-- Ring positions grow monotonically, offset in buffer is position modulo ring size
+	StagingBuffer m_stagingRing;
+	uint64_t      m_ringHead = 0;
+	uint64_t      m_ringTail = 0;
+};
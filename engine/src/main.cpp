@@ -1,15 +1,117 @@
 #include <application/engine.h>
+#include <application/core/scene/scene_serializer.h>
+#include <application/core/scene/spatial_hash.h>
+#include <application/core/utils/thread_pool.h>
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/texture_atlas.h>
+#include <application/renderer/texture_data.h>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 
 ABSL_FLAG(std::string, projectPath, "../simple_project/", "Path to project");
+ABSL_FLAG(bool, nullDevice, false, "Replace GPU with device doing no work, to profile CPU side of frames without window");
+ABSL_FLAG(bool, headless, false, "Render into offscreen images without window and UI, for benchmarks and CI");
+ABSL_FLAG(uint32_t, headlessWidth, 1200, "Width of offscreen images in headless or null device mode");
+ABSL_FLAG(uint32_t, headlessHeight, 800, "Height of offscreen images in headless or null device mode");
+ABSL_FLAG(uint32_t, frames, 0, "Frames to run before exit with timing summary, 0 to run until window is closed");
+ABSL_FLAG(std::string, readback, "", "Headless mode only, write the last rendered frame as TGA to this path on exit");
+ABSL_FLAG(bool, instancedSprites, true, "Draw sprites as instances, otherwise expand quads on CPU");
+ABSL_FLAG(bool, runtimeAtlas, true, "Pack small images into atlas pages while loading them");
+ABSL_FLAG(bool, cookAtlas, false, "Pack small images of the project into atlas pages with lookup table and exit");
+ABSL_FLAG(bool, cookTextures, false, "Encode project images with mip chains into texture containers and exit");
+ABSL_FLAG(std::string, textureFormat, "bc7", "Format of cooked textures: rgba8, bc3 or bc7");
+ABSL_FLAG(bool, bindlessTextures, true, "Sample sprite textures from one descriptor array when device supports it");
+ABSL_FLAG(bool, compileShaders, false, "Compile shaders from sources instead of cooked SPIR-V, needs engine built with ENGINE_RUNTIME_SHADERC");
+ABSL_FLAG(bool, frustumCulling, true, "Skip sprites outside camera frustum before batching");
+ABSL_FLAG(bool, retainedSprites, false, "Keep sprites in renderer between frames and send only changed ones, static scenes cost next to nothing");
+ABSL_FLAG(bool, opaquePass, true, "Draw sprites with opaque or cutout textures front to back with depth write before blended ones");
+ABSL_FLAG(uint32_t, recordingThreads, 0, "Threads recording sprite batches into secondary command buffers, 0 to record inline on main thread");
+ABSL_FLAG(bool, renderThread, false, "Render frames on a dedicated thread while main thread updates the next one");
+ABSL_FLAG(uint32_t, renderLatency, 1, "Frames main thread may run ahead of render thread");
+ABSL_FLAG(uint32_t, workerThreads, 0, "Worker threads for background jobs, 0 to use all hardware threads but one");
+ABSL_FLAG(uint32_t, frameThreads, 0, "Threads splitting sprite extraction, culling, sorting and batching, 0 to use all workers and main thread");
+ABSL_FLAG(bool, benchSpatialIndex, false, "Compare spatial index of scene entities against brute force scan and exit");
+ABSL_FLAG(std::string, scene, "", "Scene file editor opens and saves to, relative to project");
+ABSL_FLAG(std::string, sceneToText, "", "Write JSON of binary scene file next to it, for diffs, and exit");
+ABSL_FLAG(uint32_t, stressSprites, 0, "Extra sprites scattered around the scene, to measure scaling of frame work");
 
 int main(int argc, char** argv)
 {
 	absl::ParseCommandLine(argc, argv);
 
-	Config config{ .m_projectPath = absl::GetFlag(FLAGS_projectPath) };
+	if (absl::GetFlag(FLAGS_cookAtlas))
+	{
+		VirtualFS vfs(absl::GetFlag(FLAGS_projectPath));
+		cookTextureAtlas(vfs, "images");
+		return 0;
+	}
+
+	if (absl::GetFlag(FLAGS_cookTextures))
+	{
+		const std::string                  formatName = absl::GetFlag(FLAGS_textureFormat);
+		const std::optional<TextureFormat> format = parseTextureFormat(formatName);
+		if (!format)
+		{
+			std::println("Unknown texture format '{}'", formatName);
+			return 1;
+		}
+
+		VirtualFS vfs(absl::GetFlag(FLAGS_projectPath));
+		cookTextures(vfs, "images", *format);
+		return 0;
+	}
+
+	if (const std::string scenePath = absl::GetFlag(FLAGS_sceneToText); !scenePath.empty())
+	{
+		VirtualFS     vfs(absl::GetFlag(FLAGS_projectPath));
+		const fs_path nativePath = vfs.virtualToNativePath(scenePath);
+		fs_path       textPath = nativePath;
+		textPath.replace_extension(SceneFileConfig::C_TEXT_EXTENSION);
+		if (!exportSceneText(nativePath, textPath))
+		{
+			std::println("Can't read scene '{}'", scenePath);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (absl::GetFlag(FLAGS_benchSpatialIndex))
+	{
+		ThreadPool threadPool(absl::GetFlag(FLAGS_workerThreads), absl::GetFlag(FLAGS_frameThreads));
+		benchmarkSpatialHash(threadPool);
+		return 0;
+	}
+
+	Config config{
+		.m_projectPath = absl::GetFlag(FLAGS_projectPath)
+		, .m_rendererConfig = {
+			.m_graphicBackend = absl::GetFlag(FLAGS_nullDevice)
+				? GraphicBackend::Null
+				: GraphicBackend::Vulkan
+			, .m_spriteRenderPath = absl::GetFlag(FLAGS_instancedSprites)
+				? SpriteRenderPath::Instanced
+				: SpriteRenderPath::Vertex
+			, .m_bindlessTextures = absl::GetFlag(FLAGS_bindlessTextures)
+			, .m_runtimeAtlas = absl::GetFlag(FLAGS_runtimeAtlas)
+			, .m_compileShaders = absl::GetFlag(FLAGS_compileShaders)
+			, .m_frustumCulling = absl::GetFlag(FLAGS_frustumCulling)
+			, .m_retainedSprites = absl::GetFlag(FLAGS_retainedSprites)
+			, .m_opaquePass = absl::GetFlag(FLAGS_opaquePass)
+			, .m_recordingThreads = absl::GetFlag(FLAGS_recordingThreads)
+			, .m_renderThread = absl::GetFlag(FLAGS_renderThread)
+			, .m_renderLatencyFrames = absl::GetFlag(FLAGS_renderLatency)
+			, .m_headless = absl::GetFlag(FLAGS_headless)
+			, .m_headlessWidth = absl::GetFlag(FLAGS_headlessWidth)
+			, .m_headlessHeight = absl::GetFlag(FLAGS_headlessHeight)
+			, .m_readbackPath = absl::GetFlag(FLAGS_readback)
+		}
+		, .m_workerThreads = absl::GetFlag(FLAGS_workerThreads)
+		, .m_frameThreads = absl::GetFlag(FLAGS_frameThreads)
+		, .m_stressSpritesCount = absl::GetFlag(FLAGS_stressSprites)
+		, .m_scenePath = absl::GetFlag(FLAGS_scene)
+		, .m_framesCount = absl::GetFlag(FLAGS_frames)
+	};
 	Engine e{ config };
 	e.run();
 }
@@ -0,0 +1,74 @@
+#include <application/core/utils/engine_assert.h>
+#include <application/managers/virtual_fs.h>
+#include <application/renderer/shader_compiler.h>
+#include <application/renderer/shader_manifest.h>
+
+#include <cstring>
+#include <format>
+#include <print>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+ABSL_FLAG(std::string, projectPath, "../simple_project/", "Path to project with shaders dir");
+
+//-------------------------------------------------------------------------------------------------
+//-- Build step: every stage of every shader under project shaders dir is compiled to SPIR-V,
+//-- plain and with each declared variant, and listed in manifest the engine loads at startup
+int main(int argc, char** argv)
+{
+	absl::ParseCommandLine(argc, argv);
+
+	VirtualFS     vfs(absl::GetFlag(FLAGS_projectPath));
+	const fs_path shadersDir = ShaderCookConfig::C_SHADERS_DIR;
+	const fs_path nativeShadersDir = vfs.virtualToNativePath(shadersDir);
+	engineAssert(std::filesystem::is_directory(nativeShadersDir)
+		, std::format("Shaders dir '{}' doesn't exist", nativeShadersDir.generic_string()));
+
+	std::filesystem::remove_all(vfs.virtualToNativePath(ShaderCookConfig::C_COOKED_DIR));
+
+	ShaderManifest manifest;
+	for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(nativeShadersDir))
+	{
+		if (!dirEntry.is_regular_file())
+		{
+			continue;
+		}
+
+		const fs_path     relativePath = std::filesystem::relative(dirEntry.path(), nativeShadersDir);
+		const std::string sourcePath = normalizePath(shadersDir / relativePath);
+		const std::string source = vfs.loadFile(sourcePath).toString();
+
+		//-- Files without stages are includes or notes, they get compiled as part of others
+		auto variants = shaderVariants(source);
+		variants.insert(variants.begin(), std::vector<std::string>{});
+		for (const auto& stageSource : splitShaderStages(sourcePath, source))
+		{
+			for (size_t variant = 0; variant < variants.size(); ++variant)
+			{
+				const std::vector<uint32_t> code = compileShaderStage(vfs, sourcePath, stageSource, variants[variant]);
+
+				const std::string variantSuffix = variant == 0 ? "" : std::format(".{}", variant);
+				const std::string spirvPath = normalizePath(fs_path(ShaderCookConfig::C_COOKED_DIR)
+					/ std::format("{}.{}{}.spv", normalizePath(relativePath), shaderStageName(stageSource.m_stage), variantSuffix));
+
+				std::filesystem::create_directories(vfs.virtualToNativePath(spirvPath).parent_path());
+				File blob = vfs.createFile(spirvPath);
+				blob.m_buffer.resize(code.size() * sizeof(uint32_t));
+				memcpy(blob.m_buffer.data(), code.data(), blob.m_buffer.size());
+				vfs.writeFile(blob);
+
+				manifest.m_entries.push_back({ sourcePath, stageSource.m_stage, joinShaderMacros(variants[variant]), spirvPath });
+				std::println("Shader {} ({}) [{}] -> {}"
+					, sourcePath
+					, shaderStageName(stageSource.m_stage)
+					, manifest.m_entries.back().m_macros
+					, spirvPath);
+			}
+		}
+	}
+	manifest.save(vfs);
+
+	std::println("Shaders cooked: {} variants by {}", manifest.m_entries.size(), shaderCompilerIdentity());
+	return 0;
+}
@@ -1,5 +1,30 @@
-// TODO: Add processing two shader types from one file system
+#version 450
+
+//-- Multi stage file: lines before the first section are shared by all stages
+layout(set = 0, binding = 0) uniform ModelViewProj
+{
+	mat4	m_view;
+	mat4	m_proj;
+} mvp;
+
 #shader vert
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
 
+void main()
+{
+	gl_Position = mvp.m_proj * mvp.m_view * inPosition;
+	fragColor = inColor;
+}
 
 #shader frag
+layout(location = 0) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	outColor = fragColor;
+}
@@ -1,16 +1,40 @@
 #version 450
+//!variant BINDLESS_TEXTURES
+//!variant ALPHA_CUTOUT
+//!variant BINDLESS_TEXTURES ALPHA_CUTOUT
 
-layout(location = 0) in vec3 fragColor;
+#ifdef BINDLESS_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColor;
 
+#ifdef BINDLESS_TEXTURES
+//-- Sprites of one draw may use different textures, so index isn't uniform
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+#else
 layout(set = 1, binding = 0) uniform sampler2D texSampler;
+#endif
 
 void main()
 {
 	// outColor = vec4(fragColor, 1.0);
 	// outColor = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0);
-	outColor = texture(texSampler, fragTexCoord);
-	// outColor *= vec4(fragColor, 1.0);
+#ifdef BINDLESS_TEXTURES
+	outColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord) * fragColor;
+#else
+	outColor = texture(texSampler, fragTexCoord) * fragColor;
+#endif
+
+#ifdef ALPHA_CUTOUT
+	//-- Cutout sprites write depth, transparent texels must not occlude anything
+	if (outColor.a < 0.5)
+	{
+		discard;
+	}
+#endif
 }
\ No newline at end of file
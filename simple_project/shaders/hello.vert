@@ -3,6 +3,7 @@
 layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in uint inTextureIndex;
 
 layout(set = 0, binding = 0) uniform ModelViewProj
 {
@@ -10,12 +11,14 @@ layout(set = 0, binding = 0) uniform ModelViewProj
 	mat4	m_proj;
 } mvp;
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
 
 void main()
 {
 	gl_Position = mvp.m_proj * mvp.m_view * inPosition;
-	fragColor = inColor;
+	fragColor = vec4(inColor, 1.0);
 	fragTexCoord = inTexCoord;
+	fragTextureIndex = inTextureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 450
+
+//-- Per instance attributes, layout matches SpriteInstanceData
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in float inDepth;
+layout(location = 2) in vec2 inScale;
+layout(location = 3) in vec4 inUvRect;
+layout(location = 4) in vec4 inColor;
+//-- Half float rotation in low 16 bits, bindless texture slot in high 16 bits
+layout(location = 5) in uint inRotationAndTexture;
+
+layout(set = 0, binding = 0) uniform ModelViewProj
+{
+	mat4	m_view;
+	mat4	m_proj;
+} mvp;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
+
+//-- Same triangles as quad index buffer: 0 1 2, 2 3 0
+const vec2 C_CORNERS[6] = vec2[](
+	vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5),
+	vec2(0.5, 0.5), vec2(-0.5, 0.5), vec2(-0.5, -0.5)
+);
+const vec2 C_TEX_COORDS[6] = vec2[](
+	vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+	vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0)
+);
+
+void main()
+{
+	float rotation = unpackHalf2x16(inRotationAndTexture & 0xFFFFu).x;
+	float s = sin(rotation);
+	float c = cos(rotation);
+
+	vec2 corner = C_CORNERS[gl_VertexIndex] * inScale;
+	vec2 rotated = vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+
+	gl_Position = mvp.m_proj * mvp.m_view * vec4(inPosition + rotated, inDepth, 1.0);
+	fragColor = inColor;
+	fragTextureIndex = inRotationAndTexture >> 16;
+	fragTexCoord = mix(inUvRect.xy, inUvRect.zw, C_TEX_COORDS[gl_VertexIndex]);
+}
\ No newline at end of file